@@ -0,0 +1,127 @@
+#include "allocation.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+static std::atomic<unsigned long long> totalCount{ 0 };
+static std::atomic<unsigned long long> totalBytes{ 0 };
+
+// Plain thread locals, usable before and after any constructor runs
+static thread_local unsigned long long threadCount = 0;
+static thread_local unsigned long long threadBytes = 0;
+static thread_local unsigned int threadPaused = 0;
+
+bool AllocationTracker::isEnabled()
+{
+#ifdef TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationCounts AllocationTracker::getTotal()
+{
+    AllocationCounts counts;
+
+    counts.count = totalCount.load(std::memory_order_relaxed);
+    counts.bytes = totalBytes.load(std::memory_order_relaxed);
+
+    return counts;
+}
+
+AllocationCounts AllocationTracker::getThread()
+{
+    AllocationCounts counts;
+
+    counts.count = threadCount;
+    counts.bytes = threadBytes;
+
+    return counts;
+}
+
+void AllocationTracker::record(size_t bytes)
+{
+    if (threadPaused)
+        return;
+
+    ++threadCount;
+    threadBytes += bytes;
+
+    totalCount.fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+AllocationTracker::Pause::Pause()
+{
+    ++threadPaused;
+}
+
+AllocationTracker::Pause::~Pause()
+{
+    --threadPaused;
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+void* operator new(size_t size)
+{
+    AllocationTracker::record(size);
+
+    void* pointer = malloc(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    AllocationTracker::record(size);
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    AllocationTracker::record(size);
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    free(pointer);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+
+/**
+ * \brief Number and size of heap allocations
+ */
+struct AllocationCounts
+{
+    unsigned long long count = 0;
+    unsigned long long bytes = 0;
+};
+
+/**
+ * \brief Counts every global operator new.
+ *
+ * The hook is compiled only with TRACK_ALLOCATIONS (the Profile
+ * configuration), otherwise every count stays zero. Counts are kept for
+ * the whole process and for each thread, so a scope on one thread can
+ * tell what it allocated itself.
+ */
+class AllocationTracker
+{
+public:
+    static bool isEnabled();
+
+    static AllocationCounts getTotal();
+    static AllocationCounts getThread();
+
+    static void record(size_t bytes);
+
+    /**
+     * \brief Allocations of this thread inside the scope are not counted,
+     * for diagnostic output such as trace and metrics dumps
+     */
+    class Pause
+    {
+    public:
+        Pause();
+        ~Pause();
+    };
+};
\ No newline at end of file
@@ -0,0 +1,504 @@
+#include "batch.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+#include "obstacle.hpp"
+#include "command.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <glm/gtc/matrix_transform.hpp>
+
+
+const char* BATCH_CUBE = "models/cube.obj";
+
+/**
+ * \brief Placement range of swept cubes, the range of the scenario runner
+ */
+const float BATCH_LAYOUT_EXTENT = 8.0f;
+
+/**
+ * \brief Wave speed of swept sources when neither the sweep nor the scene gives one
+ */
+const float BATCH_DEFAULT_SPEED = 25.0f;
+
+/**
+ * \brief Ticks handed to one Scene::fastForward call
+ */
+const unsigned int LEAP_TICKS = 256;
+
+template <typename T>
+static void putValue(std::vector<unsigned char>& data, const T& value)
+{
+    const unsigned char* bytes = (const unsigned char*)&value;
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static bool getValue(const std::vector<unsigned char>& data, size_t& offset, T& value)
+{
+    if (offset + sizeof(T) > data.size())
+        return false;
+
+    memcpy(&value, &data[offset], sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+static float gridPoint(float min, float max, unsigned int index, unsigned int count)
+{
+    return count > 1 ? min + (max - min) * index / (count - 1) : min;
+}
+
+bool SweepSpec::load(const std::string& path, SweepSpec& spec)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open sweep file: " << path << std::endl;
+        return false;
+    }
+
+    std::string text, keyword;
+    unsigned int lineNumber = 0, i, j, k;
+
+    while (std::getline(file, text))
+    {
+        ++lineNumber;
+
+        std::istringstream line(text.substr(0, text.find('#')));
+        if (!(line >> keyword))
+            continue;
+
+        bool valid = true;
+
+        if (keyword == "scene")
+            valid = static_cast<bool>(line >> spec.scenePath);
+        else if (keyword == "position")
+        {
+            glm::vec3 position;
+            valid = static_cast<bool>(line >> position.x >> position.y >> position.z);
+            if (valid)
+                spec.positions.push_back(position);
+        }
+        else if (keyword == "grid")
+        {
+            glm::vec3 min, max;
+            unsigned int counts[3];
+
+            valid = line >> min.x >> min.y >> min.z >> max.x >> max.y >> max.z >> counts[0] >> counts[1] >> counts[2] &&
+                counts[0] && counts[1] && counts[2];
+
+            for (i = 0; valid && i < counts[0]; ++i)
+                for (j = 0; j < counts[1]; ++j)
+                    for (k = 0; k < counts[2]; ++k)
+                        spec.positions.push_back(glm::vec3(
+                            gridPoint(min.x, max.x, i, counts[0]),
+                            gridPoint(min.y, max.y, j, counts[1]),
+                            gridPoint(min.z, max.z, k, counts[2])));
+        }
+        else if (keyword == "speed" || keyword == "obstacles")
+        {
+            float value;
+            unsigned int count = 0;
+
+            for (; line >> value; ++count)
+                if (keyword == "speed")
+                    spec.speeds.push_back(value);
+                else
+                    spec.obstacleCounts.push_back(static_cast<unsigned int>(value));
+
+            valid = count > 0 && line.eof();
+        }
+        else if (keyword == "layouts")
+            valid = line >> spec.layouts && spec.layouts > 0;
+        else if (keyword == "seed")
+            valid = static_cast<bool>(line >> spec.seed);
+        else if (keyword == "ticks")
+            valid = static_cast<bool>(line >> spec.ticks);
+        else if (keyword == "tick-time")
+            valid = line >> spec.tickTime && spec.tickTime > 0.0f;
+        else
+            valid = false;
+
+        if (!valid)
+        {
+            std::cout << "Sweep file line " << lineNumber << " is not valid: " << text << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+BatchRunner::BatchRunner(MeshCache& meshCache, const SweepSpec& spec, unsigned int threads, ResultCache* resultCache) :
+    meshCache(meshCache),
+    spec(spec),
+    threads(threads),
+    resultCache(resultCache)
+{
+}
+
+bool BatchRunner::run(const std::string& csvPath)
+{
+    if (!prepare())
+        return false;
+
+    csv.open(csvPath);
+    if (!csv.is_open())
+    {
+        std::cout << "Failed to open sweep output: " << csvPath << std::endl;
+        return false;
+    }
+
+    unsigned int i;
+
+    csv << "run,x,y,z,speed,obstacles,layout,ticks,decay_tick,decay_time,"
+        "room_reflections,obstacle_tests,triangles_killed,absorbed";
+    for (i = 0; i < obstacleColumns; ++i)
+        csv << ",absorbed_" << i;
+    csv << ",wall_ms,cached" << std::endl;
+
+    // Every core busy, but no more threads than cores
+    unsigned int cores = threads ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+    unsigned int runThreads = std::min(cores, runCount);
+    unsigned int workerCount = cores / runThreads - 1;
+
+    results.assign(runCount, SweepResult());
+    finished.assign(runCount, false);
+    written = 0;
+    nextRun = 0;
+
+    std::cout << "Sweeping " << runCount << " runs on " << runThreads << " threads, "
+        << workerCount + 1 << " per run" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> runners;
+    for (i = 1; i < runThreads; ++i)
+        runners.push_back(std::thread(&BatchRunner::work, this, workerCount));
+    work(workerCount);
+    for (auto& runner : runners)
+        runner.join();
+
+    csv.close();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Ran " << runCount << " runs in " << seconds << " s, "
+        << (seconds > 0.0 ? runCount * 3600.0 / seconds : 0.0) << " runs per hour" << std::endl;
+    if (resultCache)
+        std::cout << "Result cache: " << resultCache->getHits() << " hits, " << resultCache->getMisses() << " misses, "
+            << resultCache->getEvictions() << " evicted" << std::endl;
+
+    return true;
+}
+
+/**
+ * \brief Resolves the swept sources and layouts and imports every model once
+ */
+bool BatchRunner::prepare()
+{
+    unsigned int i;
+
+    if (!spec.scenePath.empty() && !SceneFile::load(spec.scenePath, description))
+        return false;
+
+    sources.clear();
+    if (spec.positions.empty() && spec.speeds.empty() && !description.sources.empty())
+        sources = description.sources;
+    else
+    {
+        std::vector<glm::vec3> positions = spec.positions;
+        std::vector<float> speeds = spec.speeds;
+
+        if (positions.empty())
+            positions.push_back(glm::vec3(0.0f));
+        if (speeds.empty())
+            speeds.push_back(description.sources.empty() ? BATCH_DEFAULT_SPEED : description.sources[0].speed);
+
+        for (const glm::vec3& position : positions)
+            for (float speed : speeds)
+            {
+                WaveSourceDescription source;
+                source.position = position;
+                source.speed = speed;
+                sources.push_back(source);
+            }
+    }
+
+    layoutCount = spec.obstacleCounts.empty() ? 1 : spec.obstacleCounts.size() * spec.layouts;
+    runCount = sources.size() * layoutCount;
+
+    obstacleColumns = description.obstacles.size();
+    if (!spec.obstacleCounts.empty())
+        obstacleColumns = *std::max_element(spec.obstacleCounts.begin(), spec.obstacleCounts.end());
+
+    // Imports happen here, the runs only copy templates
+    glm::mat4 identity = glm::mat4(1.0f);
+    glm::vec4 color = glm::vec4(1.0f);
+    float speed = BATCH_DEFAULT_SPEED;
+
+    Sphere wave(identity, color, speed, false);
+    meshCache.loadModel(description.waveMesh, wave);
+    if (wave.getVertices().empty())
+    {
+        std::cout << "Wave mesh is missing: " << description.waveMesh << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> meshes;
+    if (spec.obstacleCounts.empty())
+        for (const ObstacleDescription& obstacle : description.obstacles)
+            meshes.push_back(obstacle.mesh);
+    else
+        meshes.push_back(BATCH_CUBE);
+
+    for (i = 0; i < meshes.size(); ++i)
+    {
+        Obstacle obstacle(identity, color, GL_BACK);
+        meshCache.loadModel(meshes[i], obstacle);
+        if (obstacle.getVertices().empty())
+        {
+            std::cout << "Obstacle mesh is missing: " << meshes[i] << std::endl;
+            return false;
+        }
+    }
+
+    return runCount > 0;
+}
+
+void BatchRunner::work(unsigned int workerCount)
+{
+    TRACE_THREAD("batch runner");
+
+    unsigned int run;
+
+    while ((run = nextRun.fetch_add(1)) < runCount)
+    {
+        SweepResult result;
+        runOne(run, workerCount, result);
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        results[run] = result;
+        finished[run] = true;
+
+        // Rows keep run order, a finished run waits for the ones before it
+        while (written < runCount && finished[written])
+        {
+            writeRow(results[written]);
+            results[written] = SweepResult();
+            ++written;
+        }
+    }
+}
+
+void BatchRunner::runOne(unsigned int run, unsigned int workerCount, SweepResult& result)
+{
+    TRACE_SCOPE("BatchRunner::runOne");
+
+    auto start = std::chrono::steady_clock::now();
+    const WaveSourceDescription& source = sources[run / layoutCount];
+
+    result.run = run;
+    result.position = source.position;
+    result.speed = source.speed;
+
+    // Swept sources all emit at the first tick
+    SceneDescription runScene;
+    runScene.waveMesh = description.waveMesh;
+    runScene.sources.push_back(source);
+    runScene.sources.back().launchTime = 0.0f;
+    getLayout(run % layoutCount, result, runScene.obstacles);
+
+    unsigned long long key = 0;
+    std::vector<unsigned char> cached;
+
+    if (resultCache)
+    {
+        ContentHash hash;
+        hash.add(ResultCache::hashScene(runScene, meshCache));
+        hash.add(spec.ticks);
+        hash.add(spec.tickTime);
+        key = hash.get();
+
+        if (resultCache->load(key, cached) && decodeResult(cached, result))
+        {
+            result.cached = true;
+            result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return;
+        }
+    }
+
+    Scene scene(workerCount);
+    unsigned int queued = 0;
+
+    for (const ObstacleDescription& obstacle : runScene.obstacles)
+    {
+        glm::mat4 modelMatrix = obstacle.modelMatrix;
+        glm::vec4 modelColor = obstacle.color;
+
+        Obstacle* object = new Obstacle(modelMatrix, modelColor, obstacle.cullMode);
+        meshCache.loadModel(obstacle.mesh, *object);
+        scene.addObject(object);
+
+        if (++queued == CommandQueue::CAPACITY / 2)
+        {
+            scene.flush();
+            queued = 0;
+        }
+    }
+
+    glm::mat4 waveMatrix = glm::translate(glm::mat4(1.0f), source.position);
+    glm::vec4 waveColor = source.color;
+    float waveSpeed = source.speed;
+
+    Sphere wave(waveMatrix, waveColor, waveSpeed, false);
+    meshCache.loadModel(description.waveMesh, wave);
+    scene.addSphere(new Sphere(static_cast<Model&>(wave)));
+
+    std::vector<float> tickTimes(LEAP_TICKS, spec.tickTime);
+    unsigned long long tick = 0;
+
+    while (tick < spec.ticks)
+    {
+        tick += scene.fastForward(&tickTimes[0], std::min<unsigned long long>(LEAP_TICKS, spec.ticks - tick));
+        scene.swap();
+
+        if (scene.getSnapshot().spheres.empty())
+        {
+            result.decayTick = tick;
+            break;
+        }
+    }
+
+    const SceneSnapshot& snapshot = scene.getSnapshot();
+
+    result.ticks = tick;
+    result.counters = snapshot.totalCounters;
+    result.absorbed = snapshot.objectHits;
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (resultCache)
+    {
+        encodeResult(result, cached);
+        resultCache->store(key, cached);
+    }
+}
+
+/**
+ * \brief Obstacles of a layout, the scene's own or seeded cubes
+ */
+void BatchRunner::getLayout(unsigned int layout, SweepResult& result, std::vector<ObstacleDescription>& obstacles)
+{
+    unsigned int i;
+
+    if (spec.obstacleCounts.empty())
+    {
+        obstacles = description.obstacles;
+        return;
+    }
+
+    unsigned int cubes = spec.obstacleCounts[layout / spec.layouts];
+
+    result.obstacles = cubes;
+    result.layout = layout % spec.layouts;
+
+    // Every source and speed meets the same layouts
+    std::seed_seq seed = { spec.seed, cubes, result.layout };
+    std::mt19937 random(seed);
+
+    for (i = 0; i < cubes; ++i)
+    {
+        glm::vec3 position;
+        position.x = uniform(random, -BATCH_LAYOUT_EXTENT, BATCH_LAYOUT_EXTENT);
+        position.y = uniform(random, -BATCH_LAYOUT_EXTENT, BATCH_LAYOUT_EXTENT);
+        position.z = uniform(random, -BATCH_LAYOUT_EXTENT, BATCH_LAYOUT_EXTENT);
+
+        // Same transform order as RenderObstacleMenu
+        glm::mat4 modelMatrix = glm::mat4(1.0f);
+        modelMatrix = glm::rotate(modelMatrix, uniform(random, 0.0f, glm::radians(360.0f)), glm::vec3(1, 0, 0));
+        modelMatrix = glm::rotate(modelMatrix, uniform(random, 0.0f, glm::radians(360.0f)), glm::vec3(0, 1, 0));
+        modelMatrix = glm::rotate(modelMatrix, uniform(random, 0.0f, glm::radians(360.0f)), glm::vec3(0, 0, 1));
+        modelMatrix = glm::translate(modelMatrix, position);
+
+        ObstacleDescription cube;
+        cube.mesh = BATCH_CUBE;
+        cube.modelMatrix = modelMatrix;
+        cube.color = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+        obstacles.push_back(cube);
+    }
+}
+
+void BatchRunner::writeRow(const SweepResult& result)
+{
+    unsigned long long absorbed = 0;
+    unsigned int i;
+
+    for (unsigned long long hits : result.absorbed)
+        absorbed += hits;
+
+    csv << result.run << "," << result.position.x << "," << result.position.y << "," << result.position.z
+        << "," << result.speed << ",";
+    if (result.obstacles >= 0)
+        csv << result.obstacles;
+    csv << "," << result.layout << "," << result.ticks << ",";
+    if (result.decayTick)
+        csv << result.decayTick << "," << result.decayTick * spec.tickTime;
+    else
+        csv << ",";
+    csv << "," << result.counters.roomReflections << "," << result.counters.vertexObstacleTests
+        << "," << result.counters.trianglesKilled << "," << absorbed;
+
+    for (i = 0; i < obstacleColumns; ++i)
+    {
+        csv << ",";
+        if (i < result.absorbed.size())
+            csv << result.absorbed[i];
+    }
+
+    csv << "," << result.wallSeconds * 1000.0 << "," << (result.cached ? 1 : 0) << "\n";
+
+    if (written % 100 == 99 || written + 1 == runCount)
+        std::cout << "Written " << written + 1 << " of " << runCount << " runs" << std::endl;
+}
+
+/**
+ * \brief Cached part of a result: ticks, decay tick, counters and hits, the run's parameters are not kept
+ */
+void BatchRunner::encodeResult(const SweepResult& result, std::vector<unsigned char>& data)
+{
+    data.clear();
+
+    putValue(data, result.ticks);
+    putValue(data, result.decayTick);
+    putValue(data, result.counters);
+    putValue(data, static_cast<unsigned int>(result.absorbed.size()));
+    for (unsigned long long hits : result.absorbed)
+        putValue(data, hits);
+}
+
+bool BatchRunner::decodeResult(const std::vector<unsigned char>& data, SweepResult& result)
+{
+    size_t offset = 0;
+    unsigned int count = 0, i;
+
+    if (!getValue(data, offset, result.ticks) || !getValue(data, offset, result.decayTick) ||
+        !getValue(data, offset, result.counters) || !getValue(data, offset, count) ||
+        data.size() - offset != count * sizeof(unsigned long long))
+        return false;
+
+    result.absorbed.resize(count);
+    for (i = 0; i < count; ++i)
+        getValue(data, offset, result.absorbed[i]);
+
+    return true;
+}
+
+float BatchRunner::uniform(std::mt19937& random, float min, float max)
+{
+    return min + (max - min) * static_cast<float>(random() / 4294967296.0);
+}
\ No newline at end of file
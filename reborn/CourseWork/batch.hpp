@@ -0,0 +1,134 @@
+#pragma once
+
+#include "meshcache.hpp"
+#include "resultcache.hpp"
+#include "scenefile.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief Parameter sweep of the batch runner, every combination is one run.
+ *
+ * The text form has one entry per line like a scene file, '#' starts a
+ * comment:
+ *
+ *     scene scenes/studio.scene
+ *     position 0 0 0
+ *     grid -8 -8 -8 8 8 8 3 3 3
+ *     speed 10 25 50
+ *     obstacles 0 2 4 8
+ *     layouts 10
+ *     seed 1
+ *     ticks 3000
+ *     tick-time 1
+ *
+ * The scene gives the wave mesh and, without an obstacles entry, the one
+ * obstacle layout of every run. position adds a source position, grid adds
+ * the points of a box split into the given number of points per axis.
+ * Without positions and speeds the sources of the scene are swept, each
+ * one on its own. obstacles lists cube counts, each count is placed
+ * `layouts` times from the seed as the scenario runner places them.
+ */
+struct SweepSpec
+{
+    std::string scenePath;
+
+    std::vector<glm::vec3> positions;
+    std::vector<float> speeds;
+
+    std::vector<unsigned int> obstacleCounts;
+    unsigned int layouts = 1;
+    unsigned int seed = 1;
+
+    // A run stops when its last wave decays or after this many ticks
+    unsigned int ticks = 3000;
+    float tickTime = 1.0f;
+
+    static bool load(const std::string& path, SweepSpec& spec);
+};
+
+/**
+ * \brief Parameters and summary metrics of one run
+ */
+struct SweepResult
+{
+    unsigned int run = 0;
+
+    glm::vec3 position = glm::vec3(0.0f);
+    float speed = 0.0f;
+    // Cube count and layout index, the scene's own obstacles have no count
+    int obstacles = -1;
+    unsigned int layout = 0;
+
+    unsigned long long ticks = 0;
+    // Tick at which the last wave faded, 0 if it was still alive at the tick limit
+    unsigned long long decayTick = 0;
+
+    SimulationCounters counters;
+    std::vector<unsigned long long> absorbed;
+
+    double wallSeconds = 0.0;
+    // Read from the result cache instead of simulated
+    bool cached = false;
+};
+
+/**
+ * \brief Runs every combination of a sweep without a window or GL context.
+ *
+ * Runs are simulated side by side, each on its own scene. The threads are
+ * split between runs so the machine is never oversubscribed: with more
+ * runs than cores every run simulates on one thread, fewer runs get pool
+ * workers. Model files are imported once, every run copies the shared
+ * model-space templates and its waves share one wave shape. Ticks without
+ * events are leapt over with Scene::fastForward.
+ *
+ * Rows are written in run order as soon as the runs before them finished,
+ * an interrupted sweep keeps what was written.
+ *
+ * With a result cache a run whose scene content, tick count and tick time
+ * were simulated before is read from it instead, so repeated sweeps only
+ * simulate what changed.
+ */
+class BatchRunner
+{
+public:
+    BatchRunner(MeshCache& meshCache, const SweepSpec& spec, unsigned int threads = 0, ResultCache* resultCache = nullptr);
+
+    bool run(const std::string& csvPath);
+
+private:
+    MeshCache& meshCache;
+    SweepSpec spec;
+    unsigned int threads;
+    ResultCache* resultCache;
+
+    SceneDescription description;
+    std::vector<WaveSourceDescription> sources;
+    unsigned int layoutCount = 1;
+    unsigned int runCount = 0;
+    unsigned int obstacleColumns = 0;
+
+    std::atomic<unsigned int> nextRun{ 0 };
+    std::mutex mutex;
+    std::vector<SweepResult> results;
+    std::vector<bool> finished;
+    unsigned int written = 0;
+    std::ofstream csv;
+
+    bool prepare();
+    void work(unsigned int workerCount);
+    void runOne(unsigned int run, unsigned int workerCount, SweepResult& result);
+    void getLayout(unsigned int layout, SweepResult& result, std::vector<ObstacleDescription>& obstacles);
+    void writeRow(const SweepResult& result);
+
+    static void encodeResult(const SweepResult& result, std::vector<unsigned char>& data);
+    static bool decodeResult(const std::vector<unsigned char>& data, SweepResult& result);
+
+    static float uniform(std::mt19937& random, float min, float max);
+};
\ No newline at end of file
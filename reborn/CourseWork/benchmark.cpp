@@ -0,0 +1,89 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+
+Benchmark::Benchmark(const std::string& filter, float minTime) : filter(filter), minTime(minTime)
+{
+}
+
+bool Benchmark::isSelected(const std::string& name)
+{
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void Benchmark::run(const std::string& name, const std::string& parameters, const char* unit, const std::function<double()>& body)
+{
+    if (!isSelected(name))
+        return;
+
+    BenchmarkResult result;
+    double elapsed = 0.0;
+
+    result.name = name;
+    result.parameters = parameters;
+    result.unit = unit;
+
+    body();
+
+    samples.clear();
+    while ((elapsed < minTime || samples.size() < MIN_ITERATIONS) && samples.size() < MAX_ITERATIONS)
+    {
+        auto start = std::chrono::steady_clock::now();
+        result.items = body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        samples.push_back(seconds);
+        elapsed += seconds;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    result.iterations = samples.size();
+    result.medianSeconds = samples[samples.size() / 2];
+    result.minSeconds = samples[0];
+    result.throughput = result.medianSeconds > 0.0 ? result.items / result.medianSeconds : 0.0;
+
+    std::cout << std::left << std::setw(20) << name << std::setw(24) << parameters
+        << std::right << std::setw(12) << std::fixed << std::setprecision(1) << result.medianSeconds * 1e6 << " us  "
+        << std::setw(14) << std::setprecision(0) << result.throughput << " " << unit << std::endl;
+
+    results.push_back(result);
+}
+
+bool Benchmark::writeJson(const std::string& path)
+{
+    std::ofstream file(path);
+    unsigned int i;
+
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open benchmark output: " << path << std::endl;
+        return false;
+    }
+
+    file << std::setprecision(9) << "{\"benchmarks\":[\n";
+
+    for (i = 0; i < results.size(); ++i)
+    {
+        const BenchmarkResult& result = results[i];
+
+        file << (i ? ",\n" : "") << "{\"name\":\"" << result.name << "\",\"parameters\":\"" << result.parameters
+            << "\",\"iterations\":" << result.iterations
+            << ",\"median_ns\":" << result.medianSeconds * 1e9
+            << ",\"min_ns\":" << result.minSeconds * 1e9
+            << ",\"items\":" << result.items
+            << ",\"throughput\":" << result.throughput
+            << ",\"unit\":\"" << result.unit << "\"}";
+    }
+
+    file << "\n]}\n";
+
+    std::cout << results.size() << " results written to " << path << std::endl;
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief Timing of one benchmark case
+ */
+struct BenchmarkResult
+{
+    std::string name;
+    std::string parameters;
+    std::string unit;
+
+    unsigned int iterations = 0;
+    double medianSeconds = 0.0;
+    double minSeconds = 0.0;
+    double items = 0.0;
+    double throughput = 0.0;
+};
+
+/**
+ * \brief Runs benchmark cases and writes their results as JSON.
+ *
+ * A case body does one iteration and returns the amount of work it did in
+ * the case unit (vertices, tests, megabytes...). After one untimed warmup
+ * iteration the body repeats until minTime has passed and at least
+ * MIN_ITERATIONS ran, throughput is work per median iteration.
+ */
+class Benchmark
+{
+public:
+    static const unsigned int MIN_ITERATIONS = 3;
+    static const unsigned int MAX_ITERATIONS = 100000;
+
+    Benchmark(const std::string& filter, float minTime);
+
+    bool isSelected(const std::string& name);
+    void run(const std::string& name, const std::string& parameters, const char* unit, const std::function<double()>& body);
+
+    bool writeJson(const std::string& path);
+
+private:
+    std::string filter;
+    float minTime;
+
+    std::vector<BenchmarkResult> results;
+    std::vector<double> samples;
+};
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include "benchmark.hpp"
+#include "scenario.hpp"
+#include "loader.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+#include "obstacle.hpp"
+#include "metrics.hpp"
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include <sstream>
+
+
+const char* CUBE_MODEL = "models/cube.obj";
+const char* ROOM_MODEL = "models/room.obj";
+const char* SPHERE_MODEL = "models/sphere_very_big.obj";
+
+/**
+ * \brief Obstacle counts of the collision cases
+ */
+const unsigned int OBSTACLE_COUNTS[] = { 1, 10, 100, 1000, 10000 };
+
+/**
+ * \brief Wave time after which every vertex of a wave is outside the room
+ */
+const float OUTSIDE_TIME = 1e6f;
+
+void runImportCases(Benchmark& benchmark, Loader& loader);
+void runWaveCases(Benchmark& benchmark, Sphere& source);
+void runCollisionCases(Benchmark& benchmark, Sphere& source, Obstacle& cube);
+void runUploadCases(Benchmark& benchmark, Sphere& source);
+
+void addCubes(Scene& scene, Obstacle& cube, unsigned int count);
+std::vector<unsigned int> parseCounts(const char* list);
+
+
+int main(int argc, char* argv[])
+{
+    std::string filter, output = "benchmark.json";
+    float minTime = 0.5f;
+    bool scenario = false;
+    ScenarioSettings settings;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--filter") == 0 && hasValue)
+            filter = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && hasValue)
+            output = argv[++i];
+        else if (strcmp(argv[i], "--min-time") == 0 && hasValue)
+            minTime = static_cast<float>(atof(argv[++i]));
+        else if (strcmp(argv[i], "--scenario") == 0)
+            scenario = true;
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+            settings.seed = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--layouts") == 0 && hasValue)
+            settings.layouts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--obstacles") == 0 && hasValue)
+            settings.obstacleCounts = parseCounts(argv[++i]);
+        else if (strcmp(argv[i], "--sources") == 0 && hasValue)
+            settings.sourceCounts = parseCounts(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+            settings.warmupFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+            settings.measuredFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--csv") == 0 && hasValue)
+            settings.csvPath = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && hasValue)
+            settings.baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && hasValue)
+            settings.tolerance = static_cast<float>(atof(argv[++i]));
+        else
+        {
+            std::cout << "Usage: Benchmark [--filter <name part>] [--out <file>] [--min-time <seconds>]" << std::endl;
+            std::cout << "       Benchmark --scenario [--seed <n>] [--layouts <n>] [--obstacles <n,n,...>] [--sources <n,n,...>]" << std::endl;
+            std::cout << "                 [--warmup <frames>] [--frames <frames>] [--csv <file>] [--baseline <file>] [--tolerance <fraction>]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // GL work needs a context, the window is never shown. Software GL (e.g.
+    // LIBGL_ALWAYS_SOFTWARE=1 with Mesa) works the same for headless machines
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = scenario ?
+        glfwCreateWindow(settings.width, settings.height, "Scenario", NULL, NULL) :
+        glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (scenario)
+    {
+        bool passed = true;
+
+        {
+            Loader loader;
+            loader.setVerbose(false);
+            Shader shader("shaders/shader.vert", "shaders/shader.frag");
+
+            ScenarioRunner runner(loader, shader, settings);
+            runner.run();
+            runner.writeCsv(settings.csvPath);
+
+            if (!settings.baselinePath.empty())
+                passed = runner.compare(settings.baselinePath);
+        }
+
+        glfwTerminate();
+
+        return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    Benchmark benchmark(filter, minTime);
+    Loader loader;
+    loader.setVerbose(false);
+
+    runImportCases(benchmark, loader);
+
+    // Sources as the GUI creates them
+    glm::mat4 identity = glm::mat4(1.0f);
+    glm::vec4 waveColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.1f);
+    glm::vec4 cubeColor = glm::vec4(0.2f, 0.3f, 0.4f, 1.0f);
+    float waveSpeed = 25.0f;
+
+    Sphere source(identity, waveColor, waveSpeed, false);
+    loader.loadModel(SPHERE_MODEL, source);
+
+    Obstacle cube(identity, cubeColor, GL_BACK);
+    loader.loadModel(CUBE_MODEL, cube);
+
+    if (source.getVertices().empty() || cube.getFaces().size() < 6)
+        std::cout << "Models are missing, only import cases ran" << std::endl;
+    else
+    {
+        runWaveCases(benchmark, source);
+        runCollisionCases(benchmark, source, cube);
+        runUploadCases(benchmark, source);
+    }
+
+    source.releaseMeshes();
+    cube.releaseMeshes();
+
+    benchmark.writeJson(output);
+
+    glfwTerminate();
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Loader::loadModel of the models the application uses
+ */
+void runImportCases(Benchmark& benchmark, Loader& loader)
+{
+    const char* models[] = { CUBE_MODEL, ROOM_MODEL, SPHERE_MODEL };
+    glm::mat4 identity = glm::mat4(1.0f);
+    glm::vec4 color = glm::vec4(1.0f);
+
+    for (const char* path : models)
+        benchmark.run("load_model", path, "vertices/s", [&]()
+        {
+            Obstacle model(identity, color, GL_BACK);
+
+            loader.loadModel(path, model);
+            model.releaseMeshes();
+
+            return static_cast<double>(model.getVertices().size());
+        });
+}
+
+/**
+ * \brief Vertex advance with and without room reflections, the face pass and wave launch
+ */
+void runWaveCases(Benchmark& benchmark, Sphere& source)
+{
+    Scene scene;
+    WaveEvents events;
+
+    Sphere wave(static_cast<Model&>(source));
+    unsigned int vertices = wave.getVertexCount();
+    std::string parameters = "vertices=" + std::to_string(vertices);
+
+    // Without finishUpdate the chunk update leaves the wave state unchanged
+    benchmark.run("wave_advance", parameters + " inside", "vertices/s", [&]()
+    {
+        wave.updateVertices(scene, 0.0f, 0, vertices, events);
+        return static_cast<double>(vertices);
+    });
+
+    benchmark.run("wave_advance", parameters + " reflected", "vertices/s", [&]()
+    {
+        wave.updateVertices(scene, OUTSIDE_TIME, 0, vertices, events);
+        return static_cast<double>(vertices);
+    });
+
+    wave.beginUpdate();
+    wave.updateVertices(scene, 0.0f, 0, vertices, events);
+
+    benchmark.run("face_pass", "triangles=" + std::to_string(wave.getTriangleCount()), "triangles/s", [&]()
+    {
+        wave.finishUpdate(0.0f, nullptr, 0);
+        return static_cast<double>(wave.getTriangleCount());
+    });
+
+    wave.releaseMeshes();
+
+    benchmark.run("sphere_clone", parameters, "vertices/s", [&]()
+    {
+        Sphere clone(static_cast<Model&>(source));
+        clone.releaseMeshes();
+
+        return static_cast<double>(clone.getVertexCount());
+    });
+}
+
+/**
+ * \brief One vertex chunk against a growing number of cubes that it never hits
+ */
+void runCollisionCases(Benchmark& benchmark, Sphere& source, Obstacle& cube)
+{
+    WaveEvents events;
+    Sphere wave(static_cast<Model&>(source));
+    unsigned int vertices = std::min(wave.getVertexCount(), Scene::CHUNK_SIZE);
+
+    for (unsigned int count : OBSTACLE_COUNTS)
+    {
+        Scene scene;
+        addCubes(scene, cube, count);
+
+        benchmark.run("obstacle_tests", "obstacles=" + std::to_string(count), "tests/s", [&]()
+        {
+            SimulationCounters& counters = Metrics::get().localSlot().counters;
+            unsigned long long tests = counters.vertexObstacleTests;
+
+            wave.updateVertices(scene, 0.0f, 0, vertices, events);
+
+            return static_cast<double>(counters.vertexObstacleTests - tests);
+        });
+    }
+
+    wave.releaseMeshes();
+}
+
+/**
+ * \brief Position streaming of a whole wave and of a tenth of it
+ */
+void runUploadCases(Benchmark& benchmark, Sphere& source)
+{
+    Sphere wave(static_cast<Model&>(source));
+    Mesh& mesh = wave.getMeshes()[0];
+    unsigned int vertices = wave.getVertexCount();
+    unsigned int counts[] = { vertices, vertices / 10 };
+    std::vector<glm::vec3> positions(vertices);
+    unsigned int i;
+
+    for (i = 0; i < vertices; ++i)
+        positions[i] = source.getVertices()[i].Position;
+
+    for (unsigned int count : counts)
+        benchmark.run("upload", "vertices=" + std::to_string(count), "MB/s", [&]()
+        {
+            mesh.upload(positions, 0, count);
+            return count * sizeof(glm::vec3) / 1e6;
+        });
+
+    glFinish();
+    wave.releaseMeshes();
+}
+
+void addCubes(Scene& scene, Obstacle& cube, unsigned int count)
+{
+    glm::vec4 color = cube.getColor();
+    unsigned int i;
+
+    for (i = 0; i < count; ++i)
+    {
+        // Away from the wave, in a corner of the room
+        glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(15.0f, 15.0f, 15.0f - (i % 10)));
+        Obstacle* obstacle = new Obstacle(modelMatrix, color, GL_BACK);
+
+        for (auto& vertex : cube.getVertices())
+            obstacle->pushVertex(vertex);
+        for (auto& face : cube.getFaces())
+            obstacle->pushFace(face);
+        obstacle->toWorld();
+
+        scene.addObject(obstacle);
+
+        // Edits go through the command queue, apply them before it fills up
+        if (i % (CommandQueue::CAPACITY / 2) == 0)
+            scene.flush();
+    }
+
+    scene.flush();
+}
+
+std::vector<unsigned int> parseCounts(const char* list)
+{
+    std::vector<unsigned int> counts;
+    std::istringstream fields(list);
+    std::string field;
+
+    while (std::getline(fields, field, ','))
+        if (!field.empty())
+            counts.push_back(atoi(field.c_str()));
+
+    return counts;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "camerapath.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+
+bool CameraPath::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open camera path: " << path << std::endl;
+        return false;
+    }
+
+    std::string text;
+    unsigned int lineNumber = 0;
+
+    while (std::getline(file, text))
+    {
+        ++lineNumber;
+
+        std::istringstream line(text.substr(0, text.find('#')));
+        float tick, yaw, pitch;
+        glm::vec3 position;
+
+        if (!(line >> tick))
+            continue;
+
+        if (!(line >> position.x >> position.y >> position.z >> yaw >> pitch))
+        {
+            std::cout << "Camera path line " << lineNumber << " is not valid: " << text << std::endl;
+            return false;
+        }
+
+        addKey(tick, position, yaw, pitch);
+    }
+
+    return true;
+}
+
+void CameraPath::addKey(float tick, const glm::vec3& position, float yaw, float pitch)
+{
+    Key key = { tick, position, yaw, pitch };
+
+    auto next = std::upper_bound(keys.begin(), keys.end(), tick,
+        [](float value, const Key& other) { return value < other.tick; });
+    keys.insert(next, key);
+}
+
+bool CameraPath::isEmpty()
+{
+    return keys.empty();
+}
+
+Camera CameraPath::getCamera(float tick)
+{
+    if (keys.empty())
+        return Camera();
+
+    auto next = std::upper_bound(keys.begin(), keys.end(), tick,
+        [](float value, const Key& other) { return value < other.tick; });
+
+    const Key& first = next == keys.begin() ? *next : *(next - 1);
+    const Key& second = next == keys.end() ? keys.back() : *next;
+
+    float span = second.tick - first.tick;
+    float t = span > 0.0f ? glm::clamp((tick - first.tick) / span, 0.0f, 1.0f) : 0.0f;
+
+    return Camera(glm::mix(first.position, second.position, t), glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::mix(first.yaw, second.yaw, t), glm::mix(first.pitch, second.pitch, t));
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "camera.hpp"
+
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief Camera keyframes over simulation ticks for offline rendering.
+ *
+ * Text file, one key per line: tick, position x y z, yaw and pitch in
+ * degrees, '#' starts a comment. Between keys position and angles are
+ * interpolated linearly, before the first and after the last key the
+ * camera holds still.
+ */
+class CameraPath
+{
+public:
+    bool load(const std::string& path);
+    void addKey(float tick, const glm::vec3& position, float yaw, float pitch);
+
+    bool isEmpty();
+    Camera getCamera(float tick);
+
+private:
+    struct Key
+    {
+        float tick;
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+    };
+
+    // Sorted by tick
+    std::vector<Key> keys;
+};
\ No newline at end of file
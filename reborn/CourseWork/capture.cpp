@@ -0,0 +1,126 @@
+#include "capture.hpp"
+#include "trace.hpp"
+
+#include <cstring>
+
+
+/**
+ * \brief Longest wait for a readback, a second
+ */
+static const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+FrameCapture::FrameCapture(FrameWriter& writer, unsigned int width, unsigned int height, bool dropFrames) :
+    writer(writer),
+    width(width),
+    height(height),
+    dropFrames(dropFrames)
+{
+    unsigned int i;
+
+    slots.resize(RING);
+    for (i = 0; i < RING; ++i)
+    {
+        glGenBuffers(1, &slots[i].bufferID);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].bufferID);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 3, NULL, GL_STREAM_READ);
+        slots[i].fence = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameCapture::~FrameCapture()
+{
+    release();
+}
+
+void FrameCapture::capture()
+{
+    TRACE_SCOPE("FrameCapture::capture");
+
+    Slot& slot = slots[current];
+
+    // The readback issued RING frames ago
+    if (slot.fence)
+        collect(slot);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    current = (current + 1) % RING;
+}
+
+void FrameCapture::flush()
+{
+    unsigned int i;
+
+    // Oldest first, so the writer gets the frames in order
+    for (i = 0; i < RING; ++i)
+    {
+        Slot& slot = slots[(current + i) % RING];
+        if (slot.fence)
+            collect(slot);
+    }
+}
+
+void FrameCapture::release()
+{
+    for (Slot& slot : slots)
+    {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.bufferID);
+    }
+
+    slots.clear();
+}
+
+unsigned int FrameCapture::getCapturedCount()
+{
+    return captured;
+}
+
+unsigned int FrameCapture::getDroppedCount()
+{
+    return dropped;
+}
+
+void FrameCapture::collect(Slot& slot)
+{
+    TRACE_SCOPE("FrameCapture::collect");
+
+    // A dropped frame is never mapped
+    unsigned char* pixels = dropFrames ? writer.tryAcquire() : writer.acquire();
+
+    if (pixels)
+    {
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+        void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * 3, GL_MAP_READ_BIT);
+        if (data)
+        {
+            memcpy(pixels, data, width * height * 3);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (data)
+        {
+            writer.submit(pixels);
+            ++captured;
+        }
+        else
+        {
+            writer.cancel(pixels);
+            ++dropped;
+        }
+    }
+    else
+        ++dropped;
+
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+}
\ No newline at end of file
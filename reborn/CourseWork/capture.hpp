@@ -0,0 +1,55 @@
+#pragma once
+
+#include "framewriter.hpp"
+
+#include <glad/glad.h>
+
+#include <vector>
+
+
+/**
+ * \brief Reads rendered frames back without stalling the pipeline.
+ *
+ * capture() starts an asynchronous glReadPixels of the bound read
+ * framebuffer into the next pixel buffer object of a ring and fences it.
+ * The buffer is mapped only when the ring comes around to it again, RING
+ * frames later, when the copy has long finished, and its pixels go to the
+ * frame writer. With dropFrames a frame the writer has no free buffer for
+ * is dropped, so a slow disk never slows the application down, otherwise
+ * capture() waits for the writer.
+ */
+class FrameCapture
+{
+public:
+    static const unsigned int RING = 3;
+
+    FrameCapture(FrameWriter& writer, unsigned int width, unsigned int height, bool dropFrames);
+    ~FrameCapture();
+
+    void capture();
+    void flush();
+    void release();
+
+    unsigned int getCapturedCount();
+    unsigned int getDroppedCount();
+
+private:
+    struct Slot
+    {
+        unsigned int bufferID;
+        GLsync fence;
+    };
+
+    FrameWriter& writer;
+    unsigned int width;
+    unsigned int height;
+    bool dropFrames;
+
+    std::vector<Slot> slots;
+    unsigned int current = 0;
+
+    unsigned int captured = 0;
+    unsigned int dropped = 0;
+
+    void collect(Slot& slot);
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "command.hpp"
+
+
+void CommandQueue::push(const SceneCommand& command)
+{
+    unsigned int currentTail = tail.load(std::memory_order_relaxed);
+
+    // A spill in progress keeps later commands behind it
+    if (!overflowing.load(std::memory_order_relaxed) && currentTail - head.load(std::memory_order_acquire) < CAPACITY)
+    {
+        commands[currentTail % CAPACITY] = command;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    overflow.push_back(command);
+    overflowing.store(true, std::memory_order_release);
+}
+
+bool CommandQueue::pop(SceneCommand& command)
+{
+    unsigned int currentHead = head.load(std::memory_order_relaxed);
+
+    // Spilled commands were pushed after everything left in the ring
+    if (spilledNext < spilled.size())
+    {
+        command = spilled[spilledNext++];
+        return true;
+    }
+
+    if (currentHead == tail.load(std::memory_order_acquire))
+    {
+        if (!overflowing.load(std::memory_order_acquire))
+            return false;
+
+        std::lock_guard<std::mutex> lock(overflowMutex);
+
+        // The ring may have filled up again before the lock, its commands come first
+        if (currentHead == tail.load(std::memory_order_acquire))
+        {
+            if (overflow.empty())
+                return false;
+
+            // Whatever the producer pushes from here on is newer than the spill
+            spilled.clear();
+            spilled.swap(overflow);
+            spilledNext = 0;
+            overflowing.store(false, std::memory_order_relaxed);
+
+            command = spilled[spilledNext++];
+            return true;
+        }
+    }
+
+    command = commands[currentHead % CAPACITY];
+    head.store(currentHead + 1, std::memory_order_release);
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+class Model;
+
+/**
+ * \brief Scene edit produced by the GUI and applied by the simulation
+ */
+struct SceneCommand
+{
+    enum Type
+    {
+        ADD_OBJECT,
+        REMOVE_OBJECT,
+        UPDATE_OBJECT_COLOR,
+        ADD_SPHERE
+    };
+
+    Type type;
+    Model* model;
+    int index;
+    glm::vec4 color;
+};
+
+/**
+ * \brief Lock-free single-producer single-consumer queue of scene commands.
+ * The GUI thread pushes, the simulation thread pops at tick boundaries.
+ * Past the capacity commands spill into a locked list and keep their
+ * order, a push never waits for the consumer.
+ */
+class CommandQueue
+{
+public:
+    static const unsigned int CAPACITY = 256;
+
+    void push(const SceneCommand& command);
+    bool pop(SceneCommand& command);
+
+private:
+    SceneCommand commands[CAPACITY];
+
+    // Separate cache lines so producer and consumer do not share one
+    alignas(64) std::atomic<unsigned int> head{ 0 };
+    alignas(64) std::atomic<unsigned int> tail{ 0 };
+
+    // Pushed while the ring was full or still spilling, newer than everything in the ring
+    std::mutex overflowMutex;
+    std::vector<SceneCommand> overflow;
+    std::atomic<bool> overflowing{ false };
+
+    // Spilled commands taken by the consumer, popped after the ring
+    std::vector<SceneCommand> spilled;
+    unsigned int spilledNext = 0;
+};
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "framewriter.hpp"
+#include "trace.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+
+static const unsigned int BUFFERS_PER_WORKER = 2;
+
+/**
+ * \brief Largest stored deflate block
+ */
+static const unsigned int DEFLATE_BLOCK = 65535;
+static const unsigned int ADLER_RUN = 5552;
+
+static unsigned int crcTable[256];
+
+static void initCrcTable()
+{
+    unsigned int i, bit;
+
+    for (i = 0; i < 256; ++i)
+    {
+        unsigned int crc = i;
+
+        for (bit = 0; bit < 8; ++bit)
+            crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        crcTable[i] = crc;
+    }
+}
+
+static unsigned int updateCrc(unsigned int crc, const unsigned char* data, unsigned int size)
+{
+    unsigned int i;
+
+    for (i = 0; i < size; ++i)
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+static void putBigEndian(std::vector<unsigned char>& data, unsigned int value)
+{
+    data.push_back(static_cast<unsigned char>(value >> 24));
+    data.push_back(static_cast<unsigned char>(value >> 16));
+    data.push_back(static_cast<unsigned char>(value >> 8));
+    data.push_back(static_cast<unsigned char>(value));
+}
+
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data)
+{
+    std::vector<unsigned char> header;
+    unsigned int crc = 0xFFFFFFFFu;
+
+    putBigEndian(header, data.size());
+    header.insert(header.end(), type, type + 4);
+
+    crc = updateCrc(crc, &header[4], 4);
+    if (!data.empty())
+        crc = updateCrc(crc, &data[0], data.size());
+
+    std::vector<unsigned char> footer;
+    putBigEndian(footer, crc ^ 0xFFFFFFFFu);
+
+    file.write((const char*)&header[0], header.size());
+    if (!data.empty())
+        file.write((const char*)&data[0], data.size());
+    file.write((const char*)&footer[0], footer.size());
+}
+
+FrameWriter::FrameWriter(Format format, const std::string& path, unsigned int width, unsigned int height, unsigned int workerCount) :
+    format(format),
+    path(path),
+    width(width),
+    height(height)
+{
+    unsigned int i;
+
+    initCrcTable();
+
+    if (format == RAW)
+    {
+        rawFile.open(path, std::ios::binary | std::ios::trunc);
+        if (!rawFile.is_open())
+        {
+            std::cout << "Failed to open frame output: " << path << std::endl;
+            opened = false;
+            return;
+        }
+    }
+
+    if (workerCount == 0)
+        workerCount = 1;
+
+    buffers.resize(workerCount * BUFFERS_PER_WORKER);
+    for (auto& buffer : buffers)
+    {
+        buffer.resize(width * height * 3);
+        freeBuffers.push_back(&buffer[0]);
+    }
+
+    for (i = 0; i < workerCount; ++i)
+        workers.push_back(std::thread(&FrameWriter::run, this));
+}
+
+FrameWriter::~FrameWriter()
+{
+    finish();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    condition.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+bool FrameWriter::isOpen()
+{
+    return opened;
+}
+
+unsigned char* FrameWriter::acquire()
+{
+    TRACE_SCOPE("FrameWriter::acquire");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return !freeBuffers.empty(); });
+
+    unsigned char* pixels = freeBuffers.back();
+    freeBuffers.pop_back();
+
+    return pixels;
+}
+
+/**
+ * \brief Same as acquire(), but returns nullptr instead of waiting
+ */
+unsigned char* FrameWriter::tryAcquire()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (freeBuffers.empty())
+        return nullptr;
+
+    unsigned char* pixels = freeBuffers.back();
+    freeBuffers.pop_back();
+
+    return pixels;
+}
+
+void FrameWriter::submit(unsigned char* pixels)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back({ pixels, submitted++ });
+    }
+    condition.notify_all();
+}
+
+/**
+ * \brief Returns an acquired buffer without writing a frame
+ */
+void FrameWriter::cancel(unsigned char* pixels)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeBuffers.push_back(pixels);
+    }
+    condition.notify_all();
+}
+
+void FrameWriter::finish()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return written == submitted; });
+
+    if (rawFile.is_open())
+        rawFile.flush();
+}
+
+unsigned int FrameWriter::getWrittenCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return written;
+}
+
+void FrameWriter::run()
+{
+    TRACE_THREAD("frame writer");
+
+    // Flipped rows of the current frame
+    std::vector<unsigned char> rows(width * height * 3);
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        condition.wait(lock, [this] { return !jobs.empty() || !running; });
+        if (jobs.empty())
+            return;
+
+        Job job = jobs.front();
+        jobs.pop_front();
+
+        lock.unlock();
+        encode(job, rows);
+        lock.lock();
+
+        freeBuffers.push_back(job.pixels);
+        ++written;
+        condition.notify_all();
+    }
+}
+
+void FrameWriter::encode(const Job& job, std::vector<unsigned char>& rows)
+{
+    TRACE_SCOPE("FrameWriter::encode");
+
+    unsigned int rowSize = width * 3, y;
+
+    // GL reads the bottom row first
+    for (y = 0; y < height; ++y)
+        memcpy(&rows[y * rowSize], job.pixels + (height - 1 - y) * rowSize, rowSize);
+
+    if (format == PNG)
+    {
+        char name[1024];
+        snprintf(name, sizeof(name), path.c_str(), job.frame);
+
+        if (!writePng(name, &rows[0], width, height))
+            std::cout << "Failed to write frame: " << name << std::endl;
+        return;
+    }
+
+    // The raw stream keeps frame order, a worker that got ahead waits for its turn
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this, &job] { return nextRawFrame == job.frame; });
+
+    rawFile.write((const char*)&rows[0], rows.size());
+
+    ++nextRawFrame;
+    condition.notify_all();
+}
+
+/**
+ * \brief Files ending with .rgb or .raw are raw streams, anything else is a PNG pattern
+ */
+FrameWriter::Format FrameWriter::getFormat(const std::string& path)
+{
+    const char* extensions[] = { ".rgb", ".raw" };
+
+    for (const char* extension : extensions)
+    {
+        size_t length = strlen(extension);
+        if (path.size() >= length && path.compare(path.size() - length, length, extension) == 0)
+            return RAW;
+    }
+
+    return PNG;
+}
+
+/**
+ * \brief Writes 8-bit RGB rows, top row first. The image data is kept in
+ * stored deflate blocks, so encoding costs about as much as copying it
+ */
+bool FrameWriter::writePng(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write((const char*)signature, sizeof(signature));
+
+    std::vector<unsigned char> header;
+    putBigEndian(header, width);
+    putBigEndian(header, height);
+    header.push_back(8);    // bit depth
+    header.push_back(2);    // RGB
+    header.push_back(0);    // deflate
+    header.push_back(0);    // adaptive filtering
+    header.push_back(0);    // no interlace
+    writeChunk(file, "IHDR", header);
+
+    // Scanlines with filter type 0 in front of each row
+    unsigned int rowSize = width * 3, y;
+    std::vector<unsigned char> scanlines(height * (rowSize + 1));
+
+    for (y = 0; y < height; ++y)
+    {
+        scanlines[y * (rowSize + 1)] = 0;
+        memcpy(&scanlines[y * (rowSize + 1) + 1], pixels + y * rowSize, rowSize);
+    }
+
+    // zlib stream: header, stored blocks, Adler-32 of the scanlines
+    std::vector<unsigned char> data;
+    unsigned int offset = 0, a = 1, b = 0, i;
+
+    data.reserve(scanlines.size() + scanlines.size() / DEFLATE_BLOCK * 5 + 16);
+    data.push_back(0x78);
+    data.push_back(0x01);
+
+    do
+    {
+        unsigned int size = scanlines.size() - offset < DEFLATE_BLOCK ? scanlines.size() - offset : DEFLATE_BLOCK;
+        bool last = offset + size == scanlines.size();
+
+        data.push_back(last ? 1 : 0);
+        data.push_back(static_cast<unsigned char>(size));
+        data.push_back(static_cast<unsigned char>(size >> 8));
+        data.push_back(static_cast<unsigned char>(~size));
+        data.push_back(static_cast<unsigned char>(~size >> 8));
+        data.insert(data.end(), scanlines.begin() + offset, scanlines.begin() + offset + size);
+
+        offset += size;
+    } while (offset < scanlines.size());
+
+    // Sums stay below 2^32 for 5552 bytes, so the modulo is taken once per run
+    for (offset = 0; offset < scanlines.size(); offset += ADLER_RUN)
+    {
+        unsigned int end = scanlines.size() - offset < ADLER_RUN ? scanlines.size() : offset + ADLER_RUN;
+
+        for (i = offset; i < end; ++i)
+        {
+            a += scanlines[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    putBigEndian(data, (b << 16) | a);
+
+    writeChunk(file, "IDAT", data);
+    writeChunk(file, "IEND", std::vector<unsigned char>());
+
+    return static_cast<bool>(file);
+}
\ No newline at end of file
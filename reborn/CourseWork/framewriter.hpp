@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * \brief Writes rendered frames on worker threads.
+ *
+ * The renderer reads pixels into a buffer from acquire() and hands it back
+ * with submit(), workers flip and encode it while the next frames are
+ * simulated and drawn. PNG frames go to one file each, path is a printf
+ * pattern taking the frame number. Raw frames are appended in order to a
+ * single RGB24 stream. acquire() blocks while every buffer is in flight.
+ */
+class FrameWriter
+{
+public:
+    enum Format
+    {
+        PNG,
+        RAW
+    };
+
+    FrameWriter(Format format, const std::string& path, unsigned int width, unsigned int height, unsigned int workerCount);
+    ~FrameWriter();
+
+    bool isOpen();
+
+    unsigned char* acquire();
+    unsigned char* tryAcquire();
+    void submit(unsigned char* pixels);
+    void cancel(unsigned char* pixels);
+    void finish();
+
+    unsigned int getWrittenCount();
+
+    static Format getFormat(const std::string& path);
+    static bool writePng(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height);
+
+private:
+    struct Job
+    {
+        unsigned char* pixels;
+        unsigned int frame;
+    };
+
+    Format format;
+    std::string path;
+    unsigned int width;
+    unsigned int height;
+    bool opened = true;
+
+    std::ofstream rawFile;
+
+    // Pixels as read from GL, bottom row first
+    std::vector<std::vector<unsigned char>> buffers;
+    std::vector<unsigned char*> freeBuffers;
+    std::deque<Job> jobs;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    unsigned int submitted = 0;
+    unsigned int written = 0;
+    // Next frame of the raw stream, later frames wait for it
+    unsigned int nextRawFrame = 0;
+    bool running = true;
+
+    void run();
+    void encode(const Job& job, std::vector<unsigned char>& rows);
+};
\ No newline at end of file
@@ -4,16 +4,25 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include "profiler.hpp"
+#include "meshcache.hpp"
+#include "scenefile.hpp"
+#include "session.hpp"
+#include "trajectory.hpp"
+#include "timeline.hpp"
+
 #include <glm/glm.hpp>
 
+#include <algorithm>
+
 #pragma execution_character_set("utf-8")
 
 
 class Gui 
 {
 public:
-    Gui(GLFWwindow* window, Loader& modelsLoader, Scene& scene, Shader& shader) : 
-        modelsLoader(modelsLoader), 
+    Gui(GLFWwindow* window, MeshCache& meshCache, Scene& scene, Shader& shader) : 
+        meshCache(meshCache), 
         scene(scene),
         shader(shader),
         newObject(nullptr)
@@ -100,12 +109,11 @@ public:
 
             modelMatrix = glm::translate(modelMatrix, objectPosition);
 
-            glm::vec4 modelColor = glm::vec4(objectColor[0], objectColor[1], objectColor[2], 1);
-
-            newObject = new Obstacle(modelMatrix, modelColor, GL_BACK);
-            modelsLoader.loadModel(cubeModel, *newObject);
-            scene.addObject(newObject);
-            ++modelsCount;
+            SessionEvent event;
+            event.type = SessionEvent::ADD_OBSTACLE;
+            event.matrix = modelMatrix;
+            event.color = glm::vec4(objectColor[0], objectColor[1], objectColor[2], 1);
+            Submit(event);
         }
 
         if (!showDeleteMenu && ImGui::Button(" ", ImVec2(300, 40)) && modelsCount > 0)
@@ -126,24 +134,27 @@ public:
             if (prevDeletedModelIndex != deletedModelIndex)
              {
                 if (prevDeletedModelIndex != -1)
-                    scene.updateObjectColor(lastColor, prevDeletedModelIndex);
+                    SubmitObjectColor(lastColor, prevDeletedModelIndex);
                 prevDeletedModelIndex = deletedModelIndex;
                 lastColor = scene.getObjectColor(deletedModelIndex);
-                scene.updateObjectColor(deletedObjectColor, deletedModelIndex);
+                SubmitObjectColor(deletedObjectColor, deletedModelIndex);
             }
 
             if (ImGui::Button(" ", ImVec2(300, 40)))
                 if (deletedModelIndex >= 0 && deletedModelIndex < modelsCount)
                 {
-                    scene.removeObject(deletedModelIndex);
+                    SessionEvent event;
+                    event.type = SessionEvent::REMOVE_OBSTACLE;
+                    event.index = deletedModelIndex;
+                    Submit(event);
+
                     showDeleteMenu = false;
                     deletedModelNum = 1;
                     prevDeletedModelIndex = -1;
-                    --modelsCount;
                 }
             if (ImGui::Button("", ImVec2(300, 40)))
             {
-                scene.updateObjectColor(lastColor, deletedModelIndex);
+                SubmitObjectColor(lastColor, deletedModelIndex);
                 showDeleteMenu = false;
                 deletedModelNum = 1;
                 prevDeletedModelIndex = -1;
@@ -163,14 +174,19 @@ public:
 
         if (ImGui::Button("  ", ImVec2(300, 40)))
         {
-            shader.use();
-            shader.setVec3("lightColor", glm::vec3(lightingColor[0], lightingColor[1], lightingColor[2]));
-            shader.setVec3("lightPos", lightingPosition);
+            SessionEvent event;
+            event.type = SessionEvent::LIGHT;
+            event.vector = lightingPosition;
+            event.color = glm::vec4(lightingColor[0], lightingColor[1], lightingColor[2], 1);
+            Submit(event);
         }
         if (ImGui::Button("  ", ImVec2(300, 40)))
         {
-            shader.use();
-            shader.setVec3("lightColor", glm::vec3(0, 0, 0));
+            SessionEvent event;
+            event.type = SessionEvent::LIGHT;
+            event.vector = lightingPosition;
+            event.color = glm::vec4(0, 0, 0, 1);
+            Submit(event);
         }
     }
 
@@ -186,20 +202,20 @@ public:
 
         if (ImGui::Button("   ", ImVec2(300, 40)))
         {
-            glm::mat4 waveMatrix = glm::mat4(1.0f);
-
-            waveMatrix = glm::translate(waveMatrix, waveSourcePosition);
-
-            glm::vec4 newWaveColor = glm::vec4(waveColor[0], waveColor[1], waveColor[2], 0.1);
-
-            newObject = new Sphere(waveMatrix, newWaveColor, waveSpeed, false);
-            modelsLoader.loadModel(sphereModel, *newObject);
-            waves.push_back(newObject);
+            SessionEvent event;
+            event.type = SessionEvent::ADD_SOURCE;
+            event.vector = waveSourcePosition;
+            event.value = waveSpeed;
+            event.color = glm::vec4(waveColor[0], waveColor[1], waveColor[2], 0.1);
+            Submit(event);
         }
 
         if (ImGui::Button("    ", ImVec2(300, 40)))
-            for (auto& wave : waves)
-                scene.addSphere(new Sphere(*wave));
+        {
+            SessionEvent event;
+            event.type = SessionEvent::EMIT_WAVES;
+            Submit(event);
+        }
 
         if (!showDeleteMenu && ImGui::Button("  ", ImVec2(300, 40)) && waves.size() > 0)
             showDeleteMenu = true;
@@ -214,12 +230,451 @@ public:
             if (ImGui::Button(" ", ImVec2(300, 40)))
                 if (deletedWaveSourceNum - 1 >= 0 && deletedWaveSourceNum - 1 < waves.size())
                 {
-                    waves.erase(waves.begin() + deletedWaveSourceNum - 1);
+                    SessionEvent event;
+                    event.type = SessionEvent::REMOVE_SOURCE;
+                    event.index = deletedWaveSourceNum - 1;
+                    Submit(event);
+
                     showDeleteMenu = false;
                 }
             if (ImGui::Button("", ImVec2(300, 40)))
                 showDeleteMenu = false;
         }
+
+        ImGui::Text("   (0 -  )");
+        ImGui::InputInt(" ", &budgetVertices, 10000, 100000);
+        ImGui::InputInt(", ", &budgetMegabytes, 16, 256);
+        ImGui::Combo(" ", &budgetPolicy, budgetPolicyNames, WaveBudget::POLICY_COUNT);
+
+        if (ImGui::Button(" ", ImVec2(300, 40)))
+        {
+            SessionEvent event;
+            event.type = SessionEvent::WAVE_BUDGET;
+            event.index = budgetPolicy;
+            event.limits[0] = static_cast<unsigned long long>(std::max(budgetVertices, 0));
+            event.limits[1] = static_cast<unsigned long long>(std::max(budgetMegabytes, 0)) << 20;
+            Submit(event);
+        }
+    }
+
+    void RenderProfilerMenu()
+    {
+        Profiler& profiler = Profiler::get();
+        unsigned int i;
+
+        ImGui::Begin("");
+
+        ImGui::PlotLines(" ()", profiler.getHistory(Profiler::FRAME), profiler.getHistorySize(),
+            profiler.getHistoryOffset(), NULL, 0.0f, FLT_MAX, ImVec2(0, 60));
+
+        if (ImGui::BeginTable("phases", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TableSetupColumn("");
+            ImGui::TableSetupColumn(".");
+            ImGui::TableSetupColumn("p50");
+            ImGui::TableSetupColumn("p95");
+            ImGui::TableSetupColumn("p99");
+            ImGui::TableSetupColumn(".");
+            ImGui::TableHeadersRow();
+
+            for (i = 0; i < Profiler::PHASE_COUNT; ++i)
+            {
+                Profiler::Phase phase = static_cast<Profiler::Phase>(i);
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", Profiler::getName(phase));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", profiler.getLast(phase));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", profiler.getPercentile(phase, 50));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", profiler.getPercentile(phase, 95));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", profiler.getPercentile(phase, 99));
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", profiler.getAllocations(phase).count);
+            }
+
+            ImGui::EndTable();
+        }
+
+        ImGui::Text("    %u ", profiler.getHistorySize());
+        if (!AllocationTracker::isEnabled())
+            ImGui::Text("     Profile");
+
+        const WaveUsage& usage = scene.getSnapshot().waveUsage;
+        const WaveBudget& budget = scene.getSnapshot().waveBudget;
+
+        ImGui::Text(": %u,  : %llu, : %.1f ", usage.waves, usage.liveVertices, usage.bytes / (1024.0f * 1024.0f));
+        if (budget.maxLiveVertices > 0 || budget.maxBytes > 0)
+            ImGui::Text(": %llu , %llu ,  %llu,  %llu",
+                budget.maxLiveVertices, budget.maxBytes >> 20, usage.evicted, usage.refused);
+
+        ImGui::End();
+    }
+
+    void RenderReplayMenu()
+    {
+        ImGui::Begin("");
+
+        ImGui::Text(" %llu  %llu", scene.getSnapshot().tick, player->getLastTick());
+        ImGui::ProgressBar(player->getSize() > 0 ? static_cast<float>(player->getPosition()) / player->getSize() : 1.0f,
+            ImVec2(300, 0));
+        ImGui::Text(": %u  %u", player->getPosition(), player->getSize());
+
+        ImGui::End();
+    }
+
+    void RenderTrajectoryMenu()
+    {
+        ImGui::Begin("");
+
+        int frame = trajectory->getFrame();
+        int lastFrame = trajectory->getFrameCount() > 0 ? trajectory->getFrameCount() - 1 : 0;
+
+        if (ImGui::SliderInt("", &frame, 0, lastFrame))
+            trajectory->seek(frame);
+
+        if (ImGui::Button(trajectoryPlaying ? "" : "", ImVec2(300, 40)))
+            trajectoryPlaying = !trajectoryPlaying;
+
+        // Decoding speed, smoothed over about a second of frames
+        float deltaTime = ImGui::GetIO().DeltaTime;
+        unsigned long long decodedBytes = trajectory->getDecodedBytes();
+        if (deltaTime > 0.0f)
+            decodeRate += ((decodedBytes - lastDecodedBytes) / deltaTime - decodeRate) * 0.05f;
+        lastDecodedBytes = decodedBytes;
+
+        ImGui::Text(" %llu,  %u  %u", trajectory->getTick(), trajectory->getFrame() + 1, trajectory->getFrameCount());
+        ImGui::Text(": %u", trajectory->getWaveCount());
+        ImGui::Text(": %.1f /", decodeRate / (1024.0f * 1024.0f));
+
+        ImGui::End();
+    }
+
+    void RenderTimelineMenu()
+    {
+        ImGui::Begin(" ");
+
+        unsigned long long tick = scene.getSnapshot().tick;
+        float time = timeline->getTime(tick);
+
+        ImGui::Text(" %llu,  %.2f ", tick, time);
+
+        int sliderTick = static_cast<int>(tick);
+        if (ImGui::SliderInt("", &sliderTick, static_cast<int>(timeline->getFirstTick()), static_cast<int>(timeline->getLastTick())))
+            RequestSeek(sliderTick);
+
+        if (ImGui::Button("-5 ", ImVec2(90, 30)))
+            RequestSeek(timeline->getTick(time - 5.0f));
+        ImGui::SameLine();
+        if (ImGui::Button("-1 ", ImVec2(90, 30)) && tick > 0)
+            RequestSeek(tick - 1);
+        ImGui::SameLine();
+        if (ImGui::Button("+5 ", ImVec2(90, 30)))
+            RequestSeek(timeline->getTick(time + 5.0f));
+
+        ImGui::InputFloat(", ", &seekTime);
+        if (ImGui::Button("", ImVec2(300, 30)))
+            RequestSeek(timeline->getTick(seekTime));
+
+        ImGui::Text(" : %u, %.1f ", timeline->getCheckpointCount(), timeline->getSize() / (1024.0f * 1024.0f));
+        ImGui::Text(": %.1f ,    %llu,   %llu",
+            timeline->getSeekTime(), timeline->getLeaptTicks(), timeline->getSimulatedTicks());
+
+        ImGui::End();
+    }
+
+    void RenderSceneMenu()
+    {
+        if (ImGui::Button(" ", ImVec2(300, 40)))
+            SceneFile::save(sceneTextPath, GetSceneDescription());
+        if (ImGui::Button("  ()", ImVec2(300, 40)))
+            SceneFile::save(sceneBinaryPath, GetSceneDescription());
+
+        ImGui::Text(": %s, %s", sceneTextPath, sceneBinaryPath);
+    }
+
+    /**
+     * \brief Adds the obstacles, wave sources and light of a scene file, sources emit at their launch time.
+     * Called before the simulation starts, the scene takes the obstacles right away
+     */
+    void LoadScene(const SceneDescription& description)
+    {
+        unsigned int i;
+
+        lightingPosition = description.light.position;
+        for (i = 0; i < 3; ++i)
+            lightingColor[i] = description.light.color[i];
+
+        shader.use();
+        shader.setVec3("lightColor", description.light.color);
+        shader.setVec3("lightPos", lightingPosition);
+
+        sphereModel = description.waveMesh;
+        room = description.room;
+
+        for (const ObstacleDescription& obstacle : description.obstacles)
+        {
+            glm::mat4 modelMatrix = obstacle.modelMatrix;
+            glm::vec4 modelColor = obstacle.color;
+
+            newObject = new Obstacle(modelMatrix, modelColor, obstacle.cullMode);
+            meshCache.loadModel(obstacle.mesh, *newObject);
+            scene.addObject(newObject);
+            scene.flush();
+            objectMeshes.push_back(obstacle.mesh);
+            ++modelsCount;
+        }
+
+        for (const WaveSourceDescription& source : description.sources)
+        {
+            glm::mat4 waveMatrix = glm::translate(glm::mat4(1.0f), source.position);
+            glm::vec4 sourceColor = source.color;
+            float sourceSpeed = source.speed;
+
+            newObject = new Sphere(waveMatrix, sourceColor, sourceSpeed, false);
+            meshCache.loadModel(sphereModel, *newObject);
+            waves.push_back(newObject);
+            waveLaunchTimes.push_back(source.launchTime);
+            waveLaunches.push_back(std::make_pair(source.launchTime, newObject));
+        }
+    }
+
+    /**
+     * \brief Emits the waves of loaded sources whose launch time has come.
+     * A replay takes the launches from the log instead of the clock
+     */
+    void LaunchWaves(float sceneTime)
+    {
+        unsigned int i;
+
+        if (player || trajectory)
+            return;
+
+        for (i = 0; i < waveLaunches.size(); ++i)
+            if (waveLaunches[i].first <= sceneTime)
+            {
+                SessionEvent event;
+                event.type = SessionEvent::EMIT_SOURCE;
+                event.index = std::find(waves.begin(), waves.end(), waveLaunches[i].second) - waves.begin();
+
+                waveLaunches.erase(waveLaunches.begin() + i--);
+                Submit(event);
+            }
+    }
+
+    /**
+     * \brief Records edits made in the menus to recorder, or replaces the menus
+     * with the progress of player while a session log is replayed
+     */
+    void SetSession(SessionRecorder* recorder, SessionPlayer* player)
+    {
+        this->recorder = recorder;
+        this->player = player;
+    }
+
+    /**
+     * \brief Replaces the menus with the frame controls of a played trajectory
+     */
+    void SetTrajectory(TrajectoryPlayer* trajectory)
+    {
+        this->trajectory = trajectory;
+    }
+
+    /**
+     * \brief Adds the time controls, seeks are taken by the render loop while the simulation is idle
+     */
+    void SetTimeline(Timeline* timeline)
+    {
+        this->timeline = timeline;
+    }
+
+    bool TakeSeekRequest(unsigned long long& tick)
+    {
+        if (!seekRequested)
+            return false;
+
+        tick = seekTick;
+        seekRequested = false;
+        return true;
+    }
+
+    bool IsTrajectoryPlaying()
+    {
+        return trajectory && trajectoryPlaying;
+    }
+
+    const std::string& GetWaveMesh()
+    {
+        return sphereModel;
+    }
+
+    /**
+     * \brief Sets the wave budget of the command line as an edit, so a session log keeps it.
+     * A replay takes it from the log instead
+     */
+    void SetWaveBudget(const WaveBudget& budget)
+    {
+        if (player)
+            return;
+
+        SessionEvent event;
+        event.type = SessionEvent::WAVE_BUDGET;
+        event.index = budget.policy;
+        event.limits[0] = budget.maxLiveVertices;
+        event.limits[1] = budget.maxBytes;
+        Submit(event);
+    }
+
+    /**
+     * \brief Applies the edits made in the menus since the last call, tagged with the published tick.
+     * Called while the simulation is idle, so an edit always reaches the scene at the next tick
+     * and a replay applies it at the same one
+     */
+    void ApplyPendingEvents()
+    {
+        for (SessionEvent& event : pendingEvents)
+        {
+            event.tick = scene.getSnapshot().tick;
+            if (recorder)
+                recorder->record(event);
+            ApplyEvent(event);
+        }
+
+        pendingEvents.clear();
+    }
+
+    /**
+     * \brief Applies an edit, made in the menus or read from a session log
+     */
+    void ApplyEvent(const SessionEvent& event)
+    {
+        switch (event.type)
+        {
+        case SessionEvent::ADD_OBSTACLE:
+        {
+            glm::mat4 modelMatrix = event.matrix;
+            glm::vec4 modelColor = event.color;
+
+            newObject = new Obstacle(modelMatrix, modelColor, GL_BACK);
+            meshCache.loadModel(cubeModel, *newObject);
+            scene.addObject(newObject);
+            objectMeshes.push_back(cubeModel);
+            ++modelsCount;
+            break;
+        }
+        case SessionEvent::REMOVE_OBSTACLE:
+            if (event.index < 0 || event.index >= modelsCount)
+                break;
+            scene.removeObject(event.index);
+            objectMeshes.erase(objectMeshes.begin() + event.index);
+            --modelsCount;
+            break;
+        case SessionEvent::OBJECT_COLOR:
+        {
+            glm::vec4 color = event.color;
+            int index = event.index;
+
+            if (index >= 0 && index < modelsCount)
+                scene.updateObjectColor(color, index);
+            break;
+        }
+        case SessionEvent::ADD_SOURCE:
+        {
+            glm::mat4 waveMatrix = glm::translate(glm::mat4(1.0f), event.vector);
+            glm::vec4 newWaveColor = event.color;
+            float speed = event.value;
+
+            newObject = new Sphere(waveMatrix, newWaveColor, speed, false);
+            meshCache.loadModel(sphereModel, *newObject);
+            waves.push_back(newObject);
+            waveLaunchTimes.push_back(0.0f);
+            break;
+        }
+        case SessionEvent::REMOVE_SOURCE:
+        {
+            if (event.index < 0 || event.index >= static_cast<int>(waves.size()))
+                break;
+
+            Model* wave = waves[event.index];
+            waveLaunches.erase(std::remove_if(waveLaunches.begin(), waveLaunches.end(),
+                [wave](const std::pair<float, Model*>& launch) { return launch.second == wave; }), waveLaunches.end());
+
+            waves.erase(waves.begin() + event.index);
+            waveLaunchTimes.erase(waveLaunchTimes.begin() + event.index);
+            break;
+        }
+        case SessionEvent::EMIT_WAVES:
+            for (auto& wave : waves)
+                scene.addSphere(new Sphere(*wave));
+            break;
+        case SessionEvent::EMIT_SOURCE:
+            if (event.index >= 0 && event.index < static_cast<int>(waves.size()))
+                scene.addSphere(new Sphere(*waves[event.index]));
+            break;
+        case SessionEvent::LIGHT:
+            shader.use();
+            shader.setVec3("lightColor", glm::vec3(event.color));
+            shader.setVec3("lightPos", event.vector);
+            break;
+        case SessionEvent::WAVE_BUDGET:
+        {
+            WaveBudget budget;
+            budget.maxLiveVertices = event.limits[0];
+            budget.maxBytes = event.limits[1];
+            if (event.index >= 0 && event.index < WaveBudget::POLICY_COUNT)
+                budget.policy = static_cast<WaveBudget::Policy>(event.index);
+            scene.setWaveBudget(budget);
+
+            budgetVertices = static_cast<int>(std::min<unsigned long long>(budget.maxLiveVertices, INT_MAX));
+            budgetMegabytes = static_cast<int>(std::min<unsigned long long>(budget.maxBytes >> 20, INT_MAX));
+            budgetPolicy = budget.policy;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    SceneDescription GetSceneDescription()
+    {
+        const SceneSnapshot& snapshot = scene.getSnapshot();
+        SceneDescription description;
+        unsigned int i;
+
+        description.light.position = lightingPosition;
+        description.light.color = glm::vec3(lightingColor[0], lightingColor[1], lightingColor[2]);
+        description.waveMesh = sphereModel;
+        description.room = room;
+
+        // Queued additions are not in the snapshot yet
+        for (i = 0; i < snapshot.objects.size() && i < objectMeshes.size(); ++i)
+        {
+            ObstacleDescription obstacle;
+
+            obstacle.mesh = objectMeshes[i];
+            obstacle.modelMatrix = snapshot.objects[i]->getModelMatrix();
+            obstacle.color = snapshot.objectColors[i];
+            obstacle.cullMode = static_cast<Obstacle*>(snapshot.objects[i])->getInviseMode();
+
+            description.obstacles.push_back(obstacle);
+        }
+
+        for (i = 0; i < waves.size(); ++i)
+        {
+            WaveSourceDescription source;
+
+            source.position = glm::vec3(waves[i]->getModelMatrix()[3]);
+            source.speed = waves[i]->getSpeed();
+            source.color = waves[i]->getColor();
+            source.launchTime = waveLaunchTimes[i];
+
+            description.sources.push_back(source);
+        }
+
+        return description;
     }
 
     void RenderUI()
@@ -228,10 +683,24 @@ public:
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        ImGui::Begin(" ");
-
         RenderStyle();
 
+        if (player)
+        {
+            RenderReplayMenu();
+            RenderProfilerMenu();
+            return;
+        }
+
+        if (trajectory)
+        {
+            RenderTrajectoryMenu();
+            RenderProfilerMenu();
+            return;
+        }
+
+        ImGui::Begin(" ");
+
         if (ImGui::CollapsingHeader(""))
         {
             showObstacleMenu = true;
@@ -259,6 +728,9 @@ public:
         else
             showWaveSourceMenu = false;
 
+        if (ImGui::CollapsingHeader(""))
+            RenderSceneMenu();
+
         if (showObstacleMenu)
             RenderObstacleMenu();
 
@@ -269,6 +741,11 @@ public:
             RenderWaveSourceMenu();
 
         ImGui::End();
+
+        if (timeline)
+            RenderTimelineMenu();
+
+        RenderProfilerMenu();
     }
 
     void EndRenderUI()
@@ -278,15 +755,40 @@ public:
     }
 
 private:
+    void Submit(const SessionEvent& event)
+    {
+        pendingEvents.push_back(event);
+    }
+
+    void RequestSeek(unsigned long long tick)
+    {
+        seekRequested = true;
+        seekTick = tick;
+    }
+
+    void SubmitObjectColor(const glm::vec4& color, int index)
+    {
+        SessionEvent event;
+        event.type = SessionEvent::OBJECT_COLOR;
+        event.index = index;
+        event.color = color;
+        Submit(event);
+    }
+
     const char* cubeModel = "models/cube.obj";
-    const char* sphereModel = "models/sphere_very_big.obj";
+    std::string sphereModel = "models/sphere_very_big.obj";
+
+    const char* sceneTextPath = "scene.txt";
+    const char* sceneBinaryPath = "scene.sceneb";
 
     Scene& scene;
-    Loader& modelsLoader;
+    MeshCache& meshCache;
     Shader& shader;
 
     Model* newObject;
     int modelsCount = 0;
+    // Mesh file of every scene object, in scene order
+    std::vector<std::string> objectMeshes;
 
     float objectColor[3] = { 0.2f, 0.3f, 0.4f };
     glm::vec4 deletedObjectColor = glm::vec4(1, 0, 0, 1);
@@ -301,9 +803,35 @@ private:
     glm::vec3 waveSourcePosition = glm::vec3(0.0f, 0.0f, 0.0f);
     float waveSpeed = 1.0f;
     std::vector<Model*> waves;
+    // Launch time of every source, kept for saving
+    std::vector<float> waveLaunchTimes;
+    // Launch times of loaded sources that have not emitted yet
+    std::vector<std::pair<float, Model*>> waveLaunches;
+    // Room of the loaded scene, written back on save
+    RoomDescription room;
 
     bool showObstacleMenu = false;
     bool showLightingMenu = false;
     bool showWaveSourceMenu = false;
     bool showDeleteMenu = false;
+
+    int budgetVertices = 0;
+    int budgetMegabytes = 0;
+    int budgetPolicy = WaveBudget::EVICT_OLDEST;
+    const char* budgetPolicyNames[WaveBudget::POLICY_COUNT] = { " ", " ", "   ", "  " };
+
+    SessionRecorder* recorder = nullptr;
+    SessionPlayer* player = nullptr;
+    // Edits made in the menus, applied between ticks
+    std::vector<SessionEvent> pendingEvents;
+
+    TrajectoryPlayer* trajectory = nullptr;
+    bool trajectoryPlaying = true;
+    unsigned long long lastDecodedBytes = 0;
+    float decodeRate = 0.0f;
+
+    Timeline* timeline = nullptr;
+    bool seekRequested = false;
+    unsigned long long seekTick = 0;
+    float seekTime = 0.0f;
 };
@@ -1,9 +1,12 @@
 #include "loader.hpp"
 #include "model.hpp"
+#include "trace.hpp"
 
 
 void Loader::loadModel(const std::string& path, Model& model)
 {
+    TRACE_SCOPE("Loader::loadModel");
+
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | 
         aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices);
@@ -18,6 +21,53 @@ void Loader::loadModel(const std::string& path, Model& model)
     processNode(scene->mRootNode, scene, model);
 }
 
+/**
+ * \brief Fills model as loadModel would from the file of source, without Assimp.
+ * Source must be a single mesh model loaded with an identity model matrix
+ */
+void Loader::copyModel(Model& source, Model& model)
+{
+    TRACE_SCOPE("Loader::copyModel");
+
+    Vertex vertex;
+    float speed = model.getSpeed();
+
+    for (auto& sourceVertex : source.getVertices())
+    {
+        vertex = sourceVertex;
+        vertex.Velocity = vertex.Position / 2000.0f * speed;
+
+        model.pushVertex(vertex);
+    }
+    for (auto& index : source.getIndices())
+        model.pushIndex(index);
+    for (auto& face : source.getFaces())
+        model.pushFace(face);
+
+    pushMesh(model);
+}
+
+void Loader::setVerbose(bool verbose)
+{
+    optimizer.setVerbose(verbose);
+}
+
+/**
+ * \brief Headless tools load without meshes, no GL context is needed then
+ */
+void Loader::setCreateMeshes(bool createMeshes)
+{
+    this->createMeshes = createMeshes;
+}
+
+void Loader::pushMesh(Model& model)
+{
+    if (createMeshes)
+        model.pushMesh(Mesh(model));
+    else
+        model.toWorld();
+}
+
 void Loader::processNode(aiNode* node, const aiScene* scene, Model& model)
 {
     unsigned int i;
@@ -25,13 +75,14 @@ void Loader::processNode(aiNode* node, const aiScene* scene, Model& model)
     for (i = 0; i < node->mNumMeshes; ++i)
     {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        model.pushMesh(processMesh(mesh, scene, model));
+        processMesh(mesh, scene, model);
+        pushMesh(model);
     }
     for (i = 0; i < node->mNumChildren; ++i)
         processNode(node->mChildren[i], scene, model);
 }
 
-Mesh Loader::processMesh(aiMesh* mesh, const aiScene* scene, Model& model)
+void Loader::processMesh(aiMesh* mesh, const aiScene* scene, Model& model)
 {
     std::vector<Vertex>& vertices = model.getVertices();
 
@@ -92,5 +143,5 @@ Mesh Loader::processMesh(aiMesh* mesh, const aiScene* scene, Model& model)
         model.pushFace(face);
     }
 
-    return Mesh(model);
+    optimizer.optimize(model);
 }
\ No newline at end of file
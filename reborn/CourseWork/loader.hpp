@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mesh.hpp"
+#include "optimizer.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -15,10 +16,17 @@ class Loader
 {
 public:
     void loadModel(const std::string& path, Model& model);
+    void copyModel(Model& source, Model& model);
+    void setVerbose(bool verbose);
+    void setCreateMeshes(bool createMeshes);
 
 private:
     std::string directory;
+    MeshOptimizer optimizer;
+    // Without meshes models are put in world space and nothing touches GL
+    bool createMeshes = true;
 
     void processNode(aiNode* node, const aiScene* scene, Model& model);
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene, Model& model);
+    void pushMesh(Model& model);
+    void processMesh(aiMesh* mesh, const aiScene* scene, Model& model);
 };
\ No newline at end of file
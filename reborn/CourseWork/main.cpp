@@ -1,9 +1,22 @@
 #include "loader.hpp"
+#include "meshcache.hpp"
+#include "scenefile.hpp"
 #include "camera.hpp"
 #include "scene.hpp"
 #include "sphere.hpp"
 #include "obstacle.hpp"
 #include "gui.hpp"
+#include "simulator.hpp"
+#include "options.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+#include "allocation.hpp"
+#include "session.hpp"
+#include "capture.hpp"
+#include "trajectory.hpp"
+#include "timeline.hpp"
+#include "stateexport.hpp"
 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -11,27 +24,26 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
 
+#include <chrono>
+#include <fstream>
+#include <thread>
+
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow* window);
-
-/**
- * \brief Window width
- */
-const unsigned int SCR_WIDTH = 1920;
-/**
- * \brief Window height
- */
-const unsigned int SCR_HEIGHT = 1080;
+void moveCamera(Camera_Movement direction);
+void replayEvents(Gui& gui, bool keysOnly);
+void recordTickTime(float glTime);
+bool nextTickTime(float& glTime);
 
 /**
  * \brief Create and setup camera
  */
 Camera camera;
-float lastX = SCR_WIDTH / 2.0f;
-float lastY = SCR_HEIGHT / 2.0f;
+float lastX = 0.0f;
+float lastY = 0.0f;
 bool firstMouse = true;
 bool ctrlPressed = false;
 bool cursorVisible = false;
@@ -42,9 +54,42 @@ bool cursorVisible = false;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+/**
+ * \brief Set by F12, the render loop writes the trace of the last frames
+ */
+bool traceRequested = false;
+
+/**
+ * \brief F9 pauses and resumes frame capture
+ */
+bool capturePaused = false;
+
+/**
+ * \brief Session log written with --record or read with --replay, events are tagged with the published tick
+ */
+SessionRecorder sessionRecorder;
+SessionPlayer sessionPlayer;
+bool replaying = false;
+bool replayFast = false;
+unsigned long long publishedTick = 0;
+float replayStart = 0.0f;
+float replayFirstTime = -1.0f;
+
 
-int main()
+int main(int argc, char* argv[])
 {
+    Options options;
+    if (!parseOptions(argc, argv, options))
+        return EXIT_FAILURE;
+
+    if (options.allocationCheck && !AllocationTracker::isEnabled())
+    {
+        std::cout << "Allocation check needs a build with TRACK_ALLOCATIONS (Profile configuration)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TRACE_THREAD("render");
+
     // Init glfw
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -52,7 +97,8 @@ int main()
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     // Create window
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Course work", NULL, NULL);
+    // Window size comes from --width and --height
+    GLFWwindow* window = glfwCreateWindow(options.width, options.height, "Course work", NULL, NULL);
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -60,6 +106,9 @@ int main()
         return EXIT_FAILURE;
     }
 
+    lastX = options.width / 2.0f;
+    lastY = options.height / 2.0f;
+
     // Setup callbacks
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
@@ -77,28 +126,210 @@ int main()
     // Load shaders
     Shader shader("shaders/shader.vert", "shaders/shader.frag");
 
-    // Create model loader
+    // Create model loader, every model file is imported once
     Loader modelLoader;
+    MeshCache meshCache(modelLoader);
+
+    // A replay starts from the scene and settings it was recorded with
+    if (!options.replayPath.empty())
+    {
+        if (!sessionPlayer.open(options.replayPath))
+            return EXIT_FAILURE;
+
+        replaying = true;
+        replayFast = options.replayFast;
+        options.deterministic = sessionPlayer.getHeader().deterministic;
+        if (options.scenePath.empty())
+            options.scenePath = sessionPlayer.getHeader().scenePath;
+    }
+
+    SceneDescription sceneDescription;
+    if (!options.scenePath.empty() && !SceneFile::load(options.scenePath, sceneDescription))
+        return EXIT_FAILURE;
+
+    if (!options.recordPath.empty())
+    {
+        SessionHeader header;
+        header.deterministic = options.deterministic;
+        header.scenePath = options.scenePath;
+
+        if (!sessionRecorder.open(options.recordPath, header))
+            return EXIT_FAILURE;
+    }
+
+    // Frame timings
+    Profiler& profiler = Profiler::get();
+    profiler.init();
+    if (!options.profileCsv.empty())
+        profiler.openCsv(options.profileCsv);
+
+    // Simulation counters
+    Metrics& metrics = Metrics::get();
+    if (!options.metricsPath.empty())
+        metrics.open(options.metricsPath, options.metricsInterval);
 
     // Create scene
     Scene scene;
+    scene.setDeterministic(options.deterministic);
+
+    // Per-tick state hashes for comparing runs
+    std::ofstream hashLog;
+    if (!options.hashLog.empty())
+        hashLog.open(options.hashLog);
 
     // Create GUI
-    Gui gui(window, modelLoader, scene, shader);
+    Gui gui(window, meshCache, scene, shader);
+    if (!options.scenePath.empty())
+        gui.LoadScene(sceneDescription);
+    gui.SetSession(sessionRecorder.isOpen() ? &sessionRecorder : nullptr, replaying ? &sessionPlayer : nullptr);
+
+    // Live waves stay within the budget, applied with the first edits
+    WaveBudget waveBudget;
+    waveBudget.maxLiveVertices = options.waveBudgetVertices;
+    waveBudget.maxBytes = static_cast<unsigned long long>(options.waveBudgetMegabytes) << 20;
+    if (!WaveBudget::parsePolicy(options.waveBudgetPolicy, waveBudget.policy))
+    {
+        std::cout << "Unknown wave budget policy: " << options.waveBudgetPolicy << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (waveBudget.maxLiveVertices > 0 || waveBudget.maxBytes > 0)
+        gui.SetWaveBudget(waveBudget);
 
-    glm::mat4 mRoom = glm::mat4(1.0f);
-    mRoom = glm::scale(mRoom, glm::vec3(20, 20, 20));
-    glm::vec4 roomColor(0.1f, 0.1f, 0.1f, 0.3f);
+    glm::mat4 mRoom = sceneDescription.room.modelMatrix;
+    glm::vec4 roomColor = sceneDescription.room.color;
     Obstacle room(mRoom, roomColor, GL_FRONT, false);
-    modelLoader.loadModel("models/room.obj", room);
+    meshCache.loadModel(sceneDescription.room.mesh, room);
+
+    // Frames are read back through a ring of pixel buffers, a busy writer drops frames
+    FrameWriter* frameWriter = nullptr;
+    FrameCapture* frameCapture = nullptr;
+    if (!options.capturePath.empty())
+    {
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+
+        frameWriter = new FrameWriter(FrameWriter::getFormat(options.capturePath), options.capturePath,
+            framebufferWidth, framebufferHeight, options.captureThreads);
+        if (!frameWriter->isOpen())
+            return EXIT_FAILURE;
+        frameCapture = new FrameCapture(*frameWriter, framebufferWidth, framebufferHeight, true);
+    }
+
+    // Wavefronts are written by a background thread, or read from a mapping instead of simulated
+    TrajectoryRecorder trajectoryRecorder;
+    TrajectoryPlayer trajectoryPlayer;
+    if (!options.trajectoryRecordPath.empty() && !trajectoryRecorder.open(options.trajectoryRecordPath, gui.GetWaveMesh()))
+        return EXIT_FAILURE;
+    if (!options.trajectoryPlayPath.empty())
+    {
+        if (!trajectoryPlayer.open(options.trajectoryPlayPath, meshCache))
+            return EXIT_FAILURE;
+
+        trajectoryPlayer.seek(0);
+        gui.SetTrajectory(&trajectoryPlayer);
+    }
+
+    // Every published tick is copied into shared memory, readers map it without serializing
+    StateExporter stateExporter;
+    if (!options.exportName.empty() && !stateExporter.open(options.exportName, options.exportVertices))
+        return EXIT_FAILURE;
+
+    // Checkpoints for seeking, not while a session is recorded or replayed since seeks are not logged.
+    // Saving them allocates, so an allocation check runs without
+    Timeline* timeline = nullptr;
+    if (options.checkpointBudget > 0 && !replaying && !sessionRecorder.isOpen() &&
+        options.trajectoryPlayPath.empty() && !options.allocationCheck)
+    {
+        timeline = new Timeline(scene, options.checkpointInterval, static_cast<size_t>(options.checkpointBudget) << 20);
+        gui.SetTimeline(timeline);
+    }
+
+    // Tick times run on the simulation clock, a seek moves it to the time of the target tick
+    float timeOffset = 0.0f;
 
     // Enable Z-buffer
     glEnable(GL_DEPTH_TEST);
 
+    // Simulation runs one tick ahead of rendering
+    Simulator simulator(scene);
+
+    // Unpaced replay renders as fast as the ticks run
+    if (replaying && replayFast)
+        glfwSwapInterval(0);
+
+    float tickTime = static_cast<float>(glfwGetTime());
+    if (replaying)
+    {
+        if (nextTickTime(tickTime))
+            simulator.start(tickTime);
+    }
+    else
+    {
+        recordTickTime(tickTime);
+        simulator.start(tickTime);
+    }
+
+    unsigned int frameCount = 0;
+    float sceneStart = static_cast<float>(glfwGetTime());
+    unsigned int allocatingFrames = 0;
+
     // Event loop
     while (!glfwWindowShouldClose(window))
     {
-        gui.RenderUI();
+        TRACE_FRAME();
+        TRACE_SCOPE("frame");
+
+        profiler.beginFrame();
+
+        // GUI reads the published snapshot and queues edits while the tick runs
+        {
+            ProfileScope scope(Profiler::GUI);
+            gui.RenderUI();
+            gui.LaunchWaves(static_cast<float>(glfwGetTime()) - timeOffset - sceneStart);
+        }
+
+        {
+            ProfileScope scope(Profiler::SIM_WAIT);
+            simulator.wait();
+        }
+        profiler.collectTick();
+        scene.swap();
+
+        if (hashLog.is_open())
+            hashLog << scene.getSnapshot().tick << "," << std::hex << scene.getSnapshot().stateHash << std::dec << "\n";
+
+        trajectoryRecorder.record(scene.getSnapshot());
+        stateExporter.publish(scene.getSnapshot());
+        if (timeline)
+            timeline->record(tickTime);
+
+        // Edits reach the scene while the simulation is idle, the same way when recording and replaying
+        publishedTick = scene.getSnapshot().tick;
+        if (replaying)
+        {
+            replayEvents(gui, false);
+
+            if (nextTickTime(tickTime))
+                simulator.start(tickTime);
+            else
+            {
+                std::cout << "Replayed " << publishedTick << " ticks in " <<
+                    static_cast<float>(glfwGetTime()) - replayStart << " s" << std::endl;
+                glfwSetWindowShouldClose(window, true);
+            }
+        }
+        else
+        {
+            gui.ApplyPendingEvents();
+
+            unsigned long long seekTick;
+            if (timeline && gui.TakeSeekRequest(seekTick) && timeline->seek(seekTick))
+                timeOffset = static_cast<float>(glfwGetTime()) - timeline->getTime(scene.getSnapshot().tick);
+
+            tickTime = static_cast<float>(glfwGetTime()) - timeOffset;
+            recordTickTime(tickTime);
+            simulator.start(tickTime);
+        }
 
         glClearColor(0.4f, 0.4f, 0.4f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -107,10 +338,15 @@ int main()
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        processInput(window);
+        {
+            ProfileScope scope(Profiler::INPUT);
+            processInput(window);
+            if (replaying)
+                replayEvents(gui, true);
+        }
 
         glm::mat4 proj = glm::perspective(glm::radians(camera.Zoom), 
-            (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+            (float)options.width / (float)options.height, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
 
         shader.use();
@@ -120,19 +356,102 @@ int main()
 
         float glTime = glfwGetTime();
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glEnable(GL_CULL_FACE);
-        room.Draw(shader, glTime, scene);
-        scene.render(shader, glTime);
+        profiler.beginGpu();
+
+        {
+            ProfileScope scope(Profiler::UPLOAD);
+            scene.upload();
+        }
+
+        {
+            ProfileScope scope(Profiler::DRAW);
+
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glEnable(GL_CULL_FACE);
+            room.Draw(shader, glTime, scene);
+            scene.render(shader, glTime);
+
+            if (gui.IsTrajectoryPlaying())
+                trajectoryPlayer.next();
+            trajectoryPlayer.render(shader);
+
+            gui.EndRenderUI();
+        }
+
+        if (frameCapture && !capturePaused)
+        {
+            ProfileScope scope(Profiler::CAPTURE);
+            frameCapture->capture();
+        }
+
+        profiler.endGpu();
+
+        {
+            ProfileScope scope(Profiler::SWAP);
+            glfwSwapBuffers(window);
+        }
 
-        gui.EndRenderUI();
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        {
+            ProfileScope scope(Profiler::INPUT);
+            glfwPollEvents();
+        }
+
+        profiler.endFrame(scene.getSnapshot().objects.size());
+        metrics.update(scene.getSnapshot(), static_cast<float>(glfwGetTime()));
+
+        ++frameCount;
+
+        // After warmup every buffer has reached its size, a frame that still allocates is a regression
+        if (options.allocationCheck && frameCount > options.allocationWarmup &&
+            profiler.getAllocations(Profiler::FRAME).count > 0)
+        {
+            if (allocatingFrames < 10)
+                profiler.printAllocations();
+            ++allocatingFrames;
+        }
+
+        if (options.frames > 0 && frameCount >= options.frames)
+            glfwSetWindowShouldClose(window, true);
+
+        if (traceRequested)
+        {
+            Tracer::get().dump(options.tracePath, options.traceFrames);
+            traceRequested = false;
+        }
     }
 
+    simulator.wait();
+    sessionRecorder.close();
+    trajectoryRecorder.close();
+    trajectoryPlayer.close();
+    stateExporter.close();
+    delete timeline;
+
+    if (frameCapture)
+    {
+        frameCapture->flush();
+        frameWriter->finish();
+        std::cout << frameCapture->getCapturedCount() << " frames captured, "
+            << frameCapture->getDroppedCount() << " dropped" << std::endl;
+
+        delete frameCapture;
+        delete frameWriter;
+    }
+
+    if (options.traceOnExit)
+        Tracer::get().dump(options.tracePath, options.traceFrames);
+    profiler.release();
+    scene.releaseMeshes();
+
     glfwTerminate();
 
+    if (allocatingFrames > 0)
+    {
+        std::cout << allocatingFrames << " steady-state frames allocated memory" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 }
 
@@ -141,14 +460,93 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    // The replayed camera path comes from the log
+    if (replaying)
+        return;
+
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, deltaTime);
+        moveCamera(FORWARD);
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
+        moveCamera(BACKWARD);
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, deltaTime);
+        moveCamera(LEFT);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, deltaTime);
+        moveCamera(RIGHT);
+}
+
+void moveCamera(Camera_Movement direction)
+{
+    SessionEvent event;
+    event.type = SessionEvent::CAMERA_KEY;
+    event.tick = publishedTick;
+    event.index = direction;
+    event.value = deltaTime;
+    sessionRecorder.record(event);
+
+    camera.ProcessKeyboard(direction, deltaTime);
+}
+
+/**
+ * \brief Applies logged events up to the published tick. Camera keys are applied at input time,
+ * everything else while the simulation is idle, the same points they were recorded at
+ */
+void replayEvents(Gui& gui, bool keysOnly)
+{
+    const SessionEvent* event;
+
+    while ((event = sessionPlayer.peek()) != nullptr && event->tick <= publishedTick &&
+        event->type != SessionEvent::TICK_TIME && (!keysOnly || event->type == SessionEvent::CAMERA_KEY))
+    {
+        if (event->type == SessionEvent::CAMERA_KEY)
+            camera.ProcessKeyboard(static_cast<Camera_Movement>(event->index), event->value);
+        else if (event->type == SessionEvent::CAMERA_MOUSE)
+            camera.ProcessMouseMovement(event->vector.x, event->vector.y);
+        else
+            gui.ApplyEvent(*event);
+
+        sessionPlayer.pop();
+    }
+}
+
+/**
+ * \brief Logs the time a tick is started with, the simulation is replayed with the same times
+ */
+void recordTickTime(float glTime)
+{
+    SessionEvent event;
+    event.type = SessionEvent::TICK_TIME;
+    event.tick = publishedTick;
+    event.value = glTime;
+    sessionRecorder.record(event);
+}
+
+/**
+ * \brief Takes the time the next recorded tick was started with, false when the log is over.
+ * Without --replay-fast waits until as much time has passed as between the recorded ticks
+ */
+bool nextTickTime(float& glTime)
+{
+    const SessionEvent* event = sessionPlayer.peek();
+    if (event == nullptr || event->type != SessionEvent::TICK_TIME)
+        return false;
+
+    glTime = event->value;
+    sessionPlayer.pop();
+
+    if (replayFirstTime < 0.0f)
+    {
+        replayFirstTime = glTime;
+        replayStart = static_cast<float>(glfwGetTime());
+    }
+
+    if (!replayFast)
+    {
+        float wait = (glTime - replayFirstTime) - (static_cast<float>(glfwGetTime()) - replayStart);
+        if (wait > 0.0f)
+            std::this_thread::sleep_for(std::chrono::duration<float>(wait));
+    }
+
+    return true;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -176,6 +574,15 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     lastX = xpos;
     lastY = ypos;
 
+    if (replaying)
+        return;
+
+    SessionEvent event;
+    event.type = SessionEvent::CAMERA_MOUSE;
+    event.tick = publishedTick;
+    event.vector = glm::vec3(xoffset, yoffset, 0.0f);
+    sessionRecorder.record(event);
+
     camera.ProcessMouseMovement(xoffset, yoffset);
 }
 
@@ -198,6 +605,12 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         }
     }
 
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS)
+        traceRequested = true;
+
+    if (key == GLFW_KEY_F9 && action == GLFW_PRESS)
+        capturePaused = !capturePaused;
+
     if (key == GLFW_KEY_1 && action == GLFW_PRESS)
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     else if (key == GLFW_KEY_2 && action == GLFW_PRESS)
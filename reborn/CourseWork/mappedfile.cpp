@@ -0,0 +1,132 @@
+#include "mappedfile.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        fileHandle = nullptr;
+        std::cout << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    size = fileSize.QuadPart;
+
+    // An empty file cannot be mapped, it is open with no data
+    if (size == 0)
+        return true;
+
+    mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle)
+        data = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+    if (data == nullptr)
+    {
+        std::cout << "Failed to map file: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+
+    data = nullptr;
+    mappingHandle = fileHandle = nullptr;
+    size = 0;
+}
+
+bool MappedFile::isOpen()
+{
+    return fileHandle != nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        std::cout << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+
+    struct stat status;
+    fstat(file, &status);
+    size = status.st_size;
+
+    // An empty file cannot be mapped, it is open with no data
+    void* mapping = size ? mmap(NULL, size, PROT_READ, MAP_SHARED, file, 0) : NULL;
+    ::close(file);
+
+    if (size && mapping == MAP_FAILED)
+    {
+        std::cout << "Failed to map file: " << path << std::endl;
+        size = 0;
+        return false;
+    }
+
+    data = size ? (const unsigned char*)mapping : (const unsigned char*)"";
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data && size)
+        munmap((void*)data, size);
+
+    data = nullptr;
+    size = 0;
+}
+
+bool MappedFile::isOpen()
+{
+    return data != nullptr;
+}
+
+#endif
+
+const unsigned char* MappedFile::getData()
+{
+    return data;
+}
+
+unsigned long long MappedFile::getSize()
+{
+    return size;
+}
\ No newline at end of file
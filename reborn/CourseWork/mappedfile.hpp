@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+
+/**
+ * \brief Read-only memory mapping of a whole file.
+ * Pages are read from disk as they are touched, so opening a large file costs nothing
+ */
+class MappedFile
+{
+public:
+    ~MappedFile();
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen();
+    const unsigned char* getData();
+    unsigned long long getSize();
+
+private:
+    const unsigned char* data = nullptr;
+    unsigned long long size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "mesh.hpp"
 #include "model.hpp"
+#include "trace.hpp"
 
 
 Mesh::Mesh(Model& model)
@@ -13,12 +14,15 @@ Mesh::Mesh(Model& model)
 void Mesh::Bind()
 {
     glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, positionStream.getID());
 }
 
 void Mesh::Draw(Shader& shader)
 {
+    // Only the positions move through the ring, a base vertex would offset the normals as well
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)positionStream.getOffset());
     glDrawElements(GL_TRIANGLES, indicesSize, GL_UNSIGNED_INT, 0);
+    positionStream.fence();
 }
 
 void Mesh::Unbind()
@@ -27,33 +31,46 @@ void Mesh::Unbind()
     glBindVertexArray(0);
 }
 
-void Mesh::setupMesh(Model& model)
+void Mesh::release()
 {
-    std::vector<unsigned int> indices = model.getIndices();
-    std::vector<Vertex> vertices = model.getVertices();
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &EBO);
+    positionStream.release();
+    normalStream.release();
+
+    VAO = EBO = 0;
+}
+
+void Mesh::upload(const std::vector<glm::vec3>& positions, unsigned int first, unsigned int count)
+{
+    positionStream.upload(&positions[0], sizeof(glm::vec3), first, count);
+}
+
+void Mesh::setupMesh(Model& model, unsigned int segments)
+{
+    TRACE_SCOPE("Mesh::setupMesh");
+
+    std::vector<unsigned int>& indices = model.getIndices();
+    std::vector<Vertex>& vertices = model.getVertices();
 
     glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
     glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_DYNAMIC_DRAW);
+    // normals, copied straight out of the interleaved vertices
+    normalStream.create(&vertices[0].Normal, sizeof(Vertex), sizeof(glm::vec3), vertices.size(), 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+    // vertex positions, static models keep a single segment, waves stream into a ring
+    positionStream.create(&vertices[0].Position, sizeof(Vertex), sizeof(glm::vec3), vertices.size(), segments);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-        &indices[0], GL_DYNAMIC_DRAW);
-
-    // vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    // normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    // velocity positions
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Velocity));
+        &indices[0], GL_STATIC_DRAW);
 
     glBindVertexArray(0);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "shader.hpp"
+#include "streambuffer.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -33,7 +34,14 @@ public:
     void Draw(Shader& shader);
     void Unbind();
 
-    void setupMesh(Model& model);
+    void upload(const std::vector<glm::vec3>& positions, unsigned int first, unsigned int count);
+
+    void setupMesh(Model& model, unsigned int segments = 1);
+    void release();
 private:
-    unsigned int VAO, VBO, EBO, indicesSize;
-};
+    unsigned int VAO, EBO, indicesSize;
+
+    // Positions are the only per-frame data, normals never change
+    StreamBuffer positionStream;
+    StreamBuffer normalStream;
+};
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "meshcache.hpp"
+#include "trace.hpp"
+
+#include <fstream>
+#include <iterator>
+
+
+/**
+ * \brief Cache file layout: magic, version, key, vertex, index and face counts,
+ * then the vertices, the indices and the faces (two triangles and a normal)
+ */
+const unsigned int MESH_CACHE_MAGIC = 0x434D5743; // "CWMC"
+
+/**
+ * \brief Raised with any change to what an import produces
+ */
+const unsigned int MESH_CACHE_VERSION = 2;
+
+MeshCache::MeshCache(Loader& loader) : loader(loader)
+{
+}
+
+MeshCache::~MeshCache()
+{
+    for (auto& entry : templates)
+        delete entry.second;
+}
+
+void MeshCache::loadModel(const std::string& path, Model& model)
+{
+    TRACE_SCOPE("MeshCache::loadModel");
+
+    Obstacle* source;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        source = getTemplate(path);
+    }
+
+    // The import failed and was reported, same as Loader leaves the model empty
+    if (source->getVertices().empty())
+        return;
+
+    loader.copyModel(*source, model);
+}
+
+unsigned long long MeshCache::getContentKey(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    getTemplate(path);
+    return contentKeys[path];
+}
+
+Obstacle* MeshCache::getTemplate(const std::string& path)
+{
+    auto found = templates.find(path);
+    if (found != templates.end())
+        return found->second;
+
+    glm::mat4 identity = glm::mat4(1.0f);
+    glm::vec4 color = glm::vec4(1.0f);
+    Obstacle* source = new Obstacle(identity, color, GL_BACK);
+    templates[path] = source;
+
+    unsigned long long key;
+    if (!hashFile(path, key))
+    {
+        std::cout << "Failed to open model file: " << path << std::endl;
+        contentKeys[path] = 0;
+        return source;
+    }
+    contentKeys[path] = key;
+
+    std::string cachePath = getCachePath(path);
+    if (loadCache(cachePath, key, *source))
+        return source;
+
+    // Templates only keep the data, the GL objects of the import go right away
+    loader.loadModel(path, *source);
+    source->releaseMeshes();
+    source->getMeshes().clear();
+
+    if (!source->getVertices().empty())
+        saveCache(cachePath, key, *source);
+
+    return source;
+}
+
+bool MeshCache::loadCache(const std::string& cachePath, unsigned long long key, Model& model)
+{
+    std::ifstream cacheFile(cachePath, std::ios::binary);
+    if (!cacheFile.is_open())
+        return false;
+
+    unsigned int magic = 0, version = 0, vertexCount = 0, indexCount = 0, faceCount = 0;
+    unsigned long long cachedKey = 0;
+
+    cacheFile.read((char*)&magic, sizeof(magic));
+    cacheFile.read((char*)&version, sizeof(version));
+    cacheFile.read((char*)&cachedKey, sizeof(cachedKey));
+    cacheFile.read((char*)&vertexCount, sizeof(vertexCount));
+    cacheFile.read((char*)&indexCount, sizeof(indexCount));
+    cacheFile.read((char*)&faceCount, sizeof(faceCount));
+
+    if (!cacheFile || magic != MESH_CACHE_MAGIC || version != MESH_CACHE_VERSION || cachedKey != key || vertexCount == 0)
+        return false;
+
+    std::vector<Vertex>& vertices = model.getVertices();
+    std::vector<unsigned int>& indices = model.getIndices();
+    std::vector<Face>& faces = model.getFaces();
+    unsigned int i;
+
+    vertices.resize(vertexCount);
+    indices.resize(indexCount);
+    faces.resize(faceCount);
+
+    cacheFile.read((char*)&vertices[0], vertexCount * sizeof(Vertex));
+    if (indexCount)
+        cacheFile.read((char*)&indices[0], indexCount * sizeof(unsigned int));
+
+    for (i = 0; i < faceCount; ++i)
+    {
+        cacheFile.read((char*)&faces[i].Triangles.first, sizeof(glm::uvec3));
+        cacheFile.read((char*)&faces[i].Triangles.second, sizeof(glm::uvec3));
+        cacheFile.read((char*)&faces[i].Normal, sizeof(glm::vec3));
+    }
+
+    if (!cacheFile)
+    {
+        std::cout << "Mesh cache is truncated, importing the model: " << cachePath << std::endl;
+        vertices.clear();
+        indices.clear();
+        faces.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void MeshCache::saveCache(const std::string& cachePath, unsigned long long key, Model& model)
+{
+    std::ofstream cacheFile(cachePath, std::ios::binary | std::ios::trunc);
+    if (!cacheFile.is_open())
+    {
+        std::cout << "Failed to write mesh cache: " << cachePath << std::endl;
+        return;
+    }
+
+    std::vector<Vertex>& vertices = model.getVertices();
+    std::vector<unsigned int>& indices = model.getIndices();
+    std::vector<Face>& faces = model.getFaces();
+
+    unsigned int magic = MESH_CACHE_MAGIC, version = MESH_CACHE_VERSION;
+    unsigned int vertexCount = vertices.size(), indexCount = indices.size(), faceCount = faces.size();
+
+    cacheFile.write((const char*)&magic, sizeof(magic));
+    cacheFile.write((const char*)&version, sizeof(version));
+    cacheFile.write((const char*)&key, sizeof(key));
+    cacheFile.write((const char*)&vertexCount, sizeof(vertexCount));
+    cacheFile.write((const char*)&indexCount, sizeof(indexCount));
+    cacheFile.write((const char*)&faceCount, sizeof(faceCount));
+
+    cacheFile.write((const char*)&vertices[0], vertexCount * sizeof(Vertex));
+    if (indexCount)
+        cacheFile.write((const char*)&indices[0], indexCount * sizeof(unsigned int));
+
+    for (const Face& face : faces)
+    {
+        cacheFile.write((const char*)&face.Triangles.first, sizeof(glm::uvec3));
+        cacheFile.write((const char*)&face.Triangles.second, sizeof(glm::uvec3));
+        cacheFile.write((const char*)&face.Normal, sizeof(glm::vec3));
+    }
+}
+
+std::string MeshCache::getCachePath(const std::string& path)
+{
+    return path.substr(0, path.find_last_of('.')) + ".cache";
+}
+
+bool MeshCache::hashFile(const std::string& path, unsigned long long& key)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // FNV-1a
+    key = 14695981039346656037ULL;
+    for (unsigned char c : contents)
+    {
+        key ^= c;
+        key *= 1099511628211ULL;
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "loader.hpp"
+#include "obstacle.hpp"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+
+/**
+ * \brief Imports every model file once.
+ *
+ * The first load of a path reads its ".cache" file next to the model, or
+ * imports it with Assimp and writes that file, later loads copy the kept
+ * model-space template. A cache file holds the optimized vertices, indices
+ * and faces and is keyed by a hash of the model file, so an edited model is
+ * imported again. Loads may run on several threads at once, a template
+ * never changes once imported.
+ */
+class MeshCache
+{
+public:
+    MeshCache(Loader& loader);
+    ~MeshCache();
+
+    void loadModel(const std::string& path, Model& model);
+    // Hash of the model file's content, 0 if it cannot be read
+    unsigned long long getContentKey(const std::string& path);
+
+private:
+    Loader& loader;
+    std::map<std::string, Obstacle*> templates;
+    std::map<std::string, unsigned long long> contentKeys;
+    std::mutex mutex;
+
+    Obstacle* getTemplate(const std::string& path);
+
+    bool loadCache(const std::string& cachePath, unsigned long long key, Model& model);
+    void saveCache(const std::string& cachePath, unsigned long long key, Model& model);
+
+    static std::string getCachePath(const std::string& path);
+    static bool hashFile(const std::string& path, unsigned long long& key);
+};
\ No newline at end of file
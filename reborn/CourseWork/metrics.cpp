@@ -0,0 +1,239 @@
+#include "metrics.hpp"
+#include "scene.hpp"
+#include "allocation.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+
+void SimulationCounters::add(const SimulationCounters& other)
+{
+    vertexObstacleTests += other.vertexObstacleTests;
+    roomReflections += other.roomReflections;
+    trianglesKilled += other.trianglesKilled;
+    spheresRetired += other.spheresRetired;
+}
+
+void MetricSlot::addHits(unsigned int obstacle, unsigned long long hits)
+{
+    if (obstacle >= obstacleHits.size())
+        obstacleHits.resize(obstacle + 1, 0);
+    obstacleHits[obstacle] += hits;
+}
+
+Metrics& Metrics::get()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics()
+{
+}
+
+/**
+ * \brief Holds the slot of a thread and gives it back when the thread exits
+ */
+struct MetricSlotLease
+{
+    MetricSlot* slot = nullptr;
+
+    ~MetricSlotLease()
+    {
+        if (slot)
+            Metrics::get().releaseSlot(*slot);
+    }
+};
+
+MetricSlot& Metrics::localSlot()
+{
+    thread_local MetricSlotLease lease;
+
+    if (!lease.slot)
+    {
+        std::lock_guard<std::mutex> lock(slotMutex);
+
+        if (!freeSlots.empty())
+        {
+            lease.slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else if (slotCount < MAX_THREADS)
+            lease.slot = &slots[slotCount++];
+        else
+        {
+            std::cout << "Metrics: more than " << MAX_THREADS << " threads at once, extra counts are dropped" << std::endl;
+            lease.slot = &overflow;
+        }
+    }
+
+    return *lease.slot;
+}
+
+void Metrics::releaseSlot(MetricSlot& slot)
+{
+    if (&slot == &overflow)
+        return;
+
+    std::lock_guard<std::mutex> lock(slotMutex);
+
+    // Counts left after the last collection belong to no scene
+    slot.counters = SimulationCounters();
+    std::fill(slot.obstacleHits.begin(), slot.obstacleHits.end(), 0);
+    freeSlots.push_back(&slot);
+}
+
+void Metrics::collectTick(const std::vector<MetricSlot*>& threadSlots, SimulationCounters& tick, std::vector<unsigned long long>& objectHits)
+{
+    unsigned int i, j;
+
+    // Runs between parallel jobs, no slot is being written
+    for (i = 0; i < threadSlots.size(); ++i)
+    {
+        // Counts of the overflow slot may come from any scene
+        if (threadSlots[i] == &overflow)
+            continue;
+
+        MetricSlot& slot = *threadSlots[i];
+
+        tick.add(slot.counters);
+        slot.counters = SimulationCounters();
+
+        for (j = 0; j < slot.obstacleHits.size() && j < objectHits.size(); ++j)
+            objectHits[j] += slot.obstacleHits[j];
+        std::fill(slot.obstacleHits.begin(), slot.obstacleHits.end(), 0);
+    }
+}
+
+void Metrics::addUploadBytes(unsigned long long bytes)
+{
+    uploadBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+bool Metrics::open(const std::string& path, float interval)
+{
+    this->path = path;
+    this->interval = interval;
+
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open metrics file: " << path << std::endl;
+        this->path.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void Metrics::update(const SceneSnapshot& snapshot, float time)
+{
+    frameUploadBytes = uploadBytes.exchange(0, std::memory_order_relaxed);
+    totalUploadBytes += frameUploadBytes;
+    ++frames;
+
+    if (path.empty() || time - lastWrite < interval)
+        return;
+    lastWrite = time;
+
+    write(snapshot);
+}
+
+void Metrics::write(const SceneSnapshot& snapshot)
+{
+    AllocationTracker::Pause pause;
+    std::string temporary = path + ".tmp";
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+
+    {
+        std::ofstream file(temporary);
+        if (!file.is_open())
+            return;
+
+        if (json)
+            writeJson(file, snapshot);
+        else
+            writeText(file, snapshot);
+    }
+
+    // Replaced in one step, readers see the previous dump or the new one, never half of it
+#ifdef _WIN32
+    MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    std::rename(temporary.c_str(), path.c_str());
+#endif
+}
+
+void Metrics::writeJson(std::ofstream& file, const SceneSnapshot& snapshot)
+{
+    unsigned int i;
+
+    auto counters = [&file](const SimulationCounters& counters)
+    {
+        file << "{\"vertexObstacleTests\":" << counters.vertexObstacleTests
+            << ",\"roomReflections\":" << counters.roomReflections
+            << ",\"trianglesKilled\":" << counters.trianglesKilled
+            << ",\"spheresRetired\":" << counters.spheresRetired << "}";
+    };
+
+    file << "{\n\"tick\":" << snapshot.tick << ",\n\"frames\":" << frames << ",\n\"lastTick\":";
+    counters(snapshot.tickCounters);
+    file << ",\n\"total\":";
+    counters(snapshot.totalCounters);
+    file << ",\n\"uploadBytes\":{\"lastFrame\":" << frameUploadBytes << ",\"total\":" << totalUploadBytes << "}";
+
+    const WaveUsage& usage = snapshot.waveUsage;
+    file << ",\n\"waves\":{\"count\":" << usage.waves << ",\"liveVertices\":" << usage.liveVertices
+        << ",\"bytes\":" << usage.bytes << ",\"evicted\":" << usage.evicted << ",\"refused\":" << usage.refused
+        << ",\"budget\":{\"liveVertices\":" << snapshot.waveBudget.maxLiveVertices << ",\"bytes\":" << snapshot.waveBudget.maxBytes
+        << ",\"policy\":\"" << WaveBudget::getPolicyName(snapshot.waveBudget.policy) << "\"}}";
+
+    file << ",\n\"spheres\":[";
+    for (i = 0; i < snapshot.sphereLive.size(); ++i)
+        file << (i ? "," : "") << "{\"live\":" << snapshot.sphereLive[i] << ",\"dead\":" << snapshot.sphereDead[i] << "}";
+
+    file << "],\n\"obstacleHits\":[";
+    for (i = 0; i < snapshot.objectHits.size(); ++i)
+        file << (i ? "," : "") << snapshot.objectHits[i];
+    file << "]\n}\n";
+}
+
+void Metrics::writeText(std::ofstream& file, const SceneSnapshot& snapshot)
+{
+    unsigned int i;
+
+    file << "tick " << snapshot.tick << "\n";
+    file << "frames " << frames << "\n";
+
+    file << "vertex_obstacle_tests " << snapshot.tickCounters.vertexObstacleTests << "\n";
+    file << "vertex_obstacle_tests_total " << snapshot.totalCounters.vertexObstacleTests << "\n";
+    file << "room_reflections " << snapshot.tickCounters.roomReflections << "\n";
+    file << "room_reflections_total " << snapshot.totalCounters.roomReflections << "\n";
+    file << "triangles_killed " << snapshot.tickCounters.trianglesKilled << "\n";
+    file << "triangles_killed_total " << snapshot.totalCounters.trianglesKilled << "\n";
+    file << "spheres_retired_total " << snapshot.totalCounters.spheresRetired << "\n";
+    file << "upload_bytes " << frameUploadBytes << "\n";
+    file << "upload_bytes_total " << totalUploadBytes << "\n";
+    file << "waves " << snapshot.waveUsage.waves << "\n";
+    file << "wave_live_vertices " << snapshot.waveUsage.liveVertices << "\n";
+    file << "wave_bytes " << snapshot.waveUsage.bytes << "\n";
+    file << "wave_budget_live_vertices " << snapshot.waveBudget.maxLiveVertices << "\n";
+    file << "wave_budget_bytes " << snapshot.waveBudget.maxBytes << "\n";
+    file << "waves_evicted_total " << snapshot.waveUsage.evicted << "\n";
+    file << "waves_refused_total " << snapshot.waveUsage.refused << "\n";
+
+    for (i = 0; i < snapshot.sphereLive.size(); ++i)
+    {
+        file << "sphere_live{sphere=\"" << i << "\"} " << snapshot.sphereLive[i] << "\n";
+        file << "sphere_dead{sphere=\"" << i << "\"} " << snapshot.sphereDead[i] << "\n";
+    }
+
+    for (i = 0; i < snapshot.objectHits.size(); ++i)
+        file << "obstacle_hits_total{obstacle=\"" << i << "\"} " << snapshot.objectHits[i] << "\n";
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+struct SceneSnapshot;
+
+/**
+ * \brief Simulation event counts, of one tick or since start
+ */
+struct SimulationCounters
+{
+    unsigned long long vertexObstacleTests = 0;
+    unsigned long long roomReflections = 0;
+    unsigned long long trianglesKilled = 0;
+    unsigned long long spheresRetired = 0;
+
+    void add(const SimulationCounters& other);
+};
+
+/**
+ * \brief Counters written by one thread only, padded to its own cache line
+ */
+struct alignas(64) MetricSlot
+{
+    SimulationCounters counters;
+    std::vector<unsigned long long> obstacleHits;
+
+    void addHits(unsigned int obstacle, unsigned long long hits);
+};
+
+/**
+ * \brief Running simulation and upload counters and their periodic dump.
+ *
+ * Simulation threads count into their own slot and the simulation thread
+ * sums the slots of its scene's threads once per tick, so scenes simulated
+ * side by side keep their counts apart. The totals travel to the renderer in the
+ * scene snapshot. A thread gives its slot back when it exits, so pools
+ * created and destroyed run after run keep reusing the same slots.
+ * update() writes them to a file every interval, as JSON
+ * if the name ends with .json and as "name value" lines otherwise. The
+ * file is replaced whole, a reader never sees a partial dump.
+ */
+class Metrics
+{
+public:
+    static const unsigned int MAX_THREADS = 256;
+
+    static Metrics& get();
+
+    MetricSlot& localSlot();
+    void releaseSlot(MetricSlot& slot);
+    void collectTick(const std::vector<MetricSlot*>& threadSlots, SimulationCounters& tick, std::vector<unsigned long long>& objectHits);
+
+    void addUploadBytes(unsigned long long bytes);
+
+    bool open(const std::string& path, float interval);
+    void update(const SceneSnapshot& snapshot, float time);
+
+private:
+    Metrics();
+
+    MetricSlot slots[MAX_THREADS];
+    // Shared by threads past MAX_THREADS, never collected
+    MetricSlot overflow;
+    // Slots of exited threads, handed to new threads first
+    std::vector<MetricSlot*> freeSlots;
+    std::mutex slotMutex;
+    unsigned int slotCount = 0;
+
+    std::atomic<unsigned long long> uploadBytes{ 0 };
+    unsigned long long frameUploadBytes = 0;
+    unsigned long long totalUploadBytes = 0;
+    unsigned long long frames = 0;
+
+    std::string path;
+    float interval = 1.0f;
+    float lastWrite = 0.0f;
+
+    void write(const SceneSnapshot& snapshot);
+    void writeJson(std::ofstream& file, const SceneSnapshot& snapshot);
+    void writeText(std::ofstream& file, const SceneSnapshot& snapshot);
+};
\ No newline at end of file
@@ -43,4 +43,13 @@ public:
     virtual glm::vec4& getColor() = 0;
 
     virtual void toWorld() = 0;
+
+    /**
+     * \brief Deletes the GL objects of every mesh, the context must be current
+     */
+    void releaseMeshes()
+    {
+        for (auto& mesh : getMeshes())
+            mesh.release();
+    }
 };
\ No newline at end of file
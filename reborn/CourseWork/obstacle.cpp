@@ -87,6 +87,11 @@ glm::vec4& Obstacle::getColor()
     return modelSettings.color;
 }
 
+int Obstacle::getInviseMode()
+{
+    return modelSettings.inviseMode;
+}
+
 void Obstacle::toWorld()
 {
     glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelSettings.modelMatrix)));
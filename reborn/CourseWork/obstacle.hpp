@@ -44,6 +44,7 @@ public:
     glm::mat4& getModelMatrix();
     float getSpeed();
     glm::vec4& getColor();
+    int getInviseMode();
 
     void toWorld();
 };
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "offline.hpp"
+#include "capture.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+#include "obstacle.hpp"
+#include "simulator.hpp"
+#include "trace.hpp"
+
+#include <chrono>
+#include <thread>
+
+
+OfflineRenderer::OfflineRenderer(MeshCache& meshCache, Shader& shader, const RenderSettings& settings) :
+    meshCache(meshCache),
+    shader(shader),
+    settings(settings)
+{
+}
+
+bool OfflineRenderer::run()
+{
+    SceneDescription description;
+    if (!settings.scenePath.empty() && !SceneFile::load(settings.scenePath, description))
+        return false;
+
+    if (!settings.cameraPathFile.empty() && !cameraPath.load(settings.cameraPathFile))
+        return false;
+
+    // Encoding threads beside the render and simulation threads
+    unsigned int writerThreads = settings.writerThreads;
+    if (writerThreads == 0)
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        writerThreads = cores > 3 ? cores - 2 : 1;
+    }
+
+    FrameWriter writer(settings.format, settings.outputPath, settings.width, settings.height, writerThreads);
+    if (!writer.isOpen())
+        return false;
+
+    // Every frame is kept, a busy writer holds the renderer back
+    FrameCapture capture(writer, settings.width, settings.height, false);
+
+    Scene scene;
+    scene.setDeterministic(settings.deterministic);
+
+    for (const ObstacleDescription& obstacle : description.obstacles)
+    {
+        glm::mat4 modelMatrix = obstacle.modelMatrix;
+        glm::vec4 modelColor = obstacle.color;
+
+        Obstacle* object = new Obstacle(modelMatrix, modelColor, obstacle.cullMode);
+        meshCache.loadModel(obstacle.mesh, *object);
+        scene.addObject(object);
+        scene.flush();
+    }
+
+    // Sources emit once, at the tick of their launch time
+    std::vector<std::pair<unsigned int, Model*>> launches;
+    for (const WaveSourceDescription& source : description.sources)
+    {
+        glm::mat4 waveMatrix = glm::translate(glm::mat4(1.0f), source.position);
+        glm::vec4 sourceColor = source.color;
+        float sourceSpeed = source.speed;
+
+        Model* wave = new Sphere(waveMatrix, sourceColor, sourceSpeed, false);
+        meshCache.loadModel(description.waveMesh, *wave);
+        launches.push_back(std::make_pair(static_cast<unsigned int>(source.launchTime * settings.frameRate + 0.5f), wave));
+    }
+
+    glm::mat4 mRoom = description.room.modelMatrix;
+    glm::vec4 roomColor = description.room.color;
+    Obstacle room(mRoom, roomColor, GL_FRONT, false);
+    meshCache.loadModel(description.room.mesh, room);
+
+    glm::mat4 proj = glm::perspective(glm::radians(ZOOM), (float)settings.width / (float)settings.height, 0.1f, 100.0f);
+    float glTime = settings.tickTime;
+    unsigned int tick, i;
+
+    shader.use();
+    shader.setVec3("lightColor", description.light.color);
+    shader.setVec3("lightPos", description.light.position);
+    shader.setMat4("proj", proj);
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_CULL_FACE);
+
+    auto start = std::chrono::steady_clock::now();
+
+    Simulator simulator(scene);
+
+    for (tick = 0; tick <= settings.ticks; ++tick)
+    {
+        TRACE_FRAME();
+        TRACE_SCOPE("frame");
+
+        if (tick > 0)
+        {
+            simulator.wait();
+            scene.swap();
+        }
+
+        // Waves added while the simulation is idle join the next tick
+        for (i = 0; i < launches.size(); ++i)
+            if (launches[i].first == tick)
+                scene.addSphere(new Sphere(*launches[i].second));
+
+        if (tick < settings.ticks)
+            simulator.start(settings.tickTime);
+
+        // Tick 0 only starts the simulation, frames show ticks 1 to ticks
+        if (tick == 0)
+            continue;
+
+        Camera camera = cameraPath.isEmpty() ?
+            Camera(settings.cameraPosition, glm::vec3(0.0f, 1.0f, 0.0f), settings.cameraYaw, settings.cameraPitch) :
+            cameraPath.getCamera(static_cast<float>(tick));
+
+        glm::mat4 view = camera.GetViewMatrix();
+
+        shader.use();
+        shader.setVec3("viewPos", camera.Position);
+        shader.setMat4("view", view);
+
+        glClearColor(0.4f, 0.4f, 0.4f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        scene.upload();
+        room.Draw(shader, glTime, scene);
+        scene.render(shader, glTime);
+
+        capture.capture();
+    }
+
+    capture.flush();
+    writer.finish();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Rendered " << writer.getWrittenCount() << " frames in " << seconds << " s, "
+        << (settings.ticks ? seconds * 1000.0 / settings.ticks : 0.0) << " ms per frame" << std::endl;
+
+    scene.releaseMeshes();
+    room.releaseMeshes();
+    for (auto& launch : launches)
+    {
+        launch.second->releaseMeshes();
+        delete launch.second;
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "meshcache.hpp"
+#include "scenefile.hpp"
+#include "camerapath.hpp"
+#include "framewriter.hpp"
+#include "shader.hpp"
+
+#include <string>
+
+
+/**
+ * \brief What the offline renderer draws and where the frames go
+ */
+struct RenderSettings
+{
+    std::string scenePath;
+    unsigned int ticks = 300;
+
+    unsigned int width = 1920;
+    unsigned int height = 1080;
+
+    // printf pattern of the frame number for PNG, one file for raw RGB24
+    std::string outputPath = "frame_%05d.png";
+    FrameWriter::Format format = FrameWriter::PNG;
+    unsigned int writerThreads = 0;
+
+    // Fixed camera, used when there is no camera path
+    glm::vec3 cameraPosition = glm::vec3(20.0f, 20.0f, 20.0f);
+    float cameraYaw = -90.0f;
+    float cameraPitch = 0.0f;
+    std::string cameraPathFile;
+
+    // glTime the simulation gets every tick, fixed so a render is repeatable
+    float tickTime = 1.0f;
+    // Frame rate of the output, converts scene file launch times to ticks
+    float frameRate = 60.0f;
+    bool deterministic = true;
+};
+
+/**
+ * \brief Renders a scene file into an image sequence without a window.
+ *
+ * Every tick is one frame. As in the application the simulation of the
+ * next tick runs on the simulator thread while the current one is drawn.
+ * Frames are read back through the capture ring and encoded by the frame
+ * writer threads meanwhile.
+ */
+class OfflineRenderer
+{
+public:
+    OfflineRenderer(MeshCache& meshCache, Shader& shader, const RenderSettings& settings);
+
+    bool run();
+
+private:
+    MeshCache& meshCache;
+    Shader& shader;
+    RenderSettings settings;
+
+    CameraPath cameraPath;
+};
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "offscreen.hpp"
+
+#ifdef OFFSCREEN_OSMESA
+#include <GL/osmesa.h>
+#else
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+
+
+OffscreenContext::~OffscreenContext()
+{
+    release();
+}
+
+bool OffscreenContext::create(unsigned int width, unsigned int height)
+{
+    this->width = width;
+    this->height = height;
+
+    if (!createContext())
+    {
+        releaseContext();
+        return false;
+    }
+
+    if (!gladLoadGLLoader(
+#ifdef OFFSCREEN_OSMESA
+        (GLADloadproc)OSMesaGetProcAddress
+#else
+        (GLADloadproc)eglGetProcAddress
+#endif
+        ))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        releaseContext();
+        return false;
+    }
+
+    if (!createFramebuffer())
+    {
+        release();
+        return false;
+    }
+
+    return true;
+}
+
+void OffscreenContext::release()
+{
+    if (framebufferID)
+    {
+        glDeleteFramebuffers(1, &framebufferID);
+        glDeleteRenderbuffers(1, &colorID);
+        glDeleteRenderbuffers(1, &depthID);
+        framebufferID = colorID = depthID = 0;
+    }
+
+    releaseContext();
+}
+
+unsigned int OffscreenContext::getWidth()
+{
+    return width;
+}
+
+unsigned int OffscreenContext::getHeight()
+{
+    return height;
+}
+
+#ifdef OFFSCREEN_OSMESA
+
+bool OffscreenContext::createContext()
+{
+    const int attributes[] =
+    {
+        OSMESA_FORMAT, OSMESA_RGBA,
+        OSMESA_DEPTH_BITS, 24,
+        OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+        OSMESA_CONTEXT_MAJOR_VERSION, 3,
+        OSMESA_CONTEXT_MINOR_VERSION, 3,
+        0
+    };
+
+    OSMesaContext osmesaContext = OSMesaCreateContextAttribs(attributes, NULL);
+    if (osmesaContext == NULL)
+    {
+        std::cout << "Failed to create OSMesa context" << std::endl;
+        return false;
+    }
+    context = osmesaContext;
+
+    // The default framebuffer is not read, the framebuffer object is
+    osmesaBuffer.resize(width * height * 4);
+    if (!OSMesaMakeCurrent(osmesaContext, &osmesaBuffer[0], GL_UNSIGNED_BYTE, width, height))
+    {
+        std::cout << "Failed to make OSMesa context current" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void OffscreenContext::releaseContext()
+{
+    if (context)
+        OSMesaDestroyContext(static_cast<OSMesaContext>(context));
+    context = nullptr;
+}
+
+#else
+
+bool OffscreenContext::createContext()
+{
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+
+    // A surfaceless platform display needs no X or Wayland server
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    if (getPlatformDisplay)
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+#endif
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+    {
+        std::cout << "Failed to initialize EGL display" << std::endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    const EGLint configAttributes[] =
+    {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0)
+    {
+        std::cout << "No EGL config for desktop OpenGL" << std::endl;
+        return false;
+    }
+
+    const EGLint contextAttributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT)
+    {
+        std::cout << "Failed to create EGL context" << std::endl;
+        return false;
+    }
+    context = eglContext;
+
+    if (eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+        return true;
+
+    // Without EGL_KHR_surfaceless_context a context needs some surface to be current
+    const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+    EGLSurface eglSurface = eglCreatePbufferSurface(eglDisplay, config, surfaceAttributes);
+    if (eglSurface == EGL_NO_SURFACE)
+    {
+        std::cout << "Failed to create EGL pbuffer surface" << std::endl;
+        return false;
+    }
+    surface = eglSurface;
+
+    if (!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext))
+    {
+        std::cout << "Failed to make EGL context current" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void OffscreenContext::releaseContext()
+{
+    if (display)
+    {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface)
+            eglDestroySurface(display, surface);
+        if (context)
+            eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+
+    display = context = surface = nullptr;
+}
+
+#endif
+
+bool OffscreenContext::createFramebuffer()
+{
+    glGenRenderbuffers(1, &colorID);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorID);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &depthID);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthID);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+    glGenFramebuffers(1, &framebufferID);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorID);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthID);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Offscreen framebuffer is not complete" << std::endl;
+        return false;
+    }
+
+    glViewport(0, 0, width, height);
+
+    return true;
+}
\ No newline at end of file
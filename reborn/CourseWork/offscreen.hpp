@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+
+/**
+ * \brief OpenGL 3.3 core context without a window.
+ *
+ * Uses a surfaceless EGL display (Mesa llvmpipe renders on machines
+ * without a GPU), or OSMesa software rendering in builds defining
+ * OFFSCREEN_OSMESA. Drawing goes to a framebuffer object of the requested
+ * size either way, it stays bound for drawing and reading.
+ */
+class OffscreenContext
+{
+public:
+    ~OffscreenContext();
+
+    bool create(unsigned int width, unsigned int height);
+    void release();
+
+    unsigned int getWidth();
+    unsigned int getHeight();
+
+private:
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    unsigned int framebufferID = 0;
+    unsigned int colorID = 0;
+    unsigned int depthID = 0;
+
+#ifdef OFFSCREEN_OSMESA
+    void* context = nullptr;
+    std::vector<unsigned char> osmesaBuffer;
+#else
+    void* display = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr;
+#endif
+
+    bool createContext();
+    void releaseContext();
+    bool createFramebuffer();
+};
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "optimizer.hpp"
+#include "model.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+
+void MeshOptimizer::optimize(Model& model)
+{
+    std::vector<unsigned int>& indices = model.getIndices();
+    std::vector<Face>& faces = model.getFaces();
+
+    if (model.getVertices().empty() || faces.empty())
+        return;
+
+    float missRatioBefore = vertexCacheMissRatio(indices);
+    unsigned int lineMissesBefore = faceLineMisses(faces);
+
+    // Faces keep their order, the face pass kills triangles in it
+    std::vector<unsigned int> order;
+
+    reorderVertices(model);
+    orderFaces(model, order);
+    rebuildIndices(model, order);
+
+    float missRatioAfter = vertexCacheMissRatio(indices);
+    unsigned int lineMissesAfter = faceLineMisses(faces);
+
+    if (verbose)
+        std::cout << "Mesh optimization: vertex cache misses per triangle " << missRatioBefore << " -> " << missRatioAfter
+            << ", face pass cache line misses " << lineMissesBefore << " -> " << lineMissesAfter << std::endl;
+}
+
+void MeshOptimizer::setVerbose(bool verbose)
+{
+    this->verbose = verbose;
+}
+
+void MeshOptimizer::reorderVertices(Model& model)
+{
+    std::vector<Vertex>& vertices = model.getVertices();
+    std::vector<Face>& faces = model.getFaces();
+
+    glm::vec3 minPoint = vertices[0].Position, maxPoint = vertices[0].Position;
+    unsigned int i, j;
+
+    for (i = 1; i < vertices.size(); ++i)
+    {
+        minPoint = glm::min(minPoint, vertices[i].Position);
+        maxPoint = glm::max(maxPoint, vertices[i].Position);
+    }
+
+    std::vector<unsigned int> codes(vertices.size()), order(vertices.size());
+
+    for (i = 0; i < vertices.size(); ++i)
+    {
+        codes[i] = mortonCode(vertices[i].Position, minPoint, maxPoint - minPoint);
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(),
+        [&codes](unsigned int a, unsigned int b) { return codes[a] < codes[b]; });
+
+    std::vector<Vertex> sorted(vertices.size());
+    std::vector<unsigned int> remap(vertices.size());
+
+    for (i = 0; i < order.size(); ++i)
+    {
+        sorted[i] = vertices[order[i]];
+        remap[order[i]] = i;
+    }
+    vertices.swap(sorted);
+
+    for (i = 0; i < faces.size(); ++i)
+        for (j = 0; j < 3; ++j)
+        {
+            faces[i].Triangles.first[j] = remap[faces[i].Triangles.first[j]];
+            faces[i].Triangles.second[j] = remap[faces[i].Triangles.second[j]];
+        }
+
+    // Triangles without a face pair only live in the index list
+    std::vector<unsigned int>& indices = model.getIndices();
+    for (i = faces.size() * 6; i < indices.size(); ++i)
+        indices[i] = remap[indices[i]];
+}
+
+/**
+ * \brief Draw order of the face pairs, the faces themselves stay in place
+ */
+void MeshOptimizer::orderFaces(Model& model, std::vector<unsigned int>& order)
+{
+    std::vector<Vertex>& vertices = model.getVertices();
+    std::vector<Face>& faces = model.getFaces();
+
+    unsigned int i, j, k;
+
+    // Seed order: face pairs along the Morton curve of their centroids
+    glm::vec3 minPoint = vertices[0].Position, maxPoint = vertices[0].Position;
+    for (i = 1; i < vertices.size(); ++i)
+    {
+        minPoint = glm::min(minPoint, vertices[i].Position);
+        maxPoint = glm::max(maxPoint, vertices[i].Position);
+    }
+
+    std::vector<unsigned int> seed(faces.size()), seedCodes(faces.size());
+    for (i = 0; i < faces.size(); ++i)
+    {
+        const Face& face = faces[i];
+        glm::vec3 centroid = (vertices[face.Triangles.first.x].Position + vertices[face.Triangles.first.y].Position +
+            vertices[face.Triangles.first.z].Position) / 3.0f;
+
+        seedCodes[i] = mortonCode(centroid, minPoint, maxPoint - minPoint);
+        seed[i] = i;
+    }
+    std::stable_sort(seed.begin(), seed.end(),
+        [&seedCodes](unsigned int a, unsigned int b) { return seedCodes[a] < seedCodes[b]; });
+
+    // Vertex to face adjacency
+    std::vector<unsigned int> remaining(vertices.size(), 0);
+    std::vector<std::vector<unsigned int>> adjacency(vertices.size());
+
+    for (i = 0; i < faces.size(); ++i)
+        for (j = 0; j < 6; ++j)
+        {
+            unsigned int v = j < 3 ? faces[i].Triangles.first[j] : faces[i].Triangles.second[j - 3];
+            if (adjacency[v].empty() || adjacency[v].back() != i)
+            {
+                adjacency[v].push_back(i);
+                ++remaining[v];
+            }
+        }
+
+    // Greedy emission with an LRU vertex cache (Forsyth)
+    std::vector<int> cachePosition(vertices.size(), -1);
+    std::vector<unsigned int> cache;
+    std::vector<bool> emitted(faces.size(), false);
+    unsigned int seedCursor = 0;
+
+    order.clear();
+    order.reserve(faces.size());
+    cache.reserve(VERTEX_CACHE_SIZE + 6);
+
+    while (order.size() < faces.size())
+    {
+        int best = -1;
+        float bestScore = -1.0f;
+
+        for (i = 0; i < cache.size(); ++i)
+            for (unsigned int f : adjacency[cache[i]])
+            {
+                if (emitted[f])
+                    continue;
+
+                float score = 0.0f;
+                for (k = 0; k < 6; ++k)
+                {
+                    unsigned int v = k < 3 ? faces[f].Triangles.first[k] : faces[f].Triangles.second[k - 3];
+                    score += vertexScore(cachePosition[v], remaining[v]);
+                }
+
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = f;
+                }
+            }
+
+        if (best < 0)
+        {
+            while (emitted[seed[seedCursor]])
+                ++seedCursor;
+            best = seed[seedCursor];
+        }
+
+        emitted[best] = true;
+        order.push_back(best);
+
+        unsigned int faceVertices[6] = {
+            faces[best].Triangles.first.x, faces[best].Triangles.first.y, faces[best].Triangles.first.z,
+            faces[best].Triangles.second.x, faces[best].Triangles.second.y, faces[best].Triangles.second.z
+        };
+
+        for (k = 0; k < 6; ++k)
+            if (std::find(faceVertices, faceVertices + k, faceVertices[k]) == faceVertices + k)
+                --remaining[faceVertices[k]];
+
+        for (k = 0; k < 6; ++k)
+        {
+            unsigned int v = faceVertices[k];
+
+            if (cachePosition[v] >= 0)
+                cache.erase(cache.begin() + cachePosition[v]);
+            cache.insert(cache.begin(), v);
+
+            for (j = 0; j < cache.size(); ++j)
+                cachePosition[cache[j]] = j;
+        }
+
+        while (cache.size() > VERTEX_CACHE_SIZE)
+        {
+            cachePosition[cache.back()] = -1;
+            cache.pop_back();
+        }
+    }
+}
+
+void MeshOptimizer::rebuildIndices(Model& model, const std::vector<unsigned int>& order)
+{
+    std::vector<unsigned int>& indices = model.getIndices();
+    std::vector<Face>& faces = model.getFaces();
+
+    unsigned int i;
+
+    for (i = 0; i < order.size(); ++i)
+    {
+        const Face& face = faces[order[i]];
+
+        indices[i * 6 + 0] = face.Triangles.first.x;
+        indices[i * 6 + 1] = face.Triangles.first.y;
+        indices[i * 6 + 2] = face.Triangles.first.z;
+        indices[i * 6 + 3] = face.Triangles.second.x;
+        indices[i * 6 + 4] = face.Triangles.second.y;
+        indices[i * 6 + 5] = face.Triangles.second.z;
+    }
+}
+
+unsigned int MeshOptimizer::mortonCode(const glm::vec3& point, const glm::vec3& minPoint, const glm::vec3& extent)
+{
+    unsigned int code = 0, axis;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        float t = extent[axis] > 0.0f ? (point[axis] - minPoint[axis]) / extent[axis] : 0.0f;
+        unsigned int v = (unsigned int)(glm::clamp(t, 0.0f, 1.0f) * 1023.0f);
+
+        // Spread 10 bits three apart
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+
+        code |= v << (2 - axis);
+    }
+
+    return code;
+}
+
+float MeshOptimizer::vertexScore(int cachePosition, unsigned int remainingFaces)
+{
+    if (remainingFaces == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+
+    // A face pair emits up to six vertices at once
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 6)
+            score = 0.75f;
+        else
+            score = std::pow(1.0f - (float)(cachePosition - 6) / (VERTEX_CACHE_SIZE - 6), 1.5f);
+    }
+
+    return score + 2.0f / std::sqrt((float)remainingFaces);
+}
+
+float MeshOptimizer::vertexCacheMissRatio(const std::vector<unsigned int>& indices)
+{
+    std::vector<unsigned int> fifo(FIFO_CACHE_SIZE, UINT_MAX);
+    unsigned int i, head = 0, misses = 0;
+
+    for (i = 0; i < indices.size(); ++i)
+        if (std::find(fifo.begin(), fifo.end(), indices[i]) == fifo.end())
+        {
+            fifo[head] = indices[i];
+            head = (head + 1) % FIFO_CACHE_SIZE;
+            ++misses;
+        }
+
+    return indices.size() >= 3 ? (float)misses / (indices.size() / 3) : 0.0f;
+}
+
+unsigned int MeshOptimizer::faceLineMisses(const std::vector<Face>& faces)
+{
+    // Direct-mapped model of the decoded position array read by the face pass
+    std::vector<unsigned int> lines(CACHE_LINES, UINT_MAX);
+    unsigned int i, j, misses = 0;
+
+    for (i = 0; i < faces.size(); ++i)
+        for (j = 0; j < 6; ++j)
+        {
+            unsigned int v = j < 3 ? faces[i].Triangles.first[j] : faces[i].Triangles.second[j - 3];
+            unsigned int line = v * sizeof(glm::vec3) / CACHE_LINE_SIZE;
+
+            if (lines[line % CACHE_LINES] != line)
+            {
+                lines[line % CACHE_LINES] = line;
+                ++misses;
+            }
+        }
+
+    return misses;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <vector>
+
+
+class Model;
+
+/**
+ * \brief Import-time reordering of model data for memory locality.
+ *
+ * Vertices are sorted along a Morton curve so the simulation loops walk
+ * neighbouring vertices together, and indices and faces are remapped to
+ * match. The index buffer draws the face pairs in an order for the GPU
+ * post-transform cache, while the faces keep their imported order. The
+ * face pass kills triangles in face order, so that order is part of the
+ * simulation result.
+ */
+class MeshOptimizer
+{
+public:
+    void optimize(Model& model);
+    void setVerbose(bool verbose);
+
+private:
+    static const unsigned int VERTEX_CACHE_SIZE = 32;
+    static const unsigned int FIFO_CACHE_SIZE = 16;
+    static const unsigned int CACHE_LINE_SIZE = 64;
+    static const unsigned int CACHE_LINES = 512;
+
+    bool verbose = true;
+
+    void reorderVertices(Model& model);
+    void orderFaces(Model& model, std::vector<unsigned int>& order);
+    void rebuildIndices(Model& model, const std::vector<unsigned int>& order);
+
+    static unsigned int mortonCode(const glm::vec3& point, const glm::vec3& minPoint, const glm::vec3& extent);
+    static float vertexScore(int cachePosition, unsigned int remainingFaces);
+
+    float vertexCacheMissRatio(const std::vector<unsigned int>& indices);
+    unsigned int faceLineMisses(const std::vector<Face>& faces);
+};
\ No newline at end of file
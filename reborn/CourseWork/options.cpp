@@ -0,0 +1,103 @@
+#include "options.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(arg, "--width") == 0 && hasValue)
+            options.width = atoi(argv[++i]);
+        else if (strcmp(arg, "--height") == 0 && hasValue)
+            options.height = atoi(argv[++i]);
+        else if (strcmp(arg, "--scene") == 0 && hasValue)
+            options.scenePath = argv[++i];
+        else if (strcmp(arg, "--deterministic") == 0)
+            options.deterministic = true;
+        else if (strcmp(arg, "--hash-log") == 0 && hasValue)
+        {
+            options.hashLog = argv[++i];
+            options.deterministic = true;
+        }
+        else if (strcmp(arg, "--record") == 0 && hasValue)
+            options.recordPath = argv[++i];
+        else if (strcmp(arg, "--replay") == 0 && hasValue)
+            options.replayPath = argv[++i];
+        else if (strcmp(arg, "--replay-fast") == 0)
+            options.replayFast = true;
+        else if (strcmp(arg, "--capture") == 0 && hasValue)
+            options.capturePath = argv[++i];
+        else if (strcmp(arg, "--capture-threads") == 0 && hasValue)
+            options.captureThreads = atoi(argv[++i]);
+        else if (strcmp(arg, "--record-trajectory") == 0 && hasValue)
+            options.trajectoryRecordPath = argv[++i];
+        else if (strcmp(arg, "--play-trajectory") == 0 && hasValue)
+            options.trajectoryPlayPath = argv[++i];
+        else if (strcmp(arg, "--export-state") == 0 && hasValue)
+            options.exportName = argv[++i];
+        else if (strcmp(arg, "--export-vertices") == 0 && hasValue)
+            options.exportVertices = atoi(argv[++i]);
+        else if (strcmp(arg, "--wave-budget-vertices") == 0 && hasValue)
+            options.waveBudgetVertices = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--wave-budget-mb") == 0 && hasValue)
+            options.waveBudgetMegabytes = atoi(argv[++i]);
+        else if (strcmp(arg, "--wave-budget-policy") == 0 && hasValue)
+            options.waveBudgetPolicy = argv[++i];
+        else if (strcmp(arg, "--checkpoint-interval") == 0 && hasValue)
+            options.checkpointInterval = atoi(argv[++i]);
+        else if (strcmp(arg, "--checkpoint-budget") == 0 && hasValue)
+            options.checkpointBudget = atoi(argv[++i]);
+        else if (strcmp(arg, "--profile-csv") == 0 && hasValue)
+            options.profileCsv = argv[++i];
+        else if (strcmp(arg, "--trace") == 0 && hasValue)
+        {
+            options.tracePath = argv[++i];
+            options.traceOnExit = true;
+        }
+        else if (strcmp(arg, "--trace-frames") == 0 && hasValue)
+            options.traceFrames = atoi(argv[++i]);
+        else if (strcmp(arg, "--metrics") == 0 && hasValue)
+            options.metricsPath = argv[++i];
+        else if (strcmp(arg, "--metrics-interval") == 0 && hasValue)
+            options.metricsInterval = static_cast<float>(atof(argv[++i]));
+        else if (strcmp(arg, "--frames") == 0 && hasValue)
+            options.frames = atoi(argv[++i]);
+        else if (strcmp(arg, "--alloc-check") == 0)
+            options.allocationCheck = true;
+        else if (strcmp(arg, "--alloc-warmup") == 0 && hasValue)
+            options.allocationWarmup = atoi(argv[++i]);
+        else
+        {
+            std::cout << "Unknown argument: " << arg << std::endl;
+            std::cout << "Usage: CourseWork [--width <pixels>] [--height <pixels>]" << std::endl;
+            std::cout << "                  [--scene <file>] [--deterministic] [--hash-log <file>] [--profile-csv <file>]" << std::endl;
+            std::cout << "                  [--record <file>] [--replay <file>] [--replay-fast]" << std::endl;
+            std::cout << "                  [--capture <png pattern | raw file>] [--capture-threads <count>]" << std::endl;
+            std::cout << "                  [--record-trajectory <file>] [--play-trajectory <file>]" << std::endl;
+            std::cout << "                  [--export-state <name>] [--export-vertices <count>]" << std::endl;
+            std::cout << "                  [--wave-budget-vertices <count>] [--wave-budget-mb <MiB>]" << std::endl;
+            std::cout << "                  [--wave-budget-policy oldest|faintest|contribution|refuse]" << std::endl;
+            std::cout << "                  [--checkpoint-interval <ticks>] [--checkpoint-budget <MiB>]" << std::endl;
+            std::cout << "                  [--trace <file>] [--trace-frames <count>]" << std::endl;
+            std::cout << "                  [--metrics <file>] [--metrics-interval <seconds>]" << std::endl;
+            std::cout << "                  [--frames <count>] [--alloc-check] [--alloc-warmup <frames>]" << std::endl;
+            return false;
+        }
+    }
+
+    if (options.width == 0 || options.height == 0)
+    {
+        std::cout << "Window size must not be zero" << std::endl;
+        return false;
+    }
+
+    return true;
+}
\ No newline at end of file
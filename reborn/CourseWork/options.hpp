@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+
+
+/**
+ * \brief Command line settings of a run
+ */
+struct Options
+{
+    // Window size
+    unsigned int width = 1920;
+    unsigned int height = 1080;
+
+    // Scene file loaded at start, text or binary
+    std::string scenePath;
+
+    // Simulation
+    bool deterministic = false;
+    std::string hashLog;
+
+    // Session log of inputs and edits, a replay runs unpaced with replayFast
+    std::string recordPath;
+    std::string replayPath;
+    bool replayFast = false;
+
+    // Frame capture, a printf pattern for PNG files or a .rgb raw stream. F9 pauses and resumes
+    std::string capturePath;
+    unsigned int captureThreads = 2;
+
+    // Wavefront trajectory written every tick, or played back instead of simulating
+    std::string trajectoryRecordPath;
+    std::string trajectoryPlayPath;
+
+    // Live state exported to a named shared memory segment for external readers
+    std::string exportName;
+    unsigned int exportVertices = 1 << 22;
+
+    // Live wave budget, 0 leaves a limit off. Policy: oldest, faintest, contribution or refuse
+    unsigned long long waveBudgetVertices = 0;
+    unsigned int waveBudgetMegabytes = 0;
+    std::string waveBudgetPolicy = "oldest";
+
+    // Checkpoints for seeking in time, a budget of 0 turns them off
+    unsigned int checkpointInterval = 30;
+    unsigned int checkpointBudget = 64;
+
+    // Profiling
+    std::string profileCsv;
+
+    // Tracing, F12 dumps the last traceFrames frames at any time
+    std::string tracePath = "trace.json";
+    unsigned int traceFrames = 120;
+    bool traceOnExit = false;
+
+    // Counters dump, JSON if the file name ends with .json
+    std::string metricsPath;
+    float metricsInterval = 1.0f;
+
+    // Benchmark run: quit after a number of frames, fail if a frame after warmup allocates
+    unsigned int frames = 0;
+    bool allocationCheck = false;
+    unsigned int allocationWarmup = 120;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options);
\ No newline at end of file
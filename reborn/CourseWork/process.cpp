@@ -0,0 +1,162 @@
+#include "process.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+#include <iostream>
+
+
+Process::~Process()
+{
+    if (started && !exited)
+        wait();
+
+#ifdef _WIN32
+    if (processHandle)
+        CloseHandle(processHandle);
+#endif
+}
+
+#ifdef _WIN32
+
+bool Process::start(const std::string& path, const std::vector<std::string>& arguments)
+{
+    std::string commandLine = "\"" + path + "\"";
+
+    for (const std::string& argument : arguments)
+        commandLine += " \"" + argument + "\"";
+
+    STARTUPINFOA startupInfo;
+    PROCESS_INFORMATION processInfo;
+
+    ZeroMemory(&startupInfo, sizeof(startupInfo));
+    startupInfo.cb = sizeof(startupInfo);
+
+    // The executable is looked up like a command, ".exe" may be left out
+    if (!CreateProcessA(NULL, &commandLine[0], NULL, NULL, FALSE, 0, NULL, NULL, &startupInfo, &processInfo))
+    {
+        std::cout << "Failed to start process: " << path << std::endl;
+        return false;
+    }
+
+    CloseHandle(processInfo.hThread);
+    processHandle = processInfo.hProcess;
+    started = true;
+    exited = false;
+
+    return true;
+}
+
+bool Process::isRunning()
+{
+    if (!started || exited)
+        return false;
+
+    if (WaitForSingleObject(processHandle, 0) != WAIT_OBJECT_0)
+        return true;
+
+    DWORD code = 0;
+    GetExitCodeProcess(processHandle, &code);
+    exitCode = (int)code;
+    exited = true;
+
+    return false;
+}
+
+void Process::wait()
+{
+    if (!started || exited)
+        return;
+
+    WaitForSingleObject(processHandle, INFINITE);
+    isRunning();
+}
+
+void Process::kill()
+{
+    if (isRunning())
+        TerminateProcess(processHandle, 1);
+}
+
+unsigned int Process::getCurrentId()
+{
+    return GetCurrentProcessId();
+}
+
+#else
+
+bool Process::start(const std::string& path, const std::vector<std::string>& arguments)
+{
+    std::vector<char*> argv;
+
+    argv.push_back(const_cast<char*>(path.c_str()));
+    for (const std::string& argument : arguments)
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    argv.push_back(nullptr);
+
+    // A path without a slash is looked up in PATH, like a command
+    if (posix_spawnp(&pid, path.c_str(), NULL, NULL, &argv[0], environ) != 0)
+    {
+        std::cout << "Failed to start process: " << path << std::endl;
+        return false;
+    }
+
+    started = true;
+    exited = false;
+
+    return true;
+}
+
+bool Process::isRunning()
+{
+    if (!started || exited)
+        return false;
+
+    int status = 0;
+    if (waitpid(pid, &status, WNOHANG) == 0)
+        return true;
+
+    // A process killed by a signal reports the negated signal number
+    exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+    exited = true;
+
+    return false;
+}
+
+void Process::wait()
+{
+    if (!started || exited)
+        return;
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+    exited = true;
+}
+
+void Process::kill()
+{
+    if (isRunning())
+        ::kill(pid, SIGKILL);
+}
+
+unsigned int Process::getCurrentId()
+{
+    return getpid();
+}
+
+#endif
+
+int Process::getExitCode()
+{
+    return exitCode;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief Child process started from an executable and its arguments.
+ * isRunning() never blocks, a process that ended keeps its exit code
+ */
+class Process
+{
+public:
+    ~Process();
+
+    bool start(const std::string& path, const std::vector<std::string>& arguments);
+    bool isRunning();
+    int getExitCode();
+    void wait();
+    void kill();
+
+    static unsigned int getCurrentId();
+
+private:
+    bool started = false;
+    bool exited = false;
+    int exitCode = 0;
+
+#ifdef _WIN32
+    void* processHandle = nullptr;
+#else
+    int pid = 0;
+#endif
+};
\ No newline at end of file
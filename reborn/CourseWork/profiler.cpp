@@ -0,0 +1,316 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+
+/**
+ * \brief History value of a frame without a GPU time
+ */
+const float NO_TIME = -1.0f;
+
+Profiler& Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+{
+    unsigned int i, j;
+
+    for (i = 0; i < PHASE_COUNT; ++i)
+    {
+        pending[i] = 0;
+        pendingAllocations[i] = 0;
+        pendingBytes[i] = 0;
+        for (j = 0; j < HISTORY; ++j)
+            history[i][j] = i == GPU ? NO_TIME : 0.0f;
+    }
+
+    for (i = 0; i < HISTORY; ++i)
+        obstacles[i] = 0;
+
+    for (i = 0; i < GPU_QUERIES; ++i)
+    {
+        queries[i] = 0;
+        queryFrames[i] = 0;
+        queryPending[i] = false;
+    }
+
+    frameStart = std::chrono::steady_clock::now();
+}
+
+Profiler::~Profiler()
+{
+}
+
+void Profiler::init()
+{
+    glGenQueries(GPU_QUERIES, queries);
+    queriesCreated = true;
+}
+
+void Profiler::release()
+{
+    // Rows still waiting for their GPU time are written without it
+    writeCsv(frame);
+    if (csv.is_open())
+        csv.close();
+
+    if (queriesCreated)
+        glDeleteQueries(GPU_QUERIES, queries);
+    queriesCreated = false;
+}
+
+bool Profiler::openCsv(const std::string& path)
+{
+    csv.open(path);
+    if (!csv.is_open())
+    {
+        std::cout << "Failed to open profile file: " << path << std::endl;
+        return false;
+    }
+
+    csv << std::fixed << std::setprecision(3);
+    csvFrame = frame;
+
+    return true;
+}
+
+void Profiler::beginFrame()
+{
+    frameStart = std::chrono::steady_clock::now();
+    frameStartAllocations = AllocationTracker::getTotal();
+    history[GPU][frame % HISTORY] = NO_TIME;
+}
+
+void Profiler::endFrame(unsigned int obstacleCount)
+{
+    // Frame allocations are those of every thread
+    AllocationCounts frameAllocations = AllocationTracker::getTotal();
+
+    frameAllocations.count -= frameStartAllocations.count;
+    frameAllocations.bytes -= frameStartAllocations.bytes;
+
+    add(FRAME, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - frameStart).count(), frameAllocations);
+
+    readQueries();
+    collect(false);
+
+    obstacles[frame % HISTORY] = obstacleCount;
+    ++frame;
+
+    if (frame > GPU_QUERIES)
+        writeCsv(frame - GPU_QUERIES);
+}
+
+void Profiler::collectTick()
+{
+    collect(true);
+}
+
+void Profiler::beginGpu()
+{
+    queryStarted = false;
+    if (!queriesCreated)
+        return;
+
+    // A query that is still in flight keeps its slot, this frame goes untimed
+    if (queryPending[currentQuery])
+    {
+        readQueries();
+        if (queryPending[currentQuery])
+            return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, queries[currentQuery]);
+    queryFrames[currentQuery] = frame;
+    queryStarted = true;
+}
+
+void Profiler::endGpu()
+{
+    if (!queryStarted)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    queryPending[currentQuery] = true;
+    currentQuery = (currentQuery + 1) % GPU_QUERIES;
+    queryStarted = false;
+}
+
+void Profiler::add(Phase phase, long long nanoseconds, const AllocationCounts& allocations)
+{
+    pending[phase].fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    if (allocations.count)
+    {
+        pendingAllocations[phase].fetch_add(allocations.count, std::memory_order_relaxed);
+        pendingBytes[phase].fetch_add(allocations.bytes, std::memory_order_relaxed);
+    }
+}
+
+const char* Profiler::getName(Phase phase)
+{
+    static const char* names[PHASE_COUNT] =
+    {
+        "frame",
+        "gui",
+        "input",
+        "sim wait",
+        "simulation",
+        "wave advance",
+        "obstacle tests",
+        "face pass",
+        "upload",
+        "draw",
+        "capture",
+        "swap",
+        "gpu"
+    };
+
+    return names[phase];
+}
+
+float Profiler::getLast(Phase phase)
+{
+    if (frame == 0)
+        return 0.0f;
+
+    // The newest GPU time is GPU_QUERIES frames old
+    if (phase == GPU)
+    {
+        unsigned long long i;
+        for (i = frame; i > 0 && frame - i < HISTORY; --i)
+            if (history[GPU][(i - 1) % HISTORY] != NO_TIME)
+                return history[GPU][(i - 1) % HISTORY];
+        return 0.0f;
+    }
+
+    return history[phase][(frame - 1) % HISTORY];
+}
+
+float Profiler::getPercentile(Phase phase, float percentile)
+{
+    unsigned int i, count = 0, size = getHistorySize();
+
+    for (i = 0; i < size; ++i)
+        if (history[phase][i] != NO_TIME)
+            sorted[count++] = history[phase][i];
+
+    if (count == 0)
+        return 0.0f;
+
+    unsigned int rank = static_cast<unsigned int>(percentile / 100.0f * (count - 1) + 0.5f);
+    std::nth_element(sorted, sorted + rank, sorted + count);
+
+    return sorted[rank];
+}
+
+const float* Profiler::getHistory(Phase phase)
+{
+    return history[phase];
+}
+
+unsigned int Profiler::getHistoryOffset()
+{
+    return frame < HISTORY ? 0 : frame % HISTORY;
+}
+
+unsigned int Profiler::getHistorySize()
+{
+    return frame < HISTORY ? static_cast<unsigned int>(frame) : HISTORY;
+}
+
+const AllocationCounts& Profiler::getAllocations(Phase phase)
+{
+    return allocations[phase];
+}
+
+void Profiler::printAllocations()
+{
+    unsigned int i;
+
+    std::cout << "Frame " << frame << " allocated " << allocations[FRAME].count << " times ("
+        << allocations[FRAME].bytes << " bytes)";
+
+    for (i = FRAME + 1; i < PHASE_COUNT; ++i)
+        if (allocations[i].count)
+            std::cout << ", " << getName(static_cast<Phase>(i)) << " " << allocations[i].count
+                << " (" << allocations[i].bytes << " bytes)";
+
+    std::cout << std::endl;
+}
+
+bool Profiler::isSimulationPhase(Phase phase)
+{
+    return phase == SIMULATION || phase == WAVE_ADVANCE || phase == OBSTACLE_TESTS || phase == FACE_PASS;
+}
+
+void Profiler::collect(bool simulation)
+{
+    unsigned int i;
+
+    for (i = 0; i < PHASE_COUNT; ++i)
+    {
+        Phase phase = static_cast<Phase>(i);
+        if (phase == GPU || isSimulationPhase(phase) != simulation)
+            continue;
+
+        history[i][frame % HISTORY] = pending[i].exchange(0, std::memory_order_relaxed) / 1000.0f;
+        allocations[i].count = pendingAllocations[i].exchange(0, std::memory_order_relaxed);
+        allocations[i].bytes = pendingBytes[i].exchange(0, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::readQueries()
+{
+    unsigned int i;
+    GLint available;
+    GLuint64 elapsed;
+
+    for (i = 0; i < GPU_QUERIES; ++i)
+    {
+        if (!queryPending[i])
+            continue;
+
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+        queryPending[i] = false;
+
+        if (frame - queryFrames[i] < HISTORY)
+            history[GPU][queryFrames[i] % HISTORY] = elapsed / 1000.0f;
+    }
+}
+
+void Profiler::writeCsv(unsigned long long lastFrame)
+{
+    unsigned int i;
+
+    if (!csv.is_open())
+        return;
+
+    // Frames that already left the history are lost
+    if (frame - csvFrame > HISTORY)
+        csvFrame = frame - HISTORY;
+
+    for (; csvFrame < lastFrame; ++csvFrame)
+    {
+        unsigned int slot = csvFrame % HISTORY;
+
+        csv << obstacles[slot] << "," << history[FRAME][slot];
+        for (i = FRAME + 1; i < PHASE_COUNT; ++i)
+        {
+            csv << ",";
+            if (history[i][slot] != NO_TIME)
+                csv << history[i][slot];
+        }
+        csv << "\n";
+    }
+}
\ No newline at end of file
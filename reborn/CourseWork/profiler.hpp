@@ -0,0 +1,151 @@
+#pragma once
+
+#include "allocation.hpp"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+
+
+/**
+ * \brief Per-frame timings of the main loop phases.
+ *
+ * Phases may be timed from any thread, a phase run by several threads
+ * in one frame reports the summed time. Simulation phases belong to the
+ * tick collected with collectTick(), render phases to the frame closed
+ * with endFrame(). GPU time is read from GL_TIME_ELAPSED queries a few
+ * frames later, so the CPU never waits for a result. Heap allocations are
+ * counted the same way when AllocationTracker is compiled in.
+ */
+class Profiler
+{
+public:
+    enum Phase
+    {
+        FRAME,
+        GUI,
+        INPUT,
+        SIM_WAIT,
+        SIMULATION,
+        WAVE_ADVANCE,
+        OBSTACLE_TESTS,
+        FACE_PASS,
+        UPLOAD,
+        DRAW,
+        CAPTURE,
+        SWAP,
+        GPU,
+        PHASE_COUNT
+    };
+
+    /**
+     * \brief Frames kept for the rolling percentiles
+     */
+    static const unsigned int HISTORY = 256;
+    /**
+     * \brief Timer queries in flight, also the delay of the GPU time
+     */
+    static const unsigned int GPU_QUERIES = 4;
+
+    static Profiler& get();
+
+    void init();
+    void release();
+
+    /**
+     * \brief Writes a row per frame: obstacle count, frame time and every
+     * other phase in enum order, in microseconds. The first two columns are
+     * what measure.py plots, a GPU time that never arrived is left empty.
+     */
+    bool openCsv(const std::string& path);
+
+    void beginFrame();
+    void endFrame(unsigned int obstacleCount);
+    void collectTick();
+
+    void beginGpu();
+    void endGpu();
+
+    void add(Phase phase, long long nanoseconds, const AllocationCounts& allocations = AllocationCounts());
+
+    static const char* getName(Phase phase);
+    float getLast(Phase phase);
+    float getPercentile(Phase phase, float percentile);
+    const float* getHistory(Phase phase);
+    unsigned int getHistoryOffset();
+    unsigned int getHistorySize();
+
+    const AllocationCounts& getAllocations(Phase phase);
+    void printAllocations();
+
+private:
+    Profiler();
+    ~Profiler();
+
+    // Time added since the last collection, in nanoseconds
+    std::atomic<long long> pending[PHASE_COUNT];
+    std::atomic<unsigned long long> pendingAllocations[PHASE_COUNT];
+    std::atomic<unsigned long long> pendingBytes[PHASE_COUNT];
+
+    // Allocations of the last frame
+    AllocationCounts allocations[PHASE_COUNT];
+    AllocationCounts frameStartAllocations;
+
+    // Microseconds per frame, HISTORY frames ring
+    float history[PHASE_COUNT][HISTORY];
+    unsigned int obstacles[HISTORY];
+    unsigned long long frame = 0;
+
+    float sorted[HISTORY];
+
+    std::chrono::steady_clock::time_point frameStart;
+
+    GLuint queries[GPU_QUERIES];
+    unsigned long long queryFrames[GPU_QUERIES];
+    bool queryPending[GPU_QUERIES];
+    unsigned int currentQuery = 0;
+    bool queryStarted = false;
+    bool queriesCreated = false;
+
+    std::ofstream csv;
+    unsigned long long csvFrame = 0;
+
+    static bool isSimulationPhase(Phase phase);
+
+    void collect(bool simulation);
+    void readQueries();
+    void writeCsv(unsigned long long lastFrame);
+};
+
+/**
+ * \brief Adds the lifetime of the scope to a profiler phase
+ */
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler::Phase phase) :
+        phase(phase),
+        start(std::chrono::steady_clock::now()),
+        startAllocations(AllocationTracker::getThread())
+    {
+    }
+
+    ~ProfileScope()
+    {
+        AllocationCounts allocations = AllocationTracker::getThread();
+
+        allocations.count -= startAllocations.count;
+        allocations.bytes -= startAllocations.bytes;
+
+        Profiler::get().add(phase, std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count(), allocations);
+    }
+
+private:
+    Profiler::Phase phase;
+    std::chrono::steady_clock::time_point start;
+    AllocationCounts startAllocations;
+};
\ No newline at end of file
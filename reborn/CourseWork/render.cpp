@@ -0,0 +1,101 @@
+#include "offline.hpp"
+#include "offscreen.hpp"
+#include "loader.hpp"
+#include "meshcache.hpp"
+#include "shader.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+int main(int argc, char* argv[])
+{
+    RenderSettings settings;
+    bool formatSet = false, outputSet = false;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--scene") == 0 && hasValue)
+            settings.scenePath = argv[++i];
+        else if (strcmp(argv[i], "--ticks") == 0 && hasValue)
+            settings.ticks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--width") == 0 && hasValue)
+            settings.width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && hasValue)
+            settings.height = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && hasValue)
+        {
+            settings.outputPath = argv[++i];
+            outputSet = true;
+        }
+        else if (strcmp(argv[i], "--format") == 0 && hasValue && (strcmp(argv[i + 1], "png") == 0 || strcmp(argv[i + 1], "raw") == 0))
+        {
+            settings.format = strcmp(argv[++i], "png") == 0 ? FrameWriter::PNG : FrameWriter::RAW;
+            formatSet = true;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+            settings.writerThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--camera") == 0 && i + 5 < argc)
+        {
+            settings.cameraPosition.x = static_cast<float>(atof(argv[++i]));
+            settings.cameraPosition.y = static_cast<float>(atof(argv[++i]));
+            settings.cameraPosition.z = static_cast<float>(atof(argv[++i]));
+            settings.cameraYaw = static_cast<float>(atof(argv[++i]));
+            settings.cameraPitch = static_cast<float>(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--camera-path") == 0 && hasValue)
+            settings.cameraPathFile = argv[++i];
+        else if (strcmp(argv[i], "--tick-time") == 0 && hasValue)
+            settings.tickTime = static_cast<float>(atof(argv[++i]));
+        else if (strcmp(argv[i], "--fps") == 0 && hasValue)
+            settings.frameRate = static_cast<float>(atof(argv[++i]));
+        else
+        {
+            std::cout << "Usage: Render [--scene <file>] [--ticks <count>] [--width <pixels>] [--height <pixels>]" << std::endl;
+            std::cout << "              [--out <png pattern | raw file>] [--format png|raw] [--threads <count>]" << std::endl;
+            std::cout << "              [--camera <x> <y> <z> <yaw> <pitch>] [--camera-path <file>]" << std::endl;
+            std::cout << "              [--tick-time <seconds>] [--fps <frames>]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // A .rgb or .raw output is a raw stream unless the format says otherwise
+    if (!formatSet)
+        settings.format = FrameWriter::getFormat(settings.outputPath);
+    if (!outputSet && settings.format == FrameWriter::RAW)
+        settings.outputPath = "frames.rgb";
+
+    if (settings.width == 0 || settings.height == 0)
+    {
+        std::cout << "Frame size must not be zero" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    OffscreenContext context;
+    if (!context.create(settings.width, settings.height))
+        return EXIT_FAILURE;
+
+    bool rendered;
+
+    {
+        Shader shader("shaders/shader.vert", "shaders/shader.frag");
+        Loader loader;
+        MeshCache meshCache(loader);
+
+        OfflineRenderer renderer(meshCache, shader, settings);
+        rendered = renderer.run();
+    }
+
+    context.release();
+
+    if (rendered && settings.format == FrameWriter::RAW)
+        std::cout << "Play with: ffplay -f rawvideo -pixel_format rgb24 -video_size "
+            << settings.width << "x" << settings.height << " -framerate " << settings.frameRate
+            << " " << settings.outputPath << std::endl;
+
+    return rendered ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include "resultcache.hpp"
+#include "trace.hpp"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+/**
+ * \brief Entry file layout: magic, version, key and data size, then the data
+ */
+static const unsigned int RESULT_CACHE_MAGIC = 0x43525743;     // "CWRC"
+static const unsigned int RESULT_CACHE_VERSION = 1;
+static const unsigned int RESULT_HEADER_SIZE = 4 + 4 + 8 + 8;
+
+/**
+ * \brief Part of every scene key, raised with any change that alters simulation results
+ */
+static const unsigned int SIMULATION_VERSION = 3;
+
+void ContentHash::add(const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t i;
+
+    for (i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+unsigned long long ContentHash::get()
+{
+    return hash;
+}
+
+ResultCache::ResultCache(const std::string& directory, unsigned long long budget) :
+    directory(directory),
+    budget(budget)
+{
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+
+    loadIndex();
+}
+
+ResultCache::~ResultCache()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (indexChanged)
+        saveIndex();
+}
+
+bool ResultCache::load(unsigned long long key, std::vector<unsigned char>& data)
+{
+    TRACE_SCOPE("ResultCache::load");
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = entries.find(key);
+    if (found == entries.end())
+    {
+        ++misses;
+        return false;
+    }
+
+    std::ifstream file(getEntryPath(key), std::ios::binary);
+    unsigned int magic = 0, version = 0;
+    unsigned long long storedKey = 0, size = 0;
+
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&storedKey, sizeof(storedKey));
+    file.read((char*)&size, sizeof(size));
+
+    bool valid = file && magic == RESULT_CACHE_MAGIC && version == RESULT_CACHE_VERSION &&
+        storedKey == key && RESULT_HEADER_SIZE + size == found->second.size;
+    if (valid)
+    {
+        data.resize(size);
+        if (size > 0)
+            file.read((char*)&data[0], size);
+        valid = static_cast<bool>(file);
+    }
+
+    if (!valid)
+    {
+        file.close();
+        drop(key);
+        indexChanged = true;
+        ++misses;
+        return false;
+    }
+
+    found->second.lastUse = ++useClock;
+    indexChanged = true;
+    ++hits;
+
+    return true;
+}
+
+/**
+ * \brief Writes an entry and evicts past the budget, an entry larger than the budget is not kept
+ */
+void ResultCache::store(unsigned long long key, const std::vector<unsigned char>& data)
+{
+    TRACE_SCOPE("ResultCache::store");
+
+    unsigned long long size = data.size();
+    if (RESULT_HEADER_SIZE + size > budget)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Written aside and renamed, a crash never leaves a torn entry under the key
+    std::string path = getEntryPath(key);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+        file.write((const char*)&RESULT_CACHE_MAGIC, sizeof(RESULT_CACHE_MAGIC));
+        file.write((const char*)&RESULT_CACHE_VERSION, sizeof(RESULT_CACHE_VERSION));
+        file.write((const char*)&key, sizeof(key));
+        file.write((const char*)&size, sizeof(size));
+        if (size > 0)
+            file.write((const char*)&data[0], size);
+
+        if (!file)
+        {
+            std::cout << "Failed to write result cache entry: " << temporary << std::endl;
+            file.close();
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+
+    drop(key);
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::cout << "Failed to write result cache entry: " << path << std::endl;
+        std::remove(temporary.c_str());
+        indexChanged = true;
+        return;
+    }
+
+    Entry& entry = entries[key];
+    entry.size = RESULT_HEADER_SIZE + size;
+    entry.lastUse = ++useClock;
+    totalSize += entry.size;
+
+    // Evicting rewrites the index, a plain store only appends its line
+    unsigned long long evicted = evictions;
+    evict(key);
+    if (evictions != evicted || !indexSaved)
+        saveIndex();
+    else
+        appendIndex(key, entry);
+}
+
+unsigned long long ResultCache::getHits()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+unsigned long long ResultCache::getMisses()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+unsigned long long ResultCache::getEvictions()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return evictions;
+}
+
+unsigned long long ResultCache::hashScene(const SceneDescription& description, MeshCache& meshCache)
+{
+    ContentHash hash;
+
+    hash.add(SIMULATION_VERSION);
+    hash.add(meshCache.getContentKey(description.waveMesh));
+
+    hash.add(static_cast<unsigned int>(description.obstacles.size()));
+    for (const ObstacleDescription& obstacle : description.obstacles)
+    {
+        hash.add(meshCache.getContentKey(obstacle.mesh));
+        hash.add(obstacle.modelMatrix);
+    }
+
+    // A wave fades from its starting alpha, the rest of its color is only drawn
+    hash.add(static_cast<unsigned int>(description.sources.size()));
+    for (const WaveSourceDescription& source : description.sources)
+    {
+        hash.add(source.position);
+        hash.add(source.speed);
+        hash.add(source.color.w);
+        hash.add(source.launchTime);
+    }
+
+    return hash.get();
+}
+
+std::string ResultCache::getEntryPath(unsigned long long key)
+{
+    std::ostringstream path;
+    path << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".result";
+    return path.str();
+}
+
+void ResultCache::drop(unsigned long long key)
+{
+    auto found = entries.find(key);
+    if (found == entries.end())
+        return;
+
+    totalSize -= found->second.size;
+    entries.erase(found);
+    std::remove(getEntryPath(key).c_str());
+}
+
+void ResultCache::evict(unsigned long long keep)
+{
+    while (totalSize > budget)
+    {
+        auto oldest = entries.end();
+
+        for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+            if (entry->first != keep && (oldest == entries.end() || entry->second.lastUse < oldest->second.lastUse))
+                oldest = entry;
+
+        if (oldest == entries.end())
+            break;
+
+        drop(oldest->first);
+        ++evictions;
+    }
+}
+
+/**
+ * \brief Index file: a header line, then key, size and last use of every entry.
+ * Stores append lines, a later line of a key replaces the earlier ones
+ */
+void ResultCache::loadIndex()
+{
+    std::ifstream file(directory + "/index");
+    std::string magic;
+    unsigned int version = 0;
+
+    if (!(file >> magic >> version) || magic != "CWRC" || version != RESULT_CACHE_VERSION)
+        return;
+
+    unsigned long long key;
+    Entry entry;
+
+    while (file >> std::hex >> key >> std::dec >> entry.size >> entry.lastUse)
+    {
+        // A replaced entry left its old line behind, closing compacts the index
+        auto found = entries.find(key);
+        if (found != entries.end())
+        {
+            totalSize -= found->second.size;
+            indexChanged = true;
+        }
+
+        entries[key] = entry;
+        totalSize += entry.size;
+        useClock = std::max(useClock, entry.lastUse);
+    }
+    indexSaved = true;
+
+    // A smaller budget than last time applies right away
+    evict(0);
+    if (evictions)
+        saveIndex();
+}
+
+void ResultCache::saveIndex()
+{
+    std::string path = directory + "/index";
+    std::string temporary = path + ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+
+        file << "CWRC " << RESULT_CACHE_VERSION << "\n";
+        for (auto& entry : entries)
+            file << std::hex << entry.first << std::dec << " " << entry.second.size << " " << entry.second.lastUse << "\n";
+    }
+
+    std::remove(path.c_str());
+    std::rename(temporary.c_str(), path.c_str());
+    indexChanged = false;
+    indexSaved = true;
+}
+
+void ResultCache::appendIndex(unsigned long long key, const Entry& entry)
+{
+    std::ofstream file(directory + "/index", std::ios::app);
+
+    file << std::hex << key << std::dec << " " << entry.size << " " << entry.lastUse << "\n";
+
+    // A line that did not make it is written with the whole index on close
+    if (!file)
+        indexChanged = true;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "meshcache.hpp"
+#include "scenefile.hpp"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief FNV-1a over the bytes of the values added
+ */
+class ContentHash
+{
+public:
+    void add(const void* data, size_t size);
+
+    template <typename T>
+    void add(const T& value)
+    {
+        add(&value, sizeof(T));
+    }
+
+    unsigned long long get();
+
+private:
+    unsigned long long hash = 14695981039346656037ULL;
+};
+
+/**
+ * \brief Finished simulation results on disk, keyed by what the simulation depends on.
+ *
+ * Every entry is one file named by its key in the cache directory. An
+ * index file next to them keeps the size and the last use of every entry,
+ * storing past the size budget evicts the least recently used entries.
+ * A store appends one line to the index, evicting and closing rewrite it.
+ * An entry that cannot be read is dropped and counts as a miss. Lookups
+ * and stores may run on several threads at once; processes sharing a
+ * directory keep working but may forget each other's uses.
+ */
+class ResultCache
+{
+public:
+    ResultCache(const std::string& directory, unsigned long long budget);
+    ~ResultCache();
+
+    bool load(unsigned long long key, std::vector<unsigned char>& data);
+    void store(unsigned long long key, const std::vector<unsigned char>& data);
+
+    unsigned long long getHits();
+    unsigned long long getMisses();
+    unsigned long long getEvictions();
+
+    /**
+     * \brief Hashes what propagation depends on: mesh contents, transforms,
+     * source positions, speeds, launch times and the starting alpha that
+     * decides when a wave fades. Colors, lighting, culling and file names
+     * leave the key unchanged
+     */
+    static unsigned long long hashScene(const SceneDescription& description, MeshCache& meshCache);
+
+private:
+    struct Entry
+    {
+        unsigned long long size;
+        unsigned long long lastUse;
+    };
+
+    std::string directory;
+    unsigned long long budget;
+
+    std::mutex mutex;
+    std::map<unsigned long long, Entry> entries;
+    unsigned long long totalSize = 0;
+    unsigned long long useClock = 0;
+    bool indexChanged = false;
+    // The index file exists with the current header, stores may append to it
+    bool indexSaved = false;
+
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    unsigned long long evictions = 0;
+
+    std::string getEntryPath(unsigned long long key);
+    void drop(unsigned long long key);
+    void evict(unsigned long long keep);
+    void loadIndex();
+    void saveIndex();
+    void appendIndex(unsigned long long key, const Entry& entry);
+};
\ No newline at end of file
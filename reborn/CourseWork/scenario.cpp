@@ -0,0 +1,311 @@
+#include "scenario.hpp"
+#include "camera.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <glm/gtc/matrix_transform.hpp>
+
+
+const char* SCENARIO_CUBE = "models/cube.obj";
+const char* SCENARIO_SPHERE = "models/sphere_very_big.obj";
+const char* SCENARIO_ROOM = "models/room.obj";
+
+/**
+ * \brief Placement range of obstacles and sources, the range of the GUI sliders
+ */
+const float LAYOUT_EXTENT = 8.0f;
+
+ScenarioRunner::ScenarioRunner(Loader& loader, Shader& shader, const ScenarioSettings& settings)
+    : loader(loader), shader(shader), settings(settings)
+{
+    glm::mat4 identity = glm::mat4(1.0f);
+    glm::vec4 cubeColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+    glm::vec4 waveColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.1f);
+    float waveSpeed = settings.waveSpeed;
+
+    // Templates stay in model space, every scene object is copied from them
+    cube = new Obstacle(identity, cubeColor, GL_BACK);
+    loader.loadModel(SCENARIO_CUBE, *cube);
+
+    sphere = new Sphere(identity, waveColor, waveSpeed, false);
+    loader.loadModel(SCENARIO_SPHERE, *sphere);
+
+    glm::mat4 mRoom = glm::scale(glm::mat4(1.0f), glm::vec3(20, 20, 20));
+    glm::vec4 roomColor(0.1f, 0.1f, 0.1f, 0.3f);
+    room = new Obstacle(mRoom, roomColor, GL_FRONT, false);
+    loader.loadModel(SCENARIO_ROOM, *room);
+}
+
+ScenarioRunner::~ScenarioRunner()
+{
+    cube->releaseMeshes();
+    sphere->releaseMeshes();
+    room->releaseMeshes();
+
+    delete cube;
+    delete sphere;
+    delete room;
+}
+
+void ScenarioRunner::run()
+{
+    unsigned int layout;
+
+    results.clear();
+
+    if (cube->getVertices().empty() || sphere->getVertices().empty())
+    {
+        std::cout << "Scenario models are missing" << std::endl;
+        return;
+    }
+
+    for (unsigned int sources : settings.sourceCounts)
+        for (unsigned int obstacles : settings.obstacleCounts)
+        {
+            ScenarioResult result;
+            double sum = 0.0, squares = 0.0;
+
+            result.obstacles = obstacles;
+            result.sources = sources;
+
+            samples.clear();
+            for (layout = 0; layout < settings.layouts; ++layout)
+                samples.push_back(runLayout(obstacles, sources, layout));
+
+            for (double sample : samples)
+                sum += sample;
+            result.meanMicroseconds = sum / samples.size();
+
+            for (double sample : samples)
+                squares += (sample - result.meanMicroseconds) * (sample - result.meanMicroseconds);
+
+            if (samples.size() > 1)
+                result.confidenceMicroseconds = studentQuantile(samples.size() - 1) *
+                    std::sqrt(squares / (samples.size() - 1) / samples.size());
+
+            std::cout << std::setw(8) << obstacles << " obstacles " << std::setw(6) << sources << " sources "
+                << std::fixed << std::setprecision(3) << std::setw(14) << result.meanMicroseconds
+                << " +- " << result.confidenceMicroseconds << " us" << std::endl;
+
+            results.push_back(result);
+        }
+}
+
+bool ScenarioRunner::writeCsv(const std::string& path)
+{
+    std::ofstream file(path);
+
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open scenario output: " << path << std::endl;
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(3);
+
+    for (const ScenarioResult& result : results)
+        file << result.obstacles << "," << result.meanMicroseconds << ","
+            << result.confidenceMicroseconds << "," << result.sources << "\n";
+
+    std::cout << results.size() << " configurations written to " << path << std::endl;
+
+    return true;
+}
+
+/**
+ * \brief Flags configurations slower than the baseline by more than the tolerance
+ * and by more than both confidence intervals, a baseline in the two column
+ * report format is taken as measured with one source
+ */
+bool ScenarioRunner::compare(const std::string& baselinePath)
+{
+    std::ifstream file(baselinePath);
+    std::map<std::pair<unsigned int, unsigned int>, ScenarioResult> baseline;
+    std::string line;
+    unsigned int regressions = 0;
+
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open scenario baseline: " << baselinePath << std::endl;
+        return false;
+    }
+
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::string field;
+        std::vector<double> values;
+
+        while (std::getline(fields, field, ','))
+            values.push_back(atof(field.c_str()));
+
+        if (values.size() < 2)
+            continue;
+
+        ScenarioResult result;
+        result.obstacles = static_cast<unsigned int>(values[0]);
+        result.meanMicroseconds = values[1];
+        result.confidenceMicroseconds = values.size() > 2 ? values[2] : 0.0;
+        result.sources = values.size() > 3 ? static_cast<unsigned int>(values[3]) : 1;
+
+        baseline[std::make_pair(result.obstacles, result.sources)] = result;
+    }
+
+    for (const ScenarioResult& result : results)
+    {
+        auto found = baseline.find(std::make_pair(result.obstacles, result.sources));
+        if (found == baseline.end())
+            continue;
+
+        const ScenarioResult& base = found->second;
+        double slowdown = result.meanMicroseconds - base.meanMicroseconds;
+
+        if (slowdown > base.meanMicroseconds * settings.tolerance &&
+            slowdown > result.confidenceMicroseconds + base.confidenceMicroseconds)
+        {
+            std::cout << "Regression: " << result.obstacles << " obstacles, " << result.sources << " sources: "
+                << std::fixed << std::setprecision(3) << base.meanMicroseconds << " -> "
+                << result.meanMicroseconds << " us" << std::endl;
+            ++regressions;
+        }
+    }
+
+    if (regressions == 0)
+        std::cout << "No regressions against " << baselinePath << std::endl;
+
+    return regressions == 0;
+}
+
+double ScenarioRunner::runLayout(unsigned int obstacles, unsigned int sources, unsigned int layout)
+{
+    // Layout depends only on the seed and the configuration, never on earlier runs
+    std::seed_seq seed = { settings.seed, obstacles, sources, layout };
+    std::mt19937 random(seed);
+
+    Camera camera;
+    glm::mat4 proj = glm::perspective(glm::radians(camera.Zoom),
+        (float)settings.width / (float)settings.height, 0.1f, 100.0f);
+    glm::mat4 view = camera.GetViewMatrix();
+    float glTime = settings.tickTime;
+    double total = 0.0;
+    unsigned int frame;
+
+    Scene scene;
+    buildLayout(scene, obstacles, sources, random);
+
+    shader.use();
+    shader.setVec3("viewPos", camera.Position);
+    shader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
+    shader.setVec3("lightPos", glm::vec3(0.0f, 30.0f, 0.0f));
+    shader.setMat4("proj", proj);
+    shader.setMat4("view", view);
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_CULL_FACE);
+
+    for (frame = 0; frame < settings.warmupFrames + settings.measuredFrames; ++frame)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        scene.simulate(glTime);
+        scene.swap();
+
+        glClearColor(0.4f, 0.4f, 0.4f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        scene.upload();
+        room->Draw(shader, glTime, scene);
+        scene.render(shader, glTime);
+        glFinish();
+
+        if (frame >= settings.warmupFrames)
+            total += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    scene.releaseMeshes();
+
+    return settings.measuredFrames ? total / settings.measuredFrames : 0.0;
+}
+
+void ScenarioRunner::buildLayout(Scene& scene, unsigned int obstacles, unsigned int sources, std::mt19937& random)
+{
+    glm::vec4 cubeColor = cube->getColor();
+    glm::vec4 waveColor = sphere->getColor();
+    float waveSpeed = settings.waveSpeed;
+    unsigned int i, queued = 0;
+
+    for (i = 0; i < obstacles + sources; ++i)
+    {
+        glm::vec3 position;
+        position.x = uniform(random, -LAYOUT_EXTENT, LAYOUT_EXTENT);
+        position.y = uniform(random, -LAYOUT_EXTENT, LAYOUT_EXTENT);
+        position.z = uniform(random, -LAYOUT_EXTENT, LAYOUT_EXTENT);
+
+        glm::mat4 modelMatrix = glm::mat4(1.0f);
+
+        if (i < obstacles)
+        {
+            // Same transform order as RenderObstacleMenu, identical cubes with random orientation
+            modelMatrix = glm::rotate(modelMatrix, uniform(random, 0.0f, glm::radians(360.0f)), glm::vec3(1, 0, 0));
+            modelMatrix = glm::rotate(modelMatrix, uniform(random, 0.0f, glm::radians(360.0f)), glm::vec3(0, 1, 0));
+            modelMatrix = glm::rotate(modelMatrix, uniform(random, 0.0f, glm::radians(360.0f)), glm::vec3(0, 0, 1));
+            modelMatrix = glm::translate(modelMatrix, position);
+
+            Obstacle* obstacle = new Obstacle(modelMatrix, cubeColor, GL_BACK);
+            loader.copyModel(*cube, *obstacle);
+            scene.addObject(obstacle);
+        }
+        else
+        {
+            modelMatrix = glm::translate(modelMatrix, position);
+
+            // A source is launched like RenderWaveSourceMenu does, its own meshes go right away
+            Sphere source(modelMatrix, waveColor, waveSpeed, false);
+            loader.copyModel(*sphere, source);
+            scene.addSphere(new Sphere(static_cast<Model&>(source)));
+
+            source.releaseMeshes();
+        }
+
+        // Nothing drains the command queue between ticks here
+        if (++queued == CommandQueue::CAPACITY / 2)
+        {
+            scene.flush();
+            queued = 0;
+        }
+    }
+}
+
+/**
+ * \brief Uniform float from the raw generator output, the standard
+ * distributions differ between libraries and would change the layouts
+ */
+float ScenarioRunner::uniform(std::mt19937& random, float min, float max)
+{
+    return min + (max - min) * static_cast<float>(random() / 4294967296.0);
+}
+
+/**
+ * \brief Two-sided 95% quantile of the Student distribution
+ */
+double ScenarioRunner::studentQuantile(unsigned int degrees)
+{
+    static const double quantiles[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+
+    if (degrees == 0)
+        return 0.0;
+    if (degrees <= 30)
+        return quantiles[degrees - 1];
+
+    return 1.960;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "loader.hpp"
+#include "obstacle.hpp"
+#include "sphere.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief Sweep of the scenario runner, the defaults repeat the research chapter experiment
+ */
+struct ScenarioSettings
+{
+    unsigned int seed = 1;
+    unsigned int layouts = 20;
+    std::vector<unsigned int> obstacleCounts = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    std::vector<unsigned int> sourceCounts = { 1 };
+
+    unsigned int warmupFrames = 20;
+    unsigned int measuredFrames = 100;
+
+    // Framebuffer of the hidden window, as the application window
+    unsigned int width = 1920;
+    unsigned int height = 1080;
+
+    float waveSpeed = 25.0f;
+    // glTime the simulation gets every tick, fixed so a layout replays identically
+    float tickTime = 1.0f;
+
+    std::string csvPath = "measures.csv";
+    std::string baselinePath;
+    float tolerance = 0.1f;
+};
+
+/**
+ * \brief Frame time of one obstacle and source count over every layout
+ */
+struct ScenarioResult
+{
+    unsigned int obstacles = 0;
+    unsigned int sources = 0;
+
+    double meanMicroseconds = 0.0;
+    // Half width of the 95% confidence interval of the mean
+    double confidenceMicroseconds = 0.0;
+};
+
+/**
+ * \brief Measures frame time over random scenes.
+ *
+ * Every configuration is run on `layouts` scenes with identical cubes and
+ * wave sources placed from the seed, so the same seed always builds the
+ * same scenes. A frame is one tick, swap, upload and draw run one after
+ * another and finished with glFinish, the mean of each layout is one
+ * sample of the confidence interval.
+ *
+ * Results are written in the measures.csv format of the report (obstacle
+ * count, frame time in microseconds) followed by the interval and the
+ * source count, measure.py reads the first two columns.
+ */
+class ScenarioRunner
+{
+public:
+    ScenarioRunner(Loader& loader, Shader& shader, const ScenarioSettings& settings);
+    ~ScenarioRunner();
+
+    void run();
+    bool writeCsv(const std::string& path);
+    bool compare(const std::string& baselinePath);
+
+private:
+    Loader& loader;
+    Shader& shader;
+    ScenarioSettings settings;
+
+    Obstacle* cube;
+    Sphere* sphere;
+    Obstacle* room;
+
+    std::vector<ScenarioResult> results;
+    std::vector<double> samples;
+
+    double runLayout(unsigned int obstacles, unsigned int sources, unsigned int layout);
+    void buildLayout(Scene& scene, unsigned int obstacles, unsigned int sources, std::mt19937& random);
+
+    static float uniform(std::mt19937& random, float min, float max);
+    static double studentQuantile(unsigned int degrees);
+};
\ No newline at end of file
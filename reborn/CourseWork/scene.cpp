@@ -1,32 +1,97 @@
 #include "scene.hpp"
 #include "model.hpp"
 #include "sphere.hpp"
+#include "trace.hpp"
 
-#include <windows.h>
+#include <algorithm>
+#include <cfloat>
+#include <thread>
 
 
 const float EPS = 9.5*1e-2;
 
+/**
+ * \brief Fewer ticks than this are simulated one by one rather than leapt over
+ */
+const unsigned int MIN_LEAP = 2;
+
+/**
+ * \brief Share of the event-free travel a leap may use, keeps rounding away from the events
+ */
+const float LEAP_MARGIN = 0.99f;
+
+const char* const WAVE_POLICY_NAMES[WaveBudget::POLICY_COUNT] = { "oldest", "faintest", "contribution", "refuse" };
+
+/**
+ * \brief Threads left for the render and simulation threads
+ */
+unsigned int poolWorkers()
+{
+    unsigned int threads = std::thread::hardware_concurrency();
+    return threads > 2 ? threads - 2 : 0;
+}
+
+Scene::Scene() : pool(poolWorkers())
+{
+}
+
+/**
+ * \brief Scene with its own number of pool workers, for runs simulated side by side
+ */
+Scene::Scene(unsigned int workerCount) : pool(workerCount)
+{
+}
+
+/**
+ * \brief Deletes every model the scene owns, Model is complete here so the derived destructors run
+ */
+Scene::~Scene()
+{
+    SceneCommand command;
+    while (commands.pop(command))
+        if (command.type == SceneCommand::ADD_OBJECT || command.type == SceneCommand::ADD_SPHERE)
+            delete command.model;
+
+    for (Model* object : objects)
+        delete object;
+    for (Model* sphere : spheres)
+        delete sphere;
+    for (Model* model : retired)
+        delete model;
+    for (Model* model : removedSpheres)
+        delete model;
+}
+
 void Scene::addObject(Model& obj)
 {
-    objects.push_back(&obj);
+    addObject(&obj);
 }
 
 void Scene::addObject(Model* obj)
 {
-    objects.push_back(obj);
+    pushCommand({ SceneCommand::ADD_OBJECT, obj, -1, obj->getColor() });
 }
 
 void Scene::removeObject(int index)
 {
-    if (index >= 0 && index < objects.size())
-        objects.erase(objects.begin() + index);
+    pushCommand({ SceneCommand::REMOVE_OBJECT, nullptr, index, glm::vec4(0.0f) });
 }
 
 void Scene::removeSphere(int index)
 {
     if (index >= 0 && index < spheres.size())
+    {
+        dropSphere(spheres[index]);
         spheres.erase(spheres.begin() + index);
+    }
+}
+
+void Scene::dropSphere(Model* sphere)
+{
+    if (keepRemovedSpheres)
+        removedSpheres.push_back(sphere);
+    else
+        retired.push_back(sphere);
 }
 
 std::vector<Model*>& Scene::getObjects()
@@ -36,32 +101,530 @@ std::vector<Model*>& Scene::getObjects()
 
 void Scene::updateObjectColor(glm::vec4& newColor, int& modelIndex)
 {
-    objects[modelIndex]->setColor(newColor);
+    pushCommand({ SceneCommand::UPDATE_OBJECT_COLOR, nullptr, modelIndex, newColor });
 }
 
 glm::vec4 Scene::getObjectColor(int& modelIndex)
 {
-    return objects[modelIndex]->getColor();
+    if (modelIndex < 0 || modelIndex >= published.objectColors.size())
+        return glm::vec4(0.0f);
+
+    return published.objectColors[modelIndex];
 }
 
 void Scene::addSphere(Model& sphere)
 {
-    spheres.push_back(&sphere);
+    addSphere(&sphere);
 }
 
 void Scene::addSphere(Model* sphere)
 {
-    spheres.push_back(sphere);
+    pushCommand({ SceneCommand::ADD_SPHERE, sphere, -1, glm::vec4(0.0f) });
 }
 
-void Scene::render(Shader& shaders, float& glTime)
+const SceneSnapshot& Scene::getSnapshot()
+{
+    return published;
+}
+
+void Scene::setDeterministic(bool deterministic)
+{
+    this->deterministic = deterministic;
+}
+
+bool Scene::isDeterministic()
+{
+    return deterministic;
+}
+
+const char* WaveBudget::getPolicyName(Policy policy)
+{
+    return policy < POLICY_COUNT ? WAVE_POLICY_NAMES[policy] : "";
+}
+
+bool WaveBudget::parsePolicy(const std::string& name, Policy& policy)
+{
+    unsigned int i;
+
+    for (i = 0; i < POLICY_COUNT; ++i)
+        if (name == WAVE_POLICY_NAMES[i])
+        {
+            policy = static_cast<Policy>(i);
+            return true;
+        }
+
+    return false;
+}
+
+/**
+ * \brief Takes effect at the next tick, a lower limit evicts right then
+ */
+void Scene::setWaveBudget(const WaveBudget& budget)
+{
+    waveBudget = budget;
+    budgetChanged = true;
+}
+
+const WaveBudget& Scene::getWaveBudget()
+{
+    return waveBudget;
+}
+
+/**
+ * \brief Applies queued edits right away, only while the simulation is idle.
+ * Adding more models than the command queue holds needs it between additions
+ */
+void Scene::flush()
+{
+    applyCommands();
+}
+
+void Scene::simulate(float glTime)
 {
-    for (auto& obj : objects)
-        obj->Draw(shaders, glTime, *this);
+    TRACE_SCOPE("Scene::simulate");
+
+    unsigned int i, begin;
+
+    applyCommands();
+
+    // Split every wave into fixed-size vertex chunks
+    chunkSpheres.clear();
+    chunkBegins.clear();
+    sphereChunks.clear();
+
+    for (i = 0; i < spheres.size(); ++i)
+    {
+        Sphere* sphere = static_cast<Sphere*>(spheres[i]);
+
+        sphere->beginUpdate();
+        sphereChunks.push_back(chunkSpheres.size());
+
+        for (begin = 0; begin < sphere->getVertexCount(); begin += CHUNK_SIZE)
+        {
+            chunkSpheres.push_back(i);
+            chunkBegins.push_back(begin);
+        }
+    }
+    sphereChunks.push_back(chunkSpheres.size());
 
-    for (unsigned int i = 0; i < spheres.size(); ++i)
+    if (chunkEvents.size() < chunkSpheres.size())
+        chunkEvents.resize(chunkSpheres.size());
+
+    pool.parallelFor(chunkSpheres.size(), deterministic, [this, glTime](unsigned int chunk)
+    {
+        Sphere* sphere = static_cast<Sphere*>(spheres[chunkSpheres[chunk]]);
+        unsigned int end = chunkBegins[chunk] + CHUNK_SIZE;
+
+        if (end > sphere->getVertexCount())
+            end = sphere->getVertexCount();
+
+        sphere->updateVertices(*this, glTime, chunkBegins[chunk], end, chunkEvents[chunk]);
+    });
+
+    // Events merge in chunk order, the face pass of a wave stays on one thread
+    pool.parallelFor(spheres.size(), deterministic, [this, glTime](unsigned int index)
+    {
+        unsigned int first = sphereChunks[index];
+
+        static_cast<Sphere*>(spheres[index])->finishUpdate(glTime, chunkEvents.data() + first, sphereChunks[index + 1] - first);
+    });
+
+    ++tick;
+
+    SimulationCounters tickCounters;
+    collectMetrics(tickCounters);
+
+    publish(tickCounters);
+}
+
+/**
+ * \brief Sums the metric slots of the threads that ran this tick.
+ * Worker i runs index i of a static job, the calling thread is the last
+ * one and may change between ticks
+ */
+void Scene::collectMetrics(SimulationCounters& tickCounters)
+{
+    if (metricSlots.empty())
+    {
+        metricSlots.resize(pool.getThreadCount());
+        pool.parallelFor(metricSlots.size(), true, [this](unsigned int thread)
+        {
+            metricSlots[thread] = &Metrics::get().localSlot();
+        });
+    }
+    metricSlots.back() = &Metrics::get().localSlot();
+
+    Metrics::get().collectTick(metricSlots, tickCounters, objectHits);
+}
+
+/**
+ * \brief Fills the next snapshot with the state at the end of a tick and retires faded spheres
+ */
+void Scene::publish(SimulationCounters& tickCounters)
+{
+    unsigned int i;
+
+    next.tick = tick;
+    next.stateHash = 14695981039346656037ULL;
+
+    if (deterministic)
+        for (auto& sphere : spheres)
+            next.stateHash = static_cast<Sphere*>(sphere)->getStateHash(next.stateHash);
+
+    for (i = 0; i < spheres.size(); ++i)
         if (spheres[i]->getColor().w < EPS)
+        {
             removeSphere(i--);
+            ++tickCounters.spheresRetired;
+        }
+
+    totalCounters.add(tickCounters);
+
+    next.objects = objects;
+    next.objectColors = objectColors;
+    next.spheres = spheres;
+
+    next.tickCounters = tickCounters;
+    next.totalCounters = totalCounters;
+    next.objectHits = objectHits;
+    next.sphereLive.resize(spheres.size());
+    next.sphereDead.resize(spheres.size());
+
+    waveUsage.waves = spheres.size();
+    waveUsage.liveVertices = 0;
+    waveUsage.bytes = 0;
+
+    for (i = 0; i < spheres.size(); ++i)
+    {
+        next.sphereLive[i] = static_cast<Sphere*>(spheres[i])->getLiveVertexCount();
+        next.sphereDead[i] = static_cast<Sphere*>(spheres[i])->getDeadVertexCount();
+
+        waveUsage.liveVertices += next.sphereLive[i];
+        waveUsage.bytes += static_cast<Sphere*>(spheres[i])->getMemoryUsage();
+    }
+
+    next.waveBudget = waveBudget;
+    next.waveUsage = waveUsage;
+}
+
+size_t SceneCheckpoint::getSize() const
+{
+    size_t size = sizeof(SceneCheckpoint) +
+        objectColors.size() * sizeof(glm::vec4) +
+        objectHits.size() * sizeof(unsigned long long) +
+        spheres.size() * sizeof(Model*);
+
+    for (const WaveCheckpoint& wave : waves)
+        size += wave.getSize();
+
+    return size;
+}
+
+void Scene::saveCheckpoint(SceneCheckpoint& checkpoint)
+{
+    unsigned int i;
+
+    checkpoint.tick = tick;
+    checkpoint.objectColors = objectColors;
+    checkpoint.objectHits = objectHits;
+    checkpoint.totalCounters = totalCounters;
+    checkpoint.spheres = spheres;
+
+    checkpoint.waves.resize(spheres.size());
+    for (i = 0; i < spheres.size(); ++i)
+        static_cast<Sphere*>(spheres[i])->saveState(checkpoint.waves[i]);
+}
+
+/**
+ * \brief Returns to a checkpoint taken with the current obstacles, live spheres
+ * missing from it are moved to dropped. The state is published at the next swap()
+ */
+void Scene::restoreCheckpoint(const SceneCheckpoint& checkpoint, std::vector<Model*>& dropped)
+{
+    unsigned int i;
+
+    for (Model* sphere : spheres)
+        if (std::find(checkpoint.spheres.begin(), checkpoint.spheres.end(), sphere) == checkpoint.spheres.end())
+            dropped.push_back(sphere);
+
+    spheres = checkpoint.spheres;
+    for (i = 0; i < spheres.size(); ++i)
+        static_cast<Sphere*>(spheres[i])->restoreState(checkpoint.waves[i]);
+
+    tick = checkpoint.tick;
+    objectColors = checkpoint.objectColors;
+    objectHits = checkpoint.objectHits;
+    totalCounters = checkpoint.totalCounters;
+
+    SimulationCounters tickCounters;
+    publish(tickCounters);
+}
+
+/**
+ * \brief Runs up to count ticks with the given tick times and returns how many ran.
+ * While no vertex meets an event all waves move on straight lines, so those
+ * ticks are leapt over in one step. Otherwise a single tick is simulated,
+ * a wave fading out is one of the events so it retires at its own tick
+ */
+unsigned int Scene::fastForward(const float* tickTimes, unsigned int count)
+{
+    TRACE_SCOPE("Scene::fastForward");
+
+    float limit = FLT_MAX, travel = 0.0f;
+    unsigned int leap = 0, leapable = count;
+
+    applyCommands();
+
+    for (Model* sphere : spheres)
+    {
+        limit = std::min(limit, static_cast<Sphere*>(sphere)->getEventFreeTravel(*this, linePositions, lineVelocities));
+        leapable = static_cast<Sphere*>(sphere)->getFadeTicks(EPS, leapable);
+    }
+    limit *= LEAP_MARGIN;
+
+    while (leap < leapable && travel + tickTimes[leap] < limit)
+        travel += tickTimes[leap++];
+
+    if (leap < MIN_LEAP)
+    {
+        simulate(tickTimes[0]);
+        return 1;
+    }
+
+    // Every live vertex stays in the room and outside the obstacles, so each leapt tick
+    // would have tested it against every obstacle without a hit
+    SimulationCounters tickCounters;
+    for (Model* sphere : spheres)
+    {
+        tickCounters.vertexObstacleTests += (unsigned long long)leap * objects.size() *
+            static_cast<Sphere*>(sphere)->getLiveVertexCount();
+        static_cast<Sphere*>(sphere)->advance(tickTimes, leap);
+    }
+
+    tick += leap;
+
+    publish(tickCounters);
+
+    return leap;
+}
+
+unsigned int Scene::getObjectsVersion()
+{
+    return objectsVersion;
+}
+
+void Scene::setKeepRemovedSpheres(bool keep)
+{
+    keepRemovedSpheres = keep;
+}
+
+void Scene::takeRemovedSpheres(std::vector<Model*>& removed)
+{
+    removed.insert(removed.end(), removedSpheres.begin(), removedSpheres.end());
+    removedSpheres.clear();
+}
+
+/**
+ * \brief Deletes the GL objects of every model the scene holds, the simulation must be idle
+ */
+void Scene::releaseMeshes()
+{
+    for (Model* object : objects)
+        object->releaseMeshes();
+    for (Model* sphere : spheres)
+        sphere->releaseMeshes();
+    for (Model* model : retired)
+        model->releaseMeshes();
+    for (Model* model : removedSpheres)
+        model->releaseMeshes();
+}
+
+void Scene::swap()
+{
+    // Nothing draws the previous snapshot any more, swap runs on the render thread
+    for (Model* model : retired)
+    {
+        model->releaseMeshes();
+        delete model;
+    }
+    retired.clear();
+
+    published.objects.swap(next.objects);
+    published.objectColors.swap(next.objectColors);
+    published.spheres.swap(next.spheres);
+    published.tick = next.tick;
+    published.stateHash = next.stateHash;
+    published.tickCounters = next.tickCounters;
+    published.totalCounters = next.totalCounters;
+    published.objectHits.swap(next.objectHits);
+    published.sphereLive.swap(next.sphereLive);
+    published.sphereDead.swap(next.sphereDead);
+    published.waveBudget = next.waveBudget;
+    published.waveUsage = next.waveUsage;
+
+    for (auto& sphere : published.spheres)
+        static_cast<Sphere*>(sphere)->swapBuffers();
+}
+
+void Scene::upload()
+{
+    for (auto& sphere : published.spheres)
+        static_cast<Sphere*>(sphere)->upload();
+}
+
+void Scene::render(Shader& shaders, float& glTime)
+{
+    TRACE_SCOPE("Scene::render");
+
+    unsigned int i;
+
+    for (i = 0; i < published.objects.size(); ++i)
+    {
+        published.objects[i]->setColor(published.objectColors[i]);
+        published.objects[i]->Draw(shaders, glTime, *this);
+    }
+
+    for (auto& sphere : published.spheres)
+        sphere->Draw(shaders, glTime, *this);
+}
+
+void Scene::pushCommand(const SceneCommand& command)
+{
+    // Never waits, edits made between ticks may outnumber the ring
+    commands.push(command);
+}
+
+void Scene::applyCommands()
+{
+    SceneCommand command;
+
+    while (commands.pop(command))
+        switch (command.type)
+        {
+        case SceneCommand::ADD_OBJECT:
+            ++objectsVersion;
+            objects.push_back(command.model);
+            objectColors.push_back(command.color);
+            objectHits.push_back(0);
+            break;
+        case SceneCommand::REMOVE_OBJECT:
+            if (command.index >= 0 && command.index < objects.size())
+            {
+                ++objectsVersion;
+                retired.push_back(objects[command.index]);
+                objects.erase(objects.begin() + command.index);
+                objectColors.erase(objectColors.begin() + command.index);
+                objectHits.erase(objectHits.begin() + command.index);
+            }
+            break;
+        case SceneCommand::UPDATE_OBJECT_COLOR:
+            if (command.index >= 0 && command.index < objectColors.size())
+                objectColors[command.index] = command.color;
+            break;
+        case SceneCommand::ADD_SPHERE:
+            addWave(command.model);
+            break;
+        }
+
+    if (budgetChanged)
+        enforceBudget();
+}
+
+/**
+ * \brief Adds a launched wave, or drops it if the budget refuses waves it has no room for
+ */
+void Scene::addWave(Model* sphere)
+{
+    budgetChanged = true;
+
+    if (waveBudget.policy == WaveBudget::REFUSE)
+    {
+        Sphere* wave = static_cast<Sphere*>(sphere);
+        unsigned long long liveVertices, bytes;
+
+        measureWaves(liveVertices, bytes);
+        if (isOverBudget(liveVertices + wave->getLiveVertexCount(), bytes + wave->getMemoryUsage()))
+        {
+            dropSphere(sphere);
+            ++waveUsage.refused;
+            return;
+        }
+    }
+
+    spheres.push_back(sphere);
+}
+
+/**
+ * \brief Evicts waves by the policy until the live ones fit the budget.
+ * Waves only lose vertices as they travel, so only additions and budget changes can exceed it
+ */
+void Scene::enforceBudget()
+{
+    unsigned long long liveVertices, bytes;
+
+    budgetChanged = false;
+    if (waveBudget.policy == WaveBudget::REFUSE)
+        return;
+
+    measureWaves(liveVertices, bytes);
+
+    while (!spheres.empty() && isOverBudget(liveVertices, bytes))
+    {
+        unsigned int index = chooseEviction();
+        Sphere* wave = static_cast<Sphere*>(spheres[index]);
+
+        liveVertices -= wave->getLiveVertexCount();
+        bytes -= wave->getMemoryUsage();
+
+        removeSphere(index);
+        ++waveUsage.evicted;
+    }
+}
+
+void Scene::measureWaves(unsigned long long& liveVertices, unsigned long long& bytes)
+{
+    liveVertices = 0;
+    bytes = 0;
+
+    for (Model* sphere : spheres)
+    {
+        liveVertices += static_cast<Sphere*>(sphere)->getLiveVertexCount();
+        bytes += static_cast<Sphere*>(sphere)->getMemoryUsage();
+    }
+}
+
+bool Scene::isOverBudget(unsigned long long liveVertices, unsigned long long bytes)
+{
+    return (waveBudget.maxLiveVertices > 0 && liveVertices > waveBudget.maxLiveVertices) ||
+        (waveBudget.maxBytes > 0 && bytes > waveBudget.maxBytes);
+}
+
+/**
+ * \brief Wave the policy gives up first, the earlier one on a tie
+ */
+unsigned int Scene::chooseEviction()
+{
+    unsigned int i, chosen = 0;
+    double lowest = DBL_MAX;
+
+    for (i = 0; i < spheres.size(); ++i)
+    {
+        Sphere* wave = static_cast<Sphere*>(spheres[i]);
+        double score;
+
+        if (waveBudget.policy == WaveBudget::EVICT_FAINTEST)
+            score = wave->getColor().w;
+        else if (waveBudget.policy == WaveBudget::EVICT_LOWEST_CONTRIBUTION)
+            score = static_cast<double>(wave->getLiveVertexCount()) * wave->getColor().w;
         else
-            spheres[i]->Draw(shaders, glTime, *this);
+            score = wave->getWaveId();
+
+        if (score < lowest)
+        {
+            lowest = score;
+            chosen = i;
+        }
+    }
+
+    return chosen;
 }
\ No newline at end of file
@@ -1,25 +1,109 @@
 #pragma once
 
 #include "shader.hpp"
+#include "command.hpp"
+#include "metrics.hpp"
+#include "threadpool.hpp"
+#include "wavefront.hpp"
 
 
 class Model;
 
 class Sphere;
 
+/**
+ * \brief Limits on the live waves, a limit of 0 is off.
+ * Past a limit the scene evicts waves by the policy, or refuses new ones
+ */
+struct WaveBudget
+{
+    enum Policy
+    {
+        EVICT_OLDEST,
+        EVICT_FAINTEST,
+        // Fewest live vertices weighted by alpha, the wave adding least to the picture
+        EVICT_LOWEST_CONTRIBUTION,
+        REFUSE,
+        POLICY_COUNT
+    };
+
+    unsigned long long maxLiveVertices = 0;
+    unsigned long long maxBytes = 0;
+    Policy policy = EVICT_OLDEST;
+
+    static const char* getPolicyName(Policy policy);
+    static bool parsePolicy(const std::string& name, Policy& policy);
+};
+
+/**
+ * \brief Live waves measured against the budget, evictions and refusals since start
+ */
+struct WaveUsage
+{
+    unsigned int waves = 0;
+    unsigned long long liveVertices = 0;
+    unsigned long long bytes = 0;
+    unsigned long long evicted = 0;
+    unsigned long long refused = 0;
+};
+
+/**
+ * \brief Immutable view of the scene after a simulation tick, read by the GUI and the renderer
+ */
+struct SceneSnapshot
+{
+    std::vector<Model*> objects;
+    std::vector<glm::vec4> objectColors;
+    std::vector<Model*> spheres;
+
+    unsigned long long tick = 0;
+    unsigned long long stateHash = 0;
+
+    // Counters of the tick and since start, hits and vertex counts are per object and per sphere
+    SimulationCounters tickCounters;
+    SimulationCounters totalCounters;
+    std::vector<unsigned long long> objectHits;
+    std::vector<unsigned int> sphereLive;
+    std::vector<unsigned int> sphereDead;
+
+    WaveBudget waveBudget;
+    WaveUsage waveUsage;
+};
+
+/**
+ * \brief Scene state at the end of a tick, the obstacles are not part of it
+ */
+struct SceneCheckpoint
+{
+    unsigned long long tick = 0;
+
+    std::vector<glm::vec4> objectColors;
+    std::vector<unsigned long long> objectHits;
+    SimulationCounters totalCounters;
+
+    std::vector<Model*> spheres;
+    std::vector<WaveCheckpoint> waves;
+
+    size_t getSize() const;
+};
+
+/**
+ * \brief Scene state owned by the simulation thread.
+ *
+ * Edits are queued as commands and applied at the start of the next tick,
+ * the result of a tick is published at swap() while the simulation is idle.
+ */
 class Scene
 {
 public:
-    ~Scene()
-    {
-        for (Model* object : objects)
-            delete object;
-        for (Model* sphere : spheres)
-            delete sphere;
+    /**
+     * \brief Vertices per parallel work item, fixed so partitioning never depends on thread count
+     */
+    static const unsigned int CHUNK_SIZE = 4096;
 
-        objects.clear();
-        spheres.clear();
-    }
+    Scene();
+    Scene(unsigned int workerCount);
+    ~Scene();
 
     void addObject(Model& obj);
     void addObject(Model* obj);
@@ -33,12 +117,88 @@ public:
     void addSphere(Model& sphere);
     void addSphere(Model* sphere);
 
+    const SceneSnapshot& getSnapshot();
+
+    void setDeterministic(bool deterministic);
+    bool isDeterministic();
+
+    // Memory budget of the live waves, set only while the simulation is idle
+    void setWaveBudget(const WaveBudget& budget);
+    const WaveBudget& getWaveBudget();
+
+    void flush();
+    void simulate(float glTime);
+    void swap();
+
+    // Seeking, only while the simulation is idle
+    void saveCheckpoint(SceneCheckpoint& checkpoint);
+    void restoreCheckpoint(const SceneCheckpoint& checkpoint, std::vector<Model*>& dropped);
+    unsigned int fastForward(const float* tickTimes, unsigned int count);
+    unsigned int getObjectsVersion();
+
+    // Removed spheres are handed out instead of deleted, for a timeline that may bring them back
+    void setKeepRemovedSpheres(bool keep);
+    void takeRemovedSpheres(std::vector<Model*>& removed);
+    void upload();
     void render(Shader& shaders, float& glTime);
+
+    // The destructor leaves GL alone, the owner releases while its context is still current
+    void releaseMeshes();
 private:
     // lighting
     glm::vec3 lightPos;
 
-    // Scene objects
+    // Scene objects, owned by the simulation
     std::vector<Model*> objects;
+    std::vector<glm::vec4> objectColors;
+    std::vector<unsigned long long> objectHits;
     std::vector<Model*> spheres;
+
+    SimulationCounters totalCounters;
+
+    // Models dropped by the simulation that the last snapshot may still draw
+    std::vector<Model*> retired;
+
+    bool keepRemovedSpheres = false;
+    std::vector<Model*> removedSpheres;
+
+    WaveBudget waveBudget;
+    WaveUsage waveUsage;
+    bool budgetChanged = false;
+
+    // Changed by every added or removed obstacle
+    unsigned int objectsVersion = 0;
+
+    CommandQueue commands;
+
+    SceneSnapshot published;
+    SceneSnapshot next;
+
+    // Parallel wave update
+    ThreadPool pool;
+    bool deterministic = false;
+    unsigned long long tick = 0;
+
+    std::vector<unsigned int> chunkSpheres;
+    std::vector<unsigned int> chunkBegins;
+    std::vector<unsigned int> sphereChunks;
+    std::vector<WaveEvents> chunkEvents;
+
+    // Metric slot of every pool thread
+    std::vector<MetricSlot*> metricSlots;
+
+    // Straight-line vertex positions and velocities, scratch of the leap bound of every wave
+    std::vector<glm::vec3> linePositions;
+    std::vector<glm::vec3> lineVelocities;
+
+    void pushCommand(const SceneCommand& command);
+    void applyCommands();
+    void dropSphere(Model* sphere);
+    void addWave(Model* sphere);
+    void enforceBudget();
+    void measureWaves(unsigned long long& liveVertices, unsigned long long& bytes);
+    bool isOverBudget(unsigned long long liveVertices, unsigned long long bytes);
+    unsigned int chooseEviction();
+    void collectMetrics(SimulationCounters& tickCounters);
+    void publish(SimulationCounters& tickCounters);
 };
\ No newline at end of file
@@ -0,0 +1,396 @@
+#include "scenefile.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+
+/**
+ * \brief Binary scene layout: magic, version, room (mesh, matrix, color),
+ * light (position, color), wave mesh, obstacle count and obstacles (mesh,
+ * matrix, color, cull mode), source count and sources (position, speed,
+ * color, launch time). Strings are a length followed by the characters
+ */
+const unsigned int SCENE_MAGIC = 0x42535743; // "CWSB"
+const unsigned int SCENE_VERSION = 1;
+
+static bool readFloats(std::istream& line, float* values, unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; ++i)
+        if (!(line >> values[i]))
+            return false;
+
+    return true;
+}
+
+static bool readMatrix(std::istream& line, glm::mat4& matrix)
+{
+    return readFloats(line, &matrix[0][0], 16);
+}
+
+static void writeFloats(std::ostream& file, const char* property, const float* values, unsigned int count)
+{
+    unsigned int i;
+
+    file << " " << property;
+    for (i = 0; i < count; ++i)
+        file << " " << values[i];
+}
+
+template <typename T>
+static void writeValue(std::ostream& file, const T& value)
+{
+    file.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static void readValue(std::istream& file, T& value)
+{
+    file.read((char*)&value, sizeof(T));
+}
+
+static void writeString(std::ostream& file, const std::string& str)
+{
+    unsigned int length = str.size();
+
+    writeValue(file, length);
+    file.write(str.data(), length);
+}
+
+static bool readString(std::istream& file, std::string& str)
+{
+    unsigned int length = 0;
+
+    readValue(file, length);
+    if (!file || length > 4096)
+        return false;
+
+    str.resize(length);
+    if (length)
+        file.read(&str[0], length);
+
+    return static_cast<bool>(file);
+}
+
+/**
+ * \brief Bytes left to read, bounds the counts read from a file before anything is allocated for them
+ */
+static unsigned long long remainingBytes(std::istream& file)
+{
+    std::streampos position = file.tellg();
+    if (position < 0)
+        return 0;
+
+    file.seekg(0, std::ios::end);
+    std::streampos end = file.tellg();
+    file.seekg(position);
+
+    return end > position ? static_cast<unsigned long long>(end - position) : 0;
+}
+
+bool SceneFile::load(const std::string& path, SceneDescription& description)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open scene file: " << path << std::endl;
+        return false;
+    }
+
+    unsigned int magic = 0;
+    readValue(file, magic);
+
+    file.clear();
+    file.seekg(0);
+
+    description = SceneDescription();
+
+    bool loaded = magic == SCENE_MAGIC ? loadBinary(file, description) : loadText(file, description);
+    if (!loaded)
+        std::cout << "Failed to read scene file: " << path << std::endl;
+
+    return loaded;
+}
+
+bool SceneFile::save(const std::string& path, const SceneDescription& description)
+{
+    const std::string binaryExtension = ".sceneb";
+    bool binary = path.size() >= binaryExtension.size() &&
+        path.compare(path.size() - binaryExtension.size(), binaryExtension.size(), binaryExtension) == 0;
+
+    std::ofstream file(path, binary ? std::ios::binary | std::ios::trunc : std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to write scene file: " << path << std::endl;
+        return false;
+    }
+
+    return binary ? saveBinary(file, description) : saveText(file, description);
+}
+
+bool SceneFile::loadText(std::istream& file, SceneDescription& description)
+{
+    std::string text, keyword, property;
+    unsigned int lineNumber = 0;
+
+    while (std::getline(file, text))
+    {
+        ++lineNumber;
+
+        std::istringstream line(text.substr(0, text.find('#')));
+        if (!(line >> keyword))
+            continue;
+
+        bool valid = true;
+
+        if (keyword == "room")
+        {
+            RoomDescription& room = description.room;
+            glm::vec3 scale;
+
+            while (valid && line >> property)
+                if (property == "mesh")
+                    valid = static_cast<bool>(line >> room.mesh);
+                else if (property == "matrix")
+                    valid = readMatrix(line, room.modelMatrix);
+                else if (property == "scale" && (valid = readFloats(line, &scale.x, 3)))
+                    room.modelMatrix = glm::scale(glm::mat4(1.0f), scale);
+                else if (property == "color")
+                    valid = readFloats(line, &room.color.x, 4);
+                else
+                    valid = false;
+        }
+        else if (keyword == "light")
+        {
+            LightDescription& light = description.light;
+
+            while (valid && line >> property)
+                if (property == "position")
+                    valid = readFloats(line, &light.position.x, 3);
+                else if (property == "color")
+                    valid = readFloats(line, &light.color.x, 3);
+                else
+                    valid = false;
+        }
+        else if (keyword == "wave")
+        {
+            while (valid && line >> property)
+                if (property == "mesh")
+                    valid = static_cast<bool>(line >> description.waveMesh);
+                else
+                    valid = false;
+        }
+        else if (keyword == "obstacle")
+        {
+            ObstacleDescription obstacle;
+            glm::vec3 position(0.0f), rotation(0.0f), scale(1.0f);
+            bool hasMatrix = false;
+            std::string cull;
+
+            while (valid && line >> property)
+                if (property == "mesh")
+                    valid = static_cast<bool>(line >> obstacle.mesh);
+                else if (property == "matrix")
+                    valid = hasMatrix = readMatrix(line, obstacle.modelMatrix);
+                else if (property == "position")
+                    valid = readFloats(line, &position.x, 3);
+                else if (property == "rotation")
+                    valid = readFloats(line, &rotation.x, 3);
+                else if (property == "scale")
+                    valid = readFloats(line, &scale.x, 3);
+                else if (property == "color")
+                    valid = readFloats(line, &obstacle.color.x, 4);
+                else if (property == "cull" && line >> cull && (cull == "back" || cull == "front"))
+                    obstacle.cullMode = cull == "back" ? GL_BACK : GL_FRONT;
+                else
+                    valid = false;
+
+            // Same order as the obstacle menu
+            if (!hasMatrix)
+            {
+                obstacle.modelMatrix = glm::rotate(obstacle.modelMatrix, glm::radians(rotation.x), glm::vec3(1, 0, 0));
+                obstacle.modelMatrix = glm::rotate(obstacle.modelMatrix, glm::radians(rotation.y), glm::vec3(0, 1, 0));
+                obstacle.modelMatrix = glm::rotate(obstacle.modelMatrix, glm::radians(rotation.z), glm::vec3(0, 0, 1));
+                obstacle.modelMatrix = glm::scale(obstacle.modelMatrix, scale);
+                obstacle.modelMatrix = glm::translate(obstacle.modelMatrix, position);
+            }
+
+            description.obstacles.push_back(obstacle);
+        }
+        else if (keyword == "source")
+        {
+            WaveSourceDescription source;
+
+            while (valid && line >> property)
+                if (property == "position")
+                    valid = readFloats(line, &source.position.x, 3);
+                else if (property == "speed")
+                    valid = static_cast<bool>(line >> source.speed);
+                else if (property == "color")
+                    valid = readFloats(line, &source.color.x, 4);
+                else if (property == "launch")
+                    valid = static_cast<bool>(line >> source.launchTime);
+                else
+                    valid = false;
+
+            description.sources.push_back(source);
+        }
+        else
+            valid = false;
+
+        if (!valid)
+        {
+            std::cout << "Scene file line " << lineNumber << " is not valid: " << text << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SceneFile::loadBinary(std::istream& file, SceneDescription& description)
+{
+    unsigned int magic = 0, version = 0, count = 0, i;
+
+    readValue(file, magic);
+    readValue(file, version);
+    if (!file || version != SCENE_VERSION)
+    {
+        std::cout << "Unsupported scene file version: " << version << std::endl;
+        return false;
+    }
+
+    RoomDescription& room = description.room;
+    if (!readString(file, room.mesh))
+        return false;
+    readValue(file, room.modelMatrix);
+    readValue(file, room.color);
+
+    readValue(file, description.light.position);
+    readValue(file, description.light.color);
+
+    if (!readString(file, description.waveMesh))
+        return false;
+
+    // Smallest obstacle: an empty mesh name, matrix, color and cull mode
+    const unsigned long long obstacleSize = sizeof(unsigned int) + sizeof(glm::mat4) + sizeof(glm::vec4) + sizeof(int);
+
+    readValue(file, count);
+    if (!file || count > remainingBytes(file) / obstacleSize)
+        return false;
+
+    description.obstacles.resize(count);
+    for (i = 0; i < count && file; ++i)
+    {
+        ObstacleDescription& obstacle = description.obstacles[i];
+
+        if (!readString(file, obstacle.mesh))
+            return false;
+        readValue(file, obstacle.modelMatrix);
+        readValue(file, obstacle.color);
+        readValue(file, obstacle.cullMode);
+    }
+
+    const unsigned long long sourceSize = sizeof(glm::vec3) + sizeof(float) + sizeof(glm::vec4) + sizeof(float);
+
+    readValue(file, count);
+    if (!file || count > remainingBytes(file) / sourceSize)
+        return false;
+
+    description.sources.resize(count);
+    for (i = 0; i < count && file; ++i)
+    {
+        WaveSourceDescription& source = description.sources[i];
+
+        readValue(file, source.position);
+        readValue(file, source.speed);
+        readValue(file, source.color);
+        readValue(file, source.launchTime);
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool SceneFile::saveText(std::ostream& file, const SceneDescription& description)
+{
+    const RoomDescription& room = description.room;
+    const LightDescription& light = description.light;
+
+    // Enough digits for every float to read back exactly
+    file << std::setprecision(9);
+
+    file << "# Course work scene\n";
+
+    file << "room mesh " << room.mesh;
+    writeFloats(file, "matrix", &room.modelMatrix[0][0], 16);
+    writeFloats(file, "color", &room.color.x, 4);
+    file << "\n";
+
+    file << "light";
+    writeFloats(file, "position", &light.position.x, 3);
+    writeFloats(file, "color", &light.color.x, 3);
+    file << "\n";
+
+    file << "wave mesh " << description.waveMesh << "\n";
+
+    for (const ObstacleDescription& obstacle : description.obstacles)
+    {
+        file << "obstacle mesh " << obstacle.mesh;
+        writeFloats(file, "matrix", &obstacle.modelMatrix[0][0], 16);
+        writeFloats(file, "color", &obstacle.color.x, 4);
+        file << " cull " << (obstacle.cullMode == GL_FRONT ? "front" : "back") << "\n";
+    }
+
+    for (const WaveSourceDescription& source : description.sources)
+    {
+        file << "source";
+        writeFloats(file, "position", &source.position.x, 3);
+        writeFloats(file, "speed", &source.speed, 1);
+        writeFloats(file, "color", &source.color.x, 4);
+        writeFloats(file, "launch", &source.launchTime, 1);
+        file << "\n";
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool SceneFile::saveBinary(std::ostream& file, const SceneDescription& description)
+{
+    unsigned int count;
+
+    writeValue(file, SCENE_MAGIC);
+    writeValue(file, SCENE_VERSION);
+
+    writeString(file, description.room.mesh);
+    writeValue(file, description.room.modelMatrix);
+    writeValue(file, description.room.color);
+
+    writeValue(file, description.light.position);
+    writeValue(file, description.light.color);
+
+    writeString(file, description.waveMesh);
+
+    count = description.obstacles.size();
+    writeValue(file, count);
+    for (const ObstacleDescription& obstacle : description.obstacles)
+    {
+        writeString(file, obstacle.mesh);
+        writeValue(file, obstacle.modelMatrix);
+        writeValue(file, obstacle.color);
+        writeValue(file, obstacle.cullMode);
+    }
+
+    count = description.sources.size();
+    writeValue(file, count);
+    for (const WaveSourceDescription& source : description.sources)
+    {
+        writeValue(file, source.position);
+        writeValue(file, source.speed);
+        writeValue(file, source.color);
+        writeValue(file, source.launchTime);
+    }
+
+    return static_cast<bool>(file);
+}
\ No newline at end of file
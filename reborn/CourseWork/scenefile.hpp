@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+struct RoomDescription
+{
+    std::string mesh = "models/room.obj";
+    glm::mat4 modelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(20, 20, 20));
+    glm::vec4 color = glm::vec4(0.1f, 0.1f, 0.1f, 0.3f);
+};
+
+struct LightDescription
+{
+    glm::vec3 position = glm::vec3(100.0f, 0.0f, -70.0f);
+    glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f);
+};
+
+struct ObstacleDescription
+{
+    std::string mesh = "models/cube.obj";
+    glm::mat4 modelMatrix = glm::mat4(1.0f);
+    glm::vec4 color = glm::vec4(0.2f, 0.3f, 0.4f, 1.0f);
+    int cullMode = GL_BACK;
+};
+
+struct WaveSourceDescription
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    float speed = 1.0f;
+    glm::vec4 color = glm::vec4(1.0f, 1.0f, 1.0f, 0.1f);
+    // Seconds after the scene is loaded, the source emits one wave then
+    float launchTime = 0.0f;
+};
+
+/**
+ * \brief Everything needed to rebuild a scene, the defaults are the ones of the application
+ */
+struct SceneDescription
+{
+    RoomDescription room;
+    LightDescription light;
+    std::string waveMesh = "models/sphere_very_big.obj";
+
+    std::vector<ObstacleDescription> obstacles;
+    std::vector<WaveSourceDescription> sources;
+};
+
+/**
+ * \brief Reads and writes scene descriptions.
+ *
+ * The text form has one entry per line, a keyword followed by optional
+ * properties, '#' starts a comment:
+ *
+ *     room mesh models/room.obj scale 20 20 20 color 0.1 0.1 0.1 0.3
+ *     light position 100 0 -70 color 1 1 1
+ *     wave mesh models/sphere_very_big.obj
+ *     obstacle mesh models/cube.obj position 0 0 0 rotation 0 45 0 scale 1 1 1 color 0.2 0.3 0.4 1 cull back
+ *     obstacle matrix <16 numbers, column by column>
+ *     source position 0 0 0 speed 25 color 1 1 1 0.1 launch 0.5
+ *
+ * Position, rotation (degrees) and scale compose like the obstacle menu,
+ * rotation first, saving writes the matrix. The binary form holds the same
+ * fields in native byte order after a magic and a version, load() tells
+ * the forms apart by the magic and save() writes binary for paths ending
+ * with ".sceneb".
+ */
+class SceneFile
+{
+public:
+    static bool load(const std::string& path, SceneDescription& description);
+    static bool save(const std::string& path, const SceneDescription& description);
+
+private:
+    static bool loadText(std::istream& file, SceneDescription& description);
+    static bool loadBinary(std::istream& file, SceneDescription& description);
+    static bool saveText(std::ostream& file, const SceneDescription& description);
+    static bool saveBinary(std::ostream& file, const SceneDescription& description);
+};
\ No newline at end of file
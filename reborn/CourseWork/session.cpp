@@ -0,0 +1,265 @@
+#include "session.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+
+const unsigned int SESSION_MAGIC = 0x52535743; // "CWSR"
+const unsigned int SESSION_VERSION = 1;
+
+/**
+ * \brief Fields stored for each event type
+ */
+enum SessionField
+{
+    FIELD_INDEX = 1,
+    FIELD_VALUE = 2,
+    FIELD_VECTOR = 4,
+    FIELD_COLOR = 8,
+    FIELD_MATRIX = 16,
+    FIELD_LIMITS = 32
+};
+
+const unsigned int SESSION_FIELDS[SessionEvent::TYPE_COUNT] =
+{
+    FIELD_VALUE,                                // TICK_TIME
+    FIELD_INDEX | FIELD_VALUE,                  // CAMERA_KEY
+    FIELD_VECTOR,                               // CAMERA_MOUSE
+    FIELD_MATRIX | FIELD_COLOR,                 // ADD_OBSTACLE
+    FIELD_INDEX,                                // REMOVE_OBSTACLE
+    FIELD_INDEX | FIELD_COLOR,                  // OBJECT_COLOR
+    FIELD_VECTOR | FIELD_VALUE | FIELD_COLOR,   // ADD_SOURCE
+    FIELD_INDEX,                                // REMOVE_SOURCE
+    0,                                          // EMIT_WAVES
+    FIELD_INDEX,                                // EMIT_SOURCE
+    FIELD_VECTOR | FIELD_COLOR,                 // LIGHT
+    FIELD_INDEX | FIELD_LIMITS                  // WAVE_BUDGET
+};
+
+static void writeVarint(std::ostream& file, unsigned long long value)
+{
+    // 7 bits per byte, the high bit marks that more bytes follow
+    while (value >= 0x80)
+    {
+        file.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    file.put(static_cast<char>(value));
+}
+
+static bool readVarint(const std::vector<char>& data, unsigned int& offset, unsigned long long& value)
+{
+    unsigned int shift = 0;
+
+    value = 0;
+    while (offset < data.size() && shift < 64)
+    {
+        unsigned char byte = static_cast<unsigned char>(data[offset++]);
+
+        value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+        shift += 7;
+    }
+
+    return false;
+}
+
+static bool readFloats(const std::vector<char>& data, unsigned int& offset, float* values, unsigned int count)
+{
+    if (offset + count * sizeof(float) > data.size())
+        return false;
+
+    memcpy(values, &data[offset], count * sizeof(float));
+    offset += count * sizeof(float);
+
+    return true;
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    close();
+}
+
+bool SessionRecorder::open(const std::string& path, const SessionHeader& header)
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open session log: " << path << std::endl;
+        return false;
+    }
+
+    unsigned int magic = SESSION_MAGIC, version = SESSION_VERSION;
+    unsigned char deterministic = header.deterministic;
+
+    file.write((const char*)&magic, sizeof(magic));
+    file.write((const char*)&version, sizeof(version));
+    file.put(deterministic);
+    writeVarint(file, header.scenePath.size());
+    file.write(header.scenePath.data(), header.scenePath.size());
+
+    lastTick = 0;
+    count = 0;
+
+    return true;
+}
+
+bool SessionRecorder::isOpen()
+{
+    return file.is_open();
+}
+
+void SessionRecorder::record(const SessionEvent& event)
+{
+    if (!file.is_open())
+        return;
+
+    unsigned int fields = SESSION_FIELDS[event.type];
+
+    // Ticks only grow, the delta is a byte for nearly every event
+    file.put(static_cast<char>(event.type));
+    writeVarint(file, event.tick - lastTick);
+    lastTick = event.tick;
+
+    if (fields & FIELD_INDEX)
+        writeVarint(file, static_cast<unsigned int>(event.index));
+    if (fields & FIELD_VALUE)
+        file.write((const char*)&event.value, sizeof(float));
+    if (fields & FIELD_VECTOR)
+        file.write((const char*)&event.vector[0], 3 * sizeof(float));
+    if (fields & FIELD_COLOR)
+        file.write((const char*)&event.color[0], 4 * sizeof(float));
+    if (fields & FIELD_MATRIX)
+        file.write((const char*)&event.matrix[0][0], 16 * sizeof(float));
+    if (fields & FIELD_LIMITS)
+    {
+        writeVarint(file, event.limits[0]);
+        writeVarint(file, event.limits[1]);
+    }
+
+    ++count;
+}
+
+void SessionRecorder::close()
+{
+    if (!file.is_open())
+        return;
+
+    file.close();
+    std::cout << count << " session events recorded up to tick " << lastTick << std::endl;
+}
+
+bool SessionPlayer::open(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open session log: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    unsigned int magic = 0, version = 0, offset = 0;
+    unsigned long long length = 0, tick = 0, value;
+
+    if (data.size() < 2 * sizeof(unsigned int) + 1)
+        return false;
+
+    memcpy(&magic, &data[0], sizeof(magic));
+    memcpy(&version, &data[sizeof(magic)], sizeof(version));
+    offset = 2 * sizeof(unsigned int);
+
+    if (magic != SESSION_MAGIC || version != SESSION_VERSION)
+    {
+        std::cout << "Not a session log of this version: " << path << std::endl;
+        return false;
+    }
+
+    header.deterministic = data[offset++] != 0;
+    if (!readVarint(data, offset, length) || offset + length > data.size())
+        return false;
+    header.scenePath.assign(&data[0] + offset, length);
+    offset += length;
+
+    events.clear();
+    while (offset < data.size())
+    {
+        SessionEvent event;
+        unsigned char type = static_cast<unsigned char>(data[offset++]);
+        bool valid = type < SessionEvent::TYPE_COUNT && readVarint(data, offset, value);
+
+        if (valid)
+        {
+            unsigned int fields = SESSION_FIELDS[type];
+
+            tick += value;
+            event.type = static_cast<SessionEvent::Type>(type);
+            event.tick = tick;
+
+            if (valid && (fields & FIELD_INDEX) && (valid = readVarint(data, offset, value)))
+                event.index = static_cast<int>(value);
+            if (valid && (fields & FIELD_VALUE))
+                valid = readFloats(data, offset, &event.value, 1);
+            if (valid && (fields & FIELD_VECTOR))
+                valid = readFloats(data, offset, &event.vector[0], 3);
+            if (valid && (fields & FIELD_COLOR))
+                valid = readFloats(data, offset, &event.color[0], 4);
+            if (valid && (fields & FIELD_MATRIX))
+                valid = readFloats(data, offset, &event.matrix[0][0], 16);
+            if (valid && (fields & FIELD_LIMITS))
+                valid = readVarint(data, offset, event.limits[0]) && readVarint(data, offset, event.limits[1]);
+        }
+
+        // A log cut short by a crash still replays up to the damaged event
+        if (!valid)
+        {
+            std::cout << "Session log is truncated after " << events.size() << " events: " << path << std::endl;
+            break;
+        }
+
+        events.push_back(event);
+    }
+
+    position = 0;
+    opened = true;
+
+    return true;
+}
+
+bool SessionPlayer::isOpen()
+{
+    return opened;
+}
+
+const SessionHeader& SessionPlayer::getHeader()
+{
+    return header;
+}
+
+const SessionEvent* SessionPlayer::peek()
+{
+    return position < events.size() ? &events[position] : nullptr;
+}
+
+void SessionPlayer::pop()
+{
+    if (position < events.size())
+        ++position;
+}
+
+unsigned long long SessionPlayer::getLastTick()
+{
+    return events.empty() ? 0 : events.back().tick;
+}
+
+unsigned int SessionPlayer::getPosition()
+{
+    return position;
+}
+
+unsigned int SessionPlayer::getSize()
+{
+    return events.size();
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief One recorded input, tagged with the published simulation tick it was made at
+ */
+struct SessionEvent
+{
+    enum Type : unsigned char
+    {
+        TICK_TIME,          // value: glTime the next tick was started with
+        CAMERA_KEY,         // index: Camera_Movement, value: deltaTime
+        CAMERA_MOUSE,       // vector: x and y offsets
+        ADD_OBSTACLE,       // matrix, color
+        REMOVE_OBSTACLE,    // index
+        OBJECT_COLOR,       // index, color
+        ADD_SOURCE,         // vector: position, value: speed, color
+        REMOVE_SOURCE,      // index
+        EMIT_WAVES,
+        EMIT_SOURCE,        // index: wave source
+        LIGHT,              // vector: position, color: rgb
+        WAVE_BUDGET,        // index: policy, limits: live vertices and bytes, 0 for no limit
+        TYPE_COUNT
+    };
+
+    Type type = TICK_TIME;
+    unsigned long long tick = 0;
+
+    int index = 0;
+    float value = 0.0f;
+    glm::vec3 vector = glm::vec3(0.0f);
+    glm::vec4 color = glm::vec4(0.0f);
+    glm::mat4 matrix = glm::mat4(1.0f);
+    // Exact integers, a float would round the larger ones
+    unsigned long long limits[2] = { 0, 0 };
+};
+
+/**
+ * \brief Settings a session needs to be replayed the same way
+ */
+struct SessionHeader
+{
+    bool deterministic = false;
+    std::string scenePath;
+};
+
+/**
+ * \brief Writes inputs to a session log.
+ *
+ * Log layout: magic, version, header (deterministic flag, scene path),
+ * then per event the type byte, the tick delta to the previous event as a
+ * variable-length integer and only the fields the type uses.
+ */
+class SessionRecorder
+{
+public:
+    ~SessionRecorder();
+
+    bool open(const std::string& path, const SessionHeader& header);
+    bool isOpen();
+    void record(const SessionEvent& event);
+    void close();
+
+private:
+    std::ofstream file;
+    unsigned long long lastTick = 0;
+    unsigned long long count = 0;
+};
+
+/**
+ * \brief Reads a session log and hands events out in recorded order
+ */
+class SessionPlayer
+{
+public:
+    bool open(const std::string& path);
+    bool isOpen();
+
+    const SessionHeader& getHeader();
+    const SessionEvent* peek();
+    void pop();
+
+    unsigned long long getLastTick();
+    unsigned int getPosition();
+    unsigned int getSize();
+
+private:
+    SessionHeader header;
+    std::vector<SessionEvent> events;
+    unsigned int position = 0;
+    bool opened = false;
+};
\ No newline at end of file
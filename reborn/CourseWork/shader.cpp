@@ -30,6 +30,22 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
         std::cout << "Error: " << e.what() << std::endl;
     }
 
+    // Program binaries are only valid for the driver that produced them
+    std::string driver;
+    driver += (const char*)glGetString(GL_VENDOR);
+    driver += (const char*)glGetString(GL_RENDERER);
+    driver += (const char*)glGetString(GL_VERSION);
+
+    unsigned long long key = hashString(driver, 14695981039346656037ULL);
+    key = hashString(vertexCode, key);
+    key = hashString(fragmentCode, key);
+
+    std::string cachePath(vertexPath);
+    cachePath = cachePath.substr(0, cachePath.find_last_of('.')) + ".cache";
+
+    if (loadProgramBinary(cachePath, key))
+        return;
+
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
@@ -48,6 +64,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     checkCompileErrors(fragment, "FRAGMENT");
 
     programID = glCreateProgram();
+    if (programBinarySupported())
+        glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glAttachShader(programID, vertex);
     glAttachShader(programID, fragment);
     glLinkProgram(programID);
@@ -56,6 +74,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    saveProgramBinary(cachePath, key);
 }
 
 Shader::~Shader()
@@ -68,33 +88,134 @@ void Shader::use()
     glUseProgram(programID);
 }
 
-void Shader::setBool(const std::string& name, bool value) const
+void Shader::setBool(const char* name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(programID, name.c_str()), (int)value);
+    glUniform1i(glGetUniformLocation(programID, name), (int)value);
 }
 
-void Shader::setInt(const std::string& name, int value) const
+void Shader::setInt(const char* name, int value) const
 {
-    glUniform1i(glGetUniformLocation(programID, name.c_str()), value);
+    glUniform1i(glGetUniformLocation(programID, name), value);
 }
 
-void Shader::setFloat(const std::string& name, float value) const
+void Shader::setFloat(const char* name, float value) const
 {
-    glUniform1f(glGetUniformLocation(programID, name.c_str()), value);
+    glUniform1f(glGetUniformLocation(programID, name), value);
 }
 
-void Shader::setVec3(const std::string& name, const glm::vec3& vec) const
+void Shader::setVec3(const char* name, const glm::vec3& vec) const
 {
-    glUniform3f(glGetUniformLocation(programID, name.c_str()), vec.x, vec.y, vec.z);
+    glUniform3f(glGetUniformLocation(programID, name), vec.x, vec.y, vec.z);
 }
 
-void Shader::setVec4(const std::string& name, const glm::vec4& vec) const
+void Shader::setVec4(const char* name, const glm::vec4& vec) const
 {
-    glUniform4f(glGetUniformLocation(programID, name.c_str()), vec.x, vec.y, vec.z, vec.w);
+    glUniform4f(glGetUniformLocation(programID, name), vec.x, vec.y, vec.z, vec.w);
 }
 
-void Shader::setMat4(const std::string& name, glm::mat4& m4) const
+void Shader::setMat4(const char* name, glm::mat4& m4) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(programID, name.c_str()), 1, 
+    glUniformMatrix4fv(glGetUniformLocation(programID, name), 1, 
         GL_FALSE, &m4[0][0]);
+}
+
+/**
+ * \brief Cache file layout: magic, key, binary format, binary length, binary
+ */
+const unsigned int PROGRAM_CACHE_MAGIC = 0x42505743; // "CWPB"
+
+bool Shader::loadProgramBinary(const std::string& cachePath, unsigned long long key)
+{
+    if (!programBinarySupported())
+        return false;
+
+    std::ifstream cacheFile(cachePath, std::ios::binary);
+    if (!cacheFile.is_open())
+        return false;
+
+    unsigned int magic = 0, format = 0, length = 0;
+    unsigned long long cachedKey = 0;
+
+    cacheFile.read((char*)&magic, sizeof(magic));
+    cacheFile.read((char*)&cachedKey, sizeof(cachedKey));
+    cacheFile.read((char*)&format, sizeof(format));
+    cacheFile.read((char*)&length, sizeof(length));
+
+    if (!cacheFile || magic != PROGRAM_CACHE_MAGIC || cachedKey != key || length == 0)
+        return false;
+
+    std::vector<char> binary(length);
+    if (!cacheFile.read(&binary[0], length))
+        return false;
+
+    programID = glCreateProgram();
+    glProgramBinary(programID, format, &binary[0], length);
+
+    int success;
+    glGetProgramiv(programID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        std::cout << "Program binary cache is stale, compiling from source: " << cachePath << std::endl;
+        glDeleteProgram(programID);
+        programID = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void Shader::saveProgramBinary(const std::string& cachePath, unsigned long long key)
+{
+    if (!programBinarySupported())
+        return;
+
+    int success, length = 0;
+    glGetProgramiv(programID, GL_LINK_STATUS, &success);
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(programID, length, &length, &format, &binary[0]);
+
+    std::ofstream cacheFile(cachePath, std::ios::binary | std::ios::trunc);
+    if (!cacheFile.is_open())
+    {
+        std::cout << "Failed to write program binary cache: " << cachePath << std::endl;
+        return;
+    }
+
+    unsigned int magic = PROGRAM_CACHE_MAGIC, binaryFormat = format, binaryLength = length;
+
+    cacheFile.write((const char*)&magic, sizeof(magic));
+    cacheFile.write((const char*)&key, sizeof(key));
+    cacheFile.write((const char*)&binaryFormat, sizeof(binaryFormat));
+    cacheFile.write((const char*)&binaryLength, sizeof(binaryLength));
+    cacheFile.write(&binary[0], binaryLength);
+}
+
+bool Shader::programBinarySupported()
+{
+    if (!GLAD_GL_VERSION_4_1 || glProgramBinary == NULL)
+        return false;
+
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+    return formats > 0;
+}
+
+unsigned long long Shader::hashString(const std::string& str, unsigned long long seed)
+{
+    // FNV-1a
+    unsigned long long hash = seed;
+
+    for (unsigned char c : str)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
 }
\ No newline at end of file
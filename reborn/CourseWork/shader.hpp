@@ -20,14 +20,20 @@ public:
 
     void use();
 
-    void setBool(const std::string& name, bool value) const;
-    void setInt(const std::string& name, int value) const;
-    void setFloat(const std::string& name, float value) const;
-    void setVec3(const std::string& name, const glm::vec3& vec) const;
-    void setVec4(const std::string& name, const glm::vec4& vec) const;
-    void setMat4(const std::string& name, glm::mat4& m4) const;
+    void setBool(const char* name, bool value) const;
+    void setInt(const char* name, int value) const;
+    void setFloat(const char* name, float value) const;
+    void setVec3(const char* name, const glm::vec3& vec) const;
+    void setVec4(const char* name, const glm::vec4& vec) const;
+    void setMat4(const char* name, glm::mat4& m4) const;
 
 private:
+    bool loadProgramBinary(const std::string& cachePath, unsigned long long key);
+    void saveProgramBinary(const std::string& cachePath, unsigned long long key);
+
+    static bool programBinarySupported();
+    static unsigned long long hashString(const std::string& str, unsigned long long seed);
+
     void checkCompileErrors(unsigned int shader, std::string type)
     {
         int success;
@@ -0,0 +1,101 @@
+#include "sharding.hpp"
+#include "loader.hpp"
+#include "meshcache.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+
+int main(int argc, char* argv[])
+{
+    ShardSettings settings;
+    int i;
+
+    // Nothing is drawn, models are loaded without GL objects and no context is created
+    Loader loader;
+    loader.setVerbose(false);
+    loader.setCreateMeshes(false);
+    MeshCache meshCache(loader);
+
+    if (argc == 4 && strcmp(argv[1], "--worker") == 0)
+    {
+        ShardWorker worker(meshCache);
+        return worker.run(argv[2], atoi(argv[3])) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    settings.executable = argv[0];
+
+    for (i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--scene") == 0 && hasValue)
+            settings.scenePath = argv[++i];
+        else if (strcmp(argv[i], "--processes") == 0 && hasValue)
+            settings.processes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ticks") == 0 && hasValue)
+            settings.ticks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tick-time") == 0 && hasValue)
+            settings.tickTime = static_cast<float>(atof(argv[++i]));
+        else if (strcmp(argv[i], "--fps") == 0 && hasValue)
+            settings.frameRate = static_cast<float>(atof(argv[++i]));
+        else if (strcmp(argv[i], "--out") == 0 && hasValue)
+            settings.statsPath = argv[++i];
+        else
+        {
+            std::cout << "Usage: Shard --scene <file> [--processes <count>] [--ticks <count>] [--tick-time <time>]" << std::endl;
+            std::cout << "             [--fps <frames>] [--out <csv file>]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (settings.scenePath.empty())
+    {
+        std::cout << "A scene file is needed, its wave sources are split over the processes" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream stats(settings.statsPath);
+    if (!stats.is_open())
+    {
+        std::cout << "Failed to open statistics output: " << settings.statsPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ShardCoordinator coordinator(meshCache, settings);
+    if (!coordinator.start())
+        return EXIT_FAILURE;
+
+    stats << "tick,waves,live_vertices,room_reflections,obstacle_tests,triangles_killed,absorbed,failed_shards" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+
+    while (coordinator.step())
+    {
+        const ShardMerge& merge = coordinator.getMerge();
+        unsigned long long absorbed = 0;
+
+        for (unsigned long long hits : merge.objectHits)
+            absorbed += hits;
+
+        stats << merge.tick << "," << merge.waves.size() << "," << merge.liveVertices
+            << "," << merge.totalCounters.roomReflections << "," << merge.totalCounters.vertexObstacleTests
+            << "," << merge.totalCounters.trianglesKilled << "," << absorbed << "," << merge.failedShards << "\n";
+    }
+
+    const ShardMerge& merge = coordinator.getMerge();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Merged " << merge.tick << " ticks of " << coordinator.getShardCount() << " shards in " << seconds << " s, "
+        << (seconds > 0.0 ? merge.tick / seconds : 0.0) << " ticks per second" << std::endl;
+    for (i = 0; i < (int)merge.objectHits.size(); ++i)
+        std::cout << "Obstacle " << i << " absorbed " << merge.objectHits[i] << " vertices" << std::endl;
+
+    unsigned int failedShards = merge.failedShards;
+    coordinator.finish();
+
+    return failedShards == 0 && merge.tick == settings.ticks ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,534 @@
+#include "sharding.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+#include "obstacle.hpp"
+#include "command.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <new>
+#include <thread>
+#include <glm/gtc/matrix_transform.hpp>
+
+
+const unsigned int SHARD_MAGIC = 0x48535743; // "CWSH"
+const unsigned int SHARD_VERSION = 1;
+
+/**
+ * \brief Polls spent yielding before a waiting side starts to sleep
+ */
+const unsigned int SPIN_COUNT = 1000;
+const unsigned int WAIT_SLEEP_MICROSECONDS = 50;
+
+/**
+ * \brief A worker whose frame is not merged for this long takes the coordinator for dead
+ */
+const double WORKER_TIMEOUT_SECONDS = 30.0;
+
+static unsigned long long alignUp(unsigned long long value, unsigned long long alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static void pause(unsigned int& spins)
+{
+    if (++spins < SPIN_COUNT)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(WAIT_SLEEP_MICROSECONDS));
+}
+
+static unsigned long long getHeaderSize()
+{
+    return alignUp(sizeof(ShardHeader), 64);
+}
+
+static unsigned long long getStateSize()
+{
+    return alignUp(sizeof(ShardState), 64);
+}
+
+static unsigned long long getHitsOffset()
+{
+    return alignUp(sizeof(ShardFrame), 16);
+}
+
+bool ShardMemory::create(const std::string& name, unsigned int shardCount, unsigned int objectCount,
+    unsigned int waveCapacity, unsigned int vertexCapacity)
+{
+    unsigned long long wavesOffset = alignUp(getHitsOffset() + objectCount * sizeof(unsigned long long), 16);
+    unsigned long long positionsOffset = wavesOffset + waveCapacity * sizeof(ShardWave);
+    unsigned long long frameSize = alignUp(positionsOffset + vertexCapacity * sizeof(glm::vec3), 64);
+    unsigned long long blockSize = getStateSize() + 2 * frameSize;
+    unsigned int i;
+
+    if (!memory.create(name, getHeaderSize() + shardCount * blockSize))
+        return false;
+
+    // The pages of a new mapping are zero, only the atomics need constructing
+    header = new (memory.getData()) ShardHeader();
+    header->magic = SHARD_MAGIC;
+    header->version = SHARD_VERSION;
+    header->shardCount = shardCount;
+    header->objectCount = objectCount;
+    header->waveCapacity = waveCapacity;
+    header->vertexCapacity = vertexCapacity;
+    header->frameSize = frameSize;
+    header->blockSize = blockSize;
+    header->stop = 0;
+
+    for (i = 0; i < shardCount; ++i)
+    {
+        ShardState* state = new (&getState(i)) ShardState();
+        state->published = 0;
+        state->consumed = 0;
+        state->status = SHARD_STARTING;
+    }
+
+    return true;
+}
+
+bool ShardMemory::open(const std::string& name)
+{
+    if (!memory.open(name))
+        return false;
+
+    header = (ShardHeader*)memory.getData();
+
+    if (memory.getSize() < getHeaderSize() || header->magic != SHARD_MAGIC || header->version != SHARD_VERSION ||
+        memory.getSize() < getHeaderSize() + header->shardCount * header->blockSize)
+    {
+        std::cout << "Shared memory is not a shard run: " << name << std::endl;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void ShardMemory::close()
+{
+    memory.close();
+    header = nullptr;
+}
+
+bool ShardMemory::isOpen()
+{
+    return header != nullptr;
+}
+
+ShardHeader& ShardMemory::getHeader()
+{
+    return *header;
+}
+
+ShardState& ShardMemory::getState(unsigned int shard)
+{
+    return *(ShardState*)(memory.getData() + getHeaderSize() + shard * header->blockSize);
+}
+
+ShardFrame& ShardMemory::getFrame(unsigned int shard, unsigned long long tick)
+{
+    return *(ShardFrame*)((unsigned char*)&getState(shard) + getStateSize() + (tick % 2) * header->frameSize);
+}
+
+unsigned long long* ShardMemory::getHits(ShardFrame& frame)
+{
+    return (unsigned long long*)((unsigned char*)&frame + getHitsOffset());
+}
+
+ShardWave* ShardMemory::getWaves(ShardFrame& frame)
+{
+    return (ShardWave*)((unsigned char*)&frame + getWavesOffset());
+}
+
+glm::vec3* ShardMemory::getPositions(ShardFrame& frame)
+{
+    return (glm::vec3*)((unsigned char*)&frame + getPositionsOffset());
+}
+
+unsigned long long ShardMemory::getWavesOffset()
+{
+    return alignUp(getHitsOffset() + header->objectCount * sizeof(unsigned long long), 16);
+}
+
+unsigned long long ShardMemory::getPositionsOffset()
+{
+    return getWavesOffset() + header->waveCapacity * sizeof(ShardWave);
+}
+
+ShardCoordinator::ShardCoordinator(MeshCache& meshCache, const ShardSettings& settings) :
+    meshCache(meshCache),
+    settings(settings)
+{
+}
+
+ShardCoordinator::~ShardCoordinator()
+{
+    finish();
+}
+
+bool ShardCoordinator::start()
+{
+    if (!SceneFile::load(settings.scenePath, description))
+        return false;
+
+    unsigned int sourceCount = description.sources.size();
+    if (sourceCount == 0)
+    {
+        std::cout << "Scene has no wave sources to shard: " << settings.scenePath << std::endl;
+        return false;
+    }
+
+    if (settings.scenePath.size() >= sizeof(ShardHeader::scenePath))
+    {
+        std::cout << "Scene path is too long: " << settings.scenePath << std::endl;
+        return false;
+    }
+
+    unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+    unsigned int shardCount = settings.processes ? settings.processes : cores;
+    shardCount = std::min(shardCount, sourceCount);
+
+    // Capacity of the frames, every source emits one wave
+    glm::mat4 identity = glm::mat4(1.0f);
+    glm::vec4 color = glm::vec4(1.0f);
+    float speed = 1.0f;
+
+    Sphere probe(identity, color, speed, false);
+    meshCache.loadModel(description.waveMesh, probe);
+    if (probe.getVertices().empty())
+    {
+        std::cout << "Wave mesh is missing: " << description.waveMesh << std::endl;
+        return false;
+    }
+
+    unsigned int waveCapacity = (sourceCount + shardCount - 1) / shardCount;
+    unsigned int vertexCapacity = waveCapacity * probe.getVertices().size();
+    std::string name = "coursework_shard_" + std::to_string(Process::getCurrentId());
+    unsigned int shard;
+
+    if (!memory.create(name, shardCount, description.obstacles.size(), waveCapacity, vertexCapacity))
+        return false;
+
+    ShardHeader& header = memory.getHeader();
+    header.ticks = settings.ticks;
+    header.poolWorkers = std::max(cores / shardCount, 1u) - 1;
+    header.tickTime = settings.tickTime;
+    header.frameRate = settings.frameRate;
+    strcpy(header.scenePath, settings.scenePath.c_str());
+
+    failed.assign(shardCount, false);
+    shardTotals.assign(shardCount, SimulationCounters());
+    shardHits.assign(shardCount, std::vector<unsigned long long>(description.obstacles.size(), 0));
+
+    merge = ShardMerge();
+    merge.objectHits.assign(description.obstacles.size(), 0);
+
+    for (shard = 0; shard < shardCount; ++shard)
+    {
+        memory.getState(shard).sourceCount = (sourceCount - shard + shardCount - 1) / shardCount;
+
+        Process* worker = new Process();
+        workers.push_back(worker);
+
+        if (!worker->start(settings.executable, { "--worker", name, std::to_string(shard) }))
+        {
+            failed[shard] = true;
+            ++merge.failedShards;
+        }
+    }
+
+    std::cout << "Sharding " << sourceCount << " sources over " << shardCount << " processes, "
+        << header.poolWorkers + 1 << " threads each" << std::endl;
+
+    return merge.failedShards < shardCount;
+}
+
+/**
+ * \brief Merges the next tick of every running shard, false once every tick is merged.
+ * The frames of the previous tick are handed back to the workers first
+ */
+bool ShardCoordinator::step()
+{
+    TRACE_SCOPE("ShardCoordinator::step");
+
+    if (workers.empty() || merge.tick >= settings.ticks)
+        return false;
+
+    unsigned long long tick = merge.tick + 1;
+    unsigned int shard, i;
+
+    for (shard = 0; shard < workers.size(); ++shard)
+        if (!failed[shard])
+            memory.getState(shard).consumed.store(tick - 1, std::memory_order_release);
+
+    merge.tick = tick;
+    merge.tickCounters = SimulationCounters();
+    merge.totalCounters = SimulationCounters();
+    merge.waves.clear();
+    merge.liveVertices = 0;
+    std::fill(merge.objectHits.begin(), merge.objectHits.end(), 0);
+
+    for (shard = 0; shard < workers.size(); ++shard)
+    {
+        if (!failed[shard])
+        {
+            if (waitForShard(shard, tick))
+            {
+                ShardFrame& frame = memory.getFrame(shard, tick);
+                unsigned long long* hits = memory.getHits(frame);
+                ShardWave* waves = memory.getWaves(frame);
+                glm::vec3* positions = memory.getPositions(frame);
+
+                merge.tickCounters.add(frame.tickCounters);
+                shardTotals[shard] = frame.totalCounters;
+                std::copy(hits, hits + shardHits[shard].size(), shardHits[shard].begin());
+
+                for (i = 0; i < frame.waveCount; ++i)
+                {
+                    merge.waves.push_back({ shard, &waves[i], positions + waves[i].first });
+                    merge.liveVertices += waves[i].liveVertices;
+                }
+            }
+            else
+            {
+                failed[shard] = true;
+                ++merge.failedShards;
+            }
+        }
+
+        merge.totalCounters.add(shardTotals[shard]);
+        for (i = 0; i < merge.objectHits.size(); ++i)
+            merge.objectHits[i] += shardHits[shard][i];
+    }
+
+    return merge.failedShards < workers.size();
+}
+
+/**
+ * \brief Stops the workers and waits for them, the shared memory goes with them
+ */
+void ShardCoordinator::finish()
+{
+    unsigned int shard;
+
+    if (!memory.isOpen())
+        return;
+
+    memory.getHeader().stop = 1;
+
+    for (shard = 0; shard < workers.size(); ++shard)
+    {
+        workers[shard]->wait();
+        if (workers[shard]->getExitCode() != 0)
+            std::cout << "Shard " << shard << " exited with code " << workers[shard]->getExitCode() << std::endl;
+        delete workers[shard];
+    }
+    workers.clear();
+
+    memory.close();
+}
+
+const ShardMerge& ShardCoordinator::getMerge()
+{
+    return merge;
+}
+
+unsigned int ShardCoordinator::getShardCount()
+{
+    return workers.size();
+}
+
+bool ShardCoordinator::waitForShard(unsigned int shard, unsigned long long tick)
+{
+    ShardState& state = memory.getState(shard);
+    unsigned int spins = 0;
+
+    while (state.published.load(std::memory_order_acquire) < tick)
+    {
+        // A worker may publish its last tick and exit between the two checks
+        if (!workers[shard]->isRunning() && state.published.load(std::memory_order_acquire) < tick)
+        {
+            std::cout << "Shard " << shard << " stopped at tick " << state.published.load()
+                << " with code " << workers[shard]->getExitCode() << ", its waves are dropped" << std::endl;
+            return false;
+        }
+
+        pause(spins);
+    }
+
+    return true;
+}
+
+ShardWorker::ShardWorker(MeshCache& meshCache) : meshCache(meshCache)
+{
+}
+
+bool ShardWorker::run(const std::string& memoryName, unsigned int shard)
+{
+    if (!memory.open(memoryName))
+        return false;
+
+    ShardHeader& header = memory.getHeader();
+    if (shard >= header.shardCount)
+    {
+        std::cout << "No shard " << shard << " in " << memoryName << std::endl;
+        return false;
+    }
+
+    ShardState& state = memory.getState(shard);
+    state.status = SHARD_RUNNING;
+
+    SceneDescription description;
+    if (!SceneFile::load(header.scenePath, description) || description.obstacles.size() != header.objectCount)
+    {
+        state.status = SHARD_FAILED;
+        return false;
+    }
+
+    Scene scene(header.poolWorkers);
+    unsigned int i, queued = 0;
+
+    for (const ObstacleDescription& obstacle : description.obstacles)
+    {
+        glm::mat4 modelMatrix = obstacle.modelMatrix;
+        glm::vec4 modelColor = obstacle.color;
+
+        Obstacle* object = new Obstacle(modelMatrix, modelColor, obstacle.cullMode);
+        meshCache.loadModel(obstacle.mesh, *object);
+        scene.addObject(object);
+
+        if (++queued == CommandQueue::CAPACITY / 2)
+        {
+            scene.flush();
+            queued = 0;
+        }
+    }
+    scene.flush();
+
+    // Every shardCount-th source, each emits once at the tick of its launch time
+    std::vector<unsigned int> launchTicks, sourceIndices;
+    std::vector<Sphere*> sources;
+    std::map<unsigned int, unsigned int> waveSources;
+
+    for (i = shard; i < description.sources.size(); i += header.shardCount)
+    {
+        const WaveSourceDescription& source = description.sources[i];
+        glm::mat4 waveMatrix = glm::translate(glm::mat4(1.0f), source.position);
+        glm::vec4 sourceColor = source.color;
+        float sourceSpeed = source.speed;
+
+        Sphere* wave = new Sphere(waveMatrix, sourceColor, sourceSpeed, false);
+        meshCache.loadModel(description.waveMesh, *wave);
+
+        sources.push_back(wave);
+        sourceIndices.push_back(i);
+        launchTicks.push_back(static_cast<unsigned int>(source.launchTime * header.frameRate + 0.5f));
+    }
+
+    unsigned long long tick;
+    bool completed = true;
+
+    for (tick = 0; tick < header.ticks; ++tick)
+    {
+        for (i = 0; i < sources.size(); ++i)
+            if (launchTicks[i] == tick)
+            {
+                Sphere* wave = new Sphere(static_cast<Model&>(*sources[i]));
+                waveSources[wave->getWaveId()] = sourceIndices[i];
+                scene.addSphere(wave);
+            }
+
+        scene.simulate(header.tickTime);
+        scene.swap();
+
+        // Stopped by the coordinator is not a failure
+        if (!waitForFrame(state, tick + 1))
+        {
+            completed = header.stop != 0;
+            break;
+        }
+
+        const SceneSnapshot& snapshot = scene.getSnapshot();
+        ShardFrame& frame = memory.getFrame(shard, tick + 1);
+        unsigned long long* hits = memory.getHits(frame);
+        ShardWave* waves = memory.getWaves(frame);
+        glm::vec3* positions = memory.getPositions(frame);
+        unsigned int first = 0;
+
+        frame.tick = tick + 1;
+        frame.tickCounters = snapshot.tickCounters;
+        frame.totalCounters = snapshot.totalCounters;
+
+        for (i = 0; i < header.objectCount; ++i)
+            hits[i] = i < snapshot.objectHits.size() ? snapshot.objectHits[i] : 0;
+
+        for (i = 0; i < snapshot.spheres.size() && completed; ++i)
+        {
+            Sphere* sphere = static_cast<Sphere*>(snapshot.spheres[i]);
+            const std::vector<glm::vec3>& wavePositions = sphere->getPositions();
+
+            if (i >= header.waveCapacity || first + wavePositions.size() > header.vertexCapacity)
+            {
+                std::cout << "Shard " << shard << " has more waves than its frame holds" << std::endl;
+                completed = false;
+                break;
+            }
+
+            waves[i].source = waveSources[sphere->getWaveId()];
+            waves[i].vertexCount = wavePositions.size();
+            waves[i].liveVertices = snapshot.sphereLive[i];
+            waves[i].first = first;
+            waves[i].color = sphere->getDrawColor();
+
+            std::copy(wavePositions.begin(), wavePositions.end(), positions + first);
+            first += wavePositions.size();
+        }
+
+        if (!completed)
+            break;
+
+        frame.waveCount = snapshot.spheres.size();
+        frame.vertexCount = first;
+
+        state.published.store(tick + 1, std::memory_order_release);
+    }
+
+    state.status = completed ? SHARD_DONE : SHARD_FAILED;
+
+    for (Sphere* source : sources)
+        delete source;
+    memory.close();
+
+    return completed;
+}
+
+/**
+ * \brief Waits until the coordinator merged the tick that used the frame of tick
+ */
+bool ShardWorker::waitForFrame(ShardState& state, unsigned long long tick)
+{
+    ShardHeader& header = memory.getHeader();
+    auto start = std::chrono::steady_clock::now();
+    unsigned int spins = 0;
+
+    while (state.consumed.load(std::memory_order_acquire) + 2 < tick)
+    {
+        if (header.stop)
+            return false;
+
+        if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > WORKER_TIMEOUT_SECONDS)
+        {
+            std::cout << "Coordinator stopped merging, shard gives up" << std::endl;
+            return false;
+        }
+
+        pause(spins);
+    }
+
+    return !header.stop;
+}
\ No newline at end of file
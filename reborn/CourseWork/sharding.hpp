@@ -0,0 +1,206 @@
+#pragma once
+
+#include "meshcache.hpp"
+#include "metrics.hpp"
+#include "process.hpp"
+#include "scenefile.hpp"
+#include "sharedmemory.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief Shared memory layout of a sharded run, native byte order.
+ *
+ * The header is followed by one block per shard, its state and two frames.
+ * A frame holds the counters, the obstacle hits since start, the waves and
+ * the wave positions of one tick. A worker writes tick t into frame t % 2
+ * once the coordinator merged tick t - 2, so it runs at most one tick ahead
+ * and never writes the frame being merged.
+ */
+struct ShardHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int shardCount;
+    unsigned int objectCount;
+    unsigned int waveCapacity;
+    unsigned int vertexCapacity;
+    unsigned long long frameSize;
+    unsigned long long blockSize;
+
+    unsigned int ticks;
+    unsigned int poolWorkers;
+    float tickTime;
+    float frameRate;
+    char scenePath[512];
+
+    // Set by the coordinator, workers stop before their next tick
+    std::atomic<unsigned int> stop;
+};
+
+enum ShardStatus
+{
+    SHARD_STARTING,
+    SHARD_RUNNING,
+    SHARD_DONE,
+    SHARD_FAILED
+};
+
+struct ShardState
+{
+    // Last tick written by the worker and last tick merged by the coordinator
+    std::atomic<unsigned long long> published;
+    std::atomic<unsigned long long> consumed;
+    std::atomic<unsigned int> status;
+    unsigned int sourceCount;
+};
+
+struct ShardWave
+{
+    // Index of the wave source in the scene file
+    unsigned int source;
+    unsigned int vertexCount;
+    unsigned int liveVertices;
+    // First position of the wave in its frame
+    unsigned int first;
+    glm::vec4 color;
+};
+
+struct ShardFrame
+{
+    unsigned long long tick;
+    SimulationCounters tickCounters;
+    SimulationCounters totalCounters;
+    unsigned int waveCount;
+    unsigned int vertexCount;
+};
+
+/**
+ * \brief Typed access to the shared memory of a sharded run
+ */
+class ShardMemory
+{
+public:
+    bool create(const std::string& name, unsigned int shardCount, unsigned int objectCount,
+        unsigned int waveCapacity, unsigned int vertexCapacity);
+    bool open(const std::string& name);
+    void close();
+    bool isOpen();
+
+    ShardHeader& getHeader();
+    ShardState& getState(unsigned int shard);
+    ShardFrame& getFrame(unsigned int shard, unsigned long long tick);
+
+    unsigned long long* getHits(ShardFrame& frame);
+    ShardWave* getWaves(ShardFrame& frame);
+    glm::vec3* getPositions(ShardFrame& frame);
+
+private:
+    SharedMemory memory;
+    ShardHeader* header = nullptr;
+
+    unsigned long long getWavesOffset();
+    unsigned long long getPositionsOffset();
+};
+
+/**
+ * \brief What the coordinator runs and how many processes share it
+ */
+struct ShardSettings
+{
+    std::string scenePath;
+    // Worker processes, 0 takes one per core but no more than there are sources
+    unsigned int processes = 0;
+    unsigned int ticks = 600;
+    float tickTime = 1.0f;
+    float frameRate = 60.0f;
+
+    // Started with --worker to run a shard, the coordinator's own executable
+    std::string executable;
+    std::string statsPath = "shards.csv";
+};
+
+struct ShardMergedWave
+{
+    unsigned int shard;
+    const ShardWave* wave;
+    const glm::vec3* positions;
+};
+
+/**
+ * \brief Scene state of one tick merged over every shard
+ */
+struct ShardMerge
+{
+    unsigned long long tick = 0;
+    SimulationCounters tickCounters;
+    SimulationCounters totalCounters;
+    std::vector<unsigned long long> objectHits;
+    std::vector<ShardMergedWave> waves;
+    unsigned long long liveVertices = 0;
+    unsigned int failedShards = 0;
+};
+
+/**
+ * \brief Splits the wave sources of a scene over worker processes.
+ *
+ * Waves never meet each other, so every worker simulates the obstacles of
+ * the scene with every shardCount-th source and the sums over the shards
+ * equal a single process run. step() waits for every shard to publish the
+ * next tick and merges the counters and the live waves, the wave positions
+ * are read in place from the shared memory until the next step().
+ *
+ * A worker that dies is dropped, the counts it published so far stay in
+ * the totals and its waves leave the merge. The others run on.
+ */
+class ShardCoordinator
+{
+public:
+    ShardCoordinator(MeshCache& meshCache, const ShardSettings& settings);
+    ~ShardCoordinator();
+
+    bool start();
+    bool step();
+    void finish();
+
+    const ShardMerge& getMerge();
+    unsigned int getShardCount();
+
+private:
+    MeshCache& meshCache;
+    ShardSettings settings;
+
+    SceneDescription description;
+    ShardMemory memory;
+    std::vector<Process*> workers;
+    std::vector<bool> failed;
+
+    // Totals of the last merged tick of every shard, kept when a shard fails
+    std::vector<SimulationCounters> shardTotals;
+    std::vector<std::vector<unsigned long long>> shardHits;
+
+    ShardMerge merge;
+
+    bool waitForShard(unsigned int shard, unsigned long long tick);
+};
+
+/**
+ * \brief One worker process of a sharded run
+ */
+class ShardWorker
+{
+public:
+    ShardWorker(MeshCache& meshCache);
+
+    bool run(const std::string& memoryName, unsigned int shard);
+
+private:
+    MeshCache& meshCache;
+    ShardMemory memory;
+
+    bool waitForFrame(ShardState& state, unsigned long long tick);
+};
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "sharedmemory.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+
+
+SharedMemory::~SharedMemory()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool SharedMemory::create(const std::string& name, unsigned long long size)
+{
+    close();
+
+    systemName = "Local\\" + name;
+    mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), systemName.c_str());
+    if (mappingHandle == NULL || GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        std::cout << "Failed to create shared memory: " << name << std::endl;
+        close();
+        return false;
+    }
+
+    data = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (data == nullptr)
+    {
+        std::cout << "Failed to map shared memory: " << name << std::endl;
+        close();
+        return false;
+    }
+
+    this->size = size;
+    owner = true;
+
+    return true;
+}
+
+bool SharedMemory::open(const std::string& name)
+{
+    close();
+
+    systemName = "Local\\" + name;
+    mappingHandle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, systemName.c_str());
+    if (mappingHandle)
+        data = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+    if (data == nullptr)
+    {
+        std::cout << "Failed to open shared memory: " << name << std::endl;
+        close();
+        return false;
+    }
+
+    // The view covers whole pages, the creator's size is at most that
+    MEMORY_BASIC_INFORMATION information;
+    VirtualQuery(data, &information, sizeof(information));
+    size = information.RegionSize;
+
+    return true;
+}
+
+void SharedMemory::close()
+{
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+
+    data = nullptr;
+    mappingHandle = nullptr;
+    size = 0;
+    owner = false;
+}
+
+void SharedMemory::remove(const std::string& name)
+{
+    // A mapping goes away with its last handle, nothing outlives a process
+}
+
+#else
+
+bool SharedMemory::create(const std::string& name, unsigned long long size)
+{
+    close();
+
+    systemName = "/" + name;
+    int file = shm_open(systemName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (file < 0)
+    {
+        std::cout << "Failed to create shared memory: " << name << std::endl;
+        return false;
+    }
+    owner = true;
+
+    void* mapping = ftruncate(file, size) == 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+    ::close(file);
+
+    if (mapping == MAP_FAILED)
+    {
+        std::cout << "Failed to map shared memory: " << name << std::endl;
+        close();
+        return false;
+    }
+
+    data = (unsigned char*)mapping;
+    this->size = size;
+
+    return true;
+}
+
+bool SharedMemory::open(const std::string& name)
+{
+    close();
+
+    systemName = "/" + name;
+    int file = shm_open(systemName.c_str(), O_RDWR, 0600);
+    if (file < 0)
+    {
+        std::cout << "Failed to open shared memory: " << name << std::endl;
+        return false;
+    }
+
+    struct stat status;
+    fstat(file, &status);
+
+    void* mapping = status.st_size ? mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+    ::close(file);
+
+    if (mapping == MAP_FAILED)
+    {
+        std::cout << "Failed to map shared memory: " << name << std::endl;
+        return false;
+    }
+
+    data = (unsigned char*)mapping;
+    size = status.st_size;
+
+    return true;
+}
+
+void SharedMemory::close()
+{
+    if (data)
+        munmap(data, size);
+    if (owner)
+        shm_unlink(systemName.c_str());
+
+    data = nullptr;
+    size = 0;
+    owner = false;
+}
+
+void SharedMemory::remove(const std::string& name)
+{
+    shm_unlink(("/" + name).c_str());
+}
+
+#endif
+
+bool SharedMemory::isOpen()
+{
+    return data != nullptr;
+}
+
+unsigned char* SharedMemory::getData()
+{
+    return data;
+}
+
+unsigned long long SharedMemory::getSize()
+{
+    return size;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+
+/**
+ * \brief Named shared memory region mapped read-write.
+ *
+ * The creator owns the name, close() removes it again, processes that
+ * open it by name map the same pages. A mapping stays valid in a process
+ * after the other side closed or died. Names are plain words, the system
+ * prefix is added here.
+ */
+class SharedMemory
+{
+public:
+    ~SharedMemory();
+
+    bool create(const std::string& name, unsigned long long size);
+    bool open(const std::string& name);
+    void close();
+
+    bool isOpen();
+    unsigned char* getData();
+    unsigned long long getSize();
+
+    // Drops a name left behind by a process that died before close()
+    static void remove(const std::string& name);
+
+private:
+    unsigned char* data = nullptr;
+    unsigned long long size = 0;
+    std::string systemName;
+    bool owner = false;
+
+#ifdef _WIN32
+    void* mappingHandle = nullptr;
+#endif
+};
\ No newline at end of file
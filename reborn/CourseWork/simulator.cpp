@@ -0,0 +1,63 @@
+#include "simulator.hpp"
+#include "scene.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+
+
+Simulator::Simulator(Scene& scene) : scene(scene)
+{
+    worker = std::thread(&Simulator::run, this);
+}
+
+Simulator::~Simulator()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    condition.notify_all();
+
+    worker.join();
+}
+
+void Simulator::start(float glTime)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tickTime = glTime;
+        pending = true;
+    }
+    condition.notify_all();
+}
+
+void Simulator::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this] { return !pending; });
+}
+
+void Simulator::run()
+{
+    TRACE_THREAD("simulation");
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        condition.wait(lock, [this] { return pending || !running; });
+        if (!running)
+            return;
+
+        float glTime = tickTime;
+
+        lock.unlock();
+        {
+            ProfileScope scope(Profiler::SIMULATION);
+            scene.simulate(glTime);
+        }
+        lock.lock();
+
+        pending = false;
+        condition.notify_all();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+
+class Scene;
+
+/**
+ * \brief Runs scene simulation ticks on a dedicated thread.
+ *
+ * The render thread starts tick N+1 and then draws tick N, so simulation
+ * and rendering overlap. Scene::swap() must only be called between wait()
+ * and the next start().
+ */
+class Simulator
+{
+public:
+    Simulator(Scene& scene);
+    ~Simulator();
+
+    void start(float glTime);
+    void wait();
+
+private:
+    Scene& scene;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    bool pending = false;
+    bool running = true;
+    float tickTime = 0.0f;
+
+    void run();
+};
\ No newline at end of file
@@ -1,11 +1,86 @@
 #include "sphere.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <mutex>
 
 
 const float EPSILON = 1e-4f;
 
+/**
+ * \brief Position the shader treats as a removed vertex
+ */
+const glm::vec3 DEAD_POSITION = glm::vec3(INT_MAX);
+
+/**
+ * \brief Longest face edge, the face pass kills the vertices of longer ones
+ */
+const float MAX_EDGE = 1.7f;
+
+/**
+ * \brief Waves launched so far, batch runs launch from several threads
+ */
+static std::atomic<unsigned int> launchedWaves{ 0 };
+
+/**
+ * \brief Reflected vertex tables of deleted waves kept for new ones, so a
+ * scene that keeps launching stops allocating once its tables have grown
+ */
+const unsigned int RECYCLED_TABLES = 16;
+
+static std::mutex recycledMutex;
+static std::vector<std::vector<WaveVertex>> recycledTables;
+
+/**
+ * \brief Hands out the largest recycled table that is no larger than limit
+ */
+static void takeRecycledTable(std::vector<WaveVertex>& table, size_t limit)
+{
+    std::lock_guard<std::mutex> lock(recycledMutex);
+    unsigned int i, best = recycledTables.size();
+
+    for (i = 0; i < recycledTables.size(); ++i)
+        if (recycledTables[i].capacity() <= limit &&
+            (best == recycledTables.size() || recycledTables[i].capacity() > recycledTables[best].capacity()))
+            best = i;
+
+    if (best == recycledTables.size())
+        return;
+
+    table.swap(recycledTables[best]);
+    recycledTables.erase(recycledTables.begin() + best);
+}
+
+static void recycleTable(std::vector<WaveVertex>& table)
+{
+    if (table.capacity() == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(recycledMutex);
+
+    table.clear();
+    if (recycledTables.size() < RECYCLED_TABLES)
+    {
+        recycledTables.emplace_back();
+        recycledTables.back().swap(table);
+    }
+    else
+        std::vector<WaveVertex>().swap(table);
+}
+
+Sphere::~Sphere()
+{
+    recycleTable(reflected);
+}
+
 void Sphere::Draw(Shader& shader, float& glTime, Scene& scene)
 {
-    shader.setVec4("modelColor", modelSettings.color);
+    shader.setVec4("modelColor", drawColor);
     shader.setMat4("model", modelSettings.modelMatrix);
 
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -14,13 +89,22 @@ void Sphere::Draw(Shader& shader, float& glTime, Scene& scene)
     for (i = 0; i < meshes.size(); ++i)
     {
         meshes[i].Bind();
-        updateVelocity(scene, glTime);
         meshes[i].Draw(shader);
         meshes[i].Unbind();
     }
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
+void Sphere::upload()
+{
+    TRACE_SCOPE("Sphere::upload");
+
+    unsigned int i;
+
+    for (i = 0; i < meshes.size(); ++i)
+        meshes[i].upload(positions[front], dirtyBegin[front], dirtyEnd[front] - dirtyBegin[front]);
+}
+
 void Sphere::setColor(glm::vec4& newColor)
 {
     modelSettings.color = newColor;
@@ -114,89 +198,605 @@ bool Sphere::isInsideRoom(glm::vec3& point)
 
 void Sphere::updateVelocity(Scene& scene, float& glTime)
 {
-    unsigned int i, j;
+    TRACE_SCOPE("Sphere::updateVelocity");
 
-    glm::vec3 curPos, curVel, worldPoint;
+    WaveEvents events;
 
-    std::vector<Model*> sceneObjects = scene.getObjects();
+    beginUpdate();
+    updateVertices(scene, glTime, 0, states.size(), events);
+    finishUpdate(glTime, &events, 1);
+}
+
+void Sphere::beginUpdate()
+{
+    unsigned int i, back = 1 - front;
+
+    dirtyBegin[back] = dirtyEnd[back] = 0;
+
+    // Bring kills of the previous tick into this buffer
+    for (i = 0; i < recentKills.size(); ++i)
+    {
+        positions[back][recentKills[i]] = DEAD_POSITION;
+        markDirty(recentKills[i]);
+    }
+    recentKills.clear();
+}
+
+void Sphere::updateVertices(Scene& scene, float glTime, unsigned int begin, unsigned int end, WaveEvents& events)
+{
+    TRACE_SCOPE("Sphere::updateVertices");
+
+    unsigned int i, j, k, state;
+    unsigned long long tests = 0, reflections = 0;
+    bool newlyReflected;
+
+    glm::vec3 curPos, curVel, offset, worldPoint;
+
+    const std::vector<Model*>& sceneObjects = scene.getObjects();
+    std::vector<glm::vec3>& positions = this->positions[1 - front];
+
+    events.reflectedIndices.clear();
+    events.reflectedVertices.clear();
+    events.kills.clear();
+    events.testIndices.clear();
+    events.testPoints.clear();
+    events.dirtyBegin = end;
+    events.dirtyEnd = begin;
 
-    for (i = 0; i < vertices.size(); ++i)
     {
-        curVel = vertices[i].Velocity;
-        curPos = vertices[i].Position;
-        worldPoint = curPos + curVel * glTime;
+        ProfileScope scope(Profiler::WAVE_ADVANCE);
 
-        if (!isInsideRoom(worldPoint))
+        for (i = begin; i < end; ++i)
         {
-            if (worldPoint.x < minRoomVert.x || worldPoint.x > maxRoomVert.x)
-                curVel.x = -curVel.x;
-            if (worldPoint.y < minRoomVert.y || worldPoint.y > maxRoomVert.y)
-                curVel.y = -curVel.y;
-            if (worldPoint.z < minRoomVert.z || worldPoint.z > maxRoomVert.z)
-                curVel.z = -curVel.z;
+            state = states[i];
+            if (state == DEAD)
+                continue;
+
+            if (state == DIRECT)
+            {
+                offset = shape->getOffset(i);
+                curVel = offset * speedFactor;
+                curPos = origin + offset + curVel * travel;
+            }
+            else
+            {
+                curVel = reflected[state].Velocity;
+                curPos = reflected[state].Position;
+            }
+
+            worldPoint = curPos + curVel * glTime;
+            newlyReflected = false;
+
+            if (!isInsideRoom(worldPoint))
+            {
+                ++reflections;
+
+                if (worldPoint.x < minRoomVert.x || worldPoint.x > maxRoomVert.x)
+                    curVel.x = -curVel.x;
+                if (worldPoint.y < minRoomVert.y || worldPoint.y > maxRoomVert.y)
+                    curVel.y = -curVel.y;
+                if (worldPoint.z < minRoomVert.z || worldPoint.z > maxRoomVert.z)
+                    curVel.z = -curVel.z;
+
+                // A reflected vertex leaves the shared wavefront for good, its slot is assigned on merge
+                if (state == DIRECT)
+                    newlyReflected = true;
+                else
+                    reflected[state].Velocity = curVel;
+            }
+            else
+            {
+                // Obstacles are tested in a second pass over the vertices inside the room
+                events.testIndices.push_back(i);
+                events.testPoints.push_back(worldPoint);
+            }
+
+            if (newlyReflected)
+            {
+                positions[i] = curPos + curVel * glTime;
+                events.reflectedIndices.push_back(i);
+                events.reflectedVertices.push_back({ positions[i], curVel });
+            }
+            else if (state == DIRECT)
+                positions[i] = curPos + curVel * glTime;
+            else
+                positions[i] = reflected[state].Position += curVel * glTime;
+
+            if (i < events.dirtyBegin)
+                events.dirtyBegin = i;
+            events.dirtyEnd = i + 1;
         }
-        else
-            for (j = 0; j < sceneObjects.size(); ++j)
+    }
+
+    ProfileScope scope(Profiler::OBSTACLE_TESTS);
+    MetricSlot& metrics = Metrics::get().localSlot();
+
+    for (k = 0; k < events.testIndices.size(); ++k)
+    {
+        i = events.testIndices[k];
+        worldPoint = events.testPoints[k];
+
+        for (j = 0; j < sceneObjects.size(); ++j)
+        {
+            ++tests;
+
+            std::vector<Vertex>& objVertices = sceneObjects[j]->getVertices();
+            std::vector<Face>& objFaces = sceneObjects[j]->getFaces();
+
+            glm::vec3 pointToVertex0 = worldPoint - objVertices[objFaces[0].Triangles.first.z].Position;
+            glm::vec3 pointToVertex1 = worldPoint - objVertices[objFaces[1].Triangles.first.z].Position;
+            glm::vec3 pointToVertex2 = worldPoint - objVertices[objFaces[2].Triangles.first.z].Position;
+            glm::vec3 pointToVertex3 = worldPoint - objVertices[objFaces[3].Triangles.first.z].Position;
+            glm::vec3 pointToVertex4 = worldPoint - objVertices[objFaces[4].Triangles.first.z].Position;
+            glm::vec3 pointToVertex5 = worldPoint - objVertices[objFaces[5].Triangles.first.z].Position;
+
+            float pointPlane0 = glm::dot(pointToVertex0, objFaces[0].Normal);
+            float pointPlane1 = glm::dot(pointToVertex1, objFaces[1].Normal);
+            float pointPlane2 = glm::dot(pointToVertex2, objFaces[2].Normal);
+            float pointPlane3 = glm::dot(pointToVertex3, objFaces[3].Normal);
+            float pointPlane4 = glm::dot(pointToVertex4, objFaces[4].Normal);
+            float pointPlane5 = glm::dot(pointToVertex5, objFaces[5].Normal);
+
+            if (pointPlane0 < 0 && pointPlane1 < 0 && pointPlane2 < 0 && pointPlane3 < 0 && pointPlane4 < 0 && pointPlane5 < 0)
             {
-                std::vector<Vertex>& objVertices = sceneObjects[j]->getVertices();
-                std::vector<Face>& objFaces = sceneObjects[j]->getFaces();
-
-                glm::vec3 pointToVertex0 = worldPoint - objVertices[objFaces[0].Triangles.first.z].Position;
-                glm::vec3 pointToVertex1 = worldPoint - objVertices[objFaces[1].Triangles.first.z].Position;
-                glm::vec3 pointToVertex2 = worldPoint - objVertices[objFaces[2].Triangles.first.z].Position;
-                glm::vec3 pointToVertex3 = worldPoint - objVertices[objFaces[3].Triangles.first.z].Position;
-                glm::vec3 pointToVertex4 = worldPoint - objVertices[objFaces[4].Triangles.first.z].Position;
-                glm::vec3 pointToVertex5 = worldPoint - objVertices[objFaces[5].Triangles.first.z].Position;
-
-                float pointPlane0 = glm::dot(pointToVertex0, objFaces[0].Normal);
-                float pointPlane1 = glm::dot(pointToVertex1, objFaces[1].Normal);
-                float pointPlane2 = glm::dot(pointToVertex2, objFaces[2].Normal);
-                float pointPlane3 = glm::dot(pointToVertex3, objFaces[3].Normal);
-                float pointPlane4 = glm::dot(pointToVertex4, objFaces[4].Normal);
-                float pointPlane5 = glm::dot(pointToVertex5, objFaces[5].Normal);
-
-                if (pointPlane0 < 0 && pointPlane1 < 0 && pointPlane2 < 0 && pointPlane3 < 0 && pointPlane4 < 0 && pointPlane5 < 0)
-                {
-                    vertices[i].Position = glm::vec3(INT_MAX);
-                    curVel = glm::vec3(0.0f);
-                    break;
-                }
+                states[i] = DEAD;
+                positions[i] = DEAD_POSITION;
+                events.kills.push_back(i);
+                metrics.addHits(j, 1);
+                break;
             }
+        }
+    }
+
+    metrics.counters.vertexObstacleTests += tests;
+    metrics.counters.roomReflections += reflections;
+}
+
+void Sphere::finishUpdate(float glTime, const WaveEvents* events, unsigned int count)
+{
+    unsigned int i, j;
+    std::vector<glm::vec3>& positions = this->positions[1 - front];
 
-        vertices[i].Velocity = curVel;
-        vertices[i].Position += curVel * glTime;
+    // A wave that never reflects keeps no table, one that does grows it by doubling up to one entry per vertex
+    size_t incoming = 0;
+    for (i = 0; i < count; ++i)
+        incoming += events[i].reflectedIndices.size();
+    if (reflected.size() + incoming > reflected.capacity())
+    {
+        if (reflected.capacity() == 0)
+            takeRecycledTable(reflected, states.size());
+        if (reflected.size() + incoming > reflected.capacity())
+            reflected.reserve(std::min<size_t>(states.size(), std::max(reflected.size() + incoming, reflected.capacity() * 2)));
     }
 
-    for (const auto& face : faces)
+    for (i = 0; i < count; ++i)
     {
-        float factor = 1.7;
-        if (
-            glm::distance(vertices[face.Triangles.first.x].Position, vertices[face.Triangles.first.y].Position) > factor ||
-            glm::distance(vertices[face.Triangles.first.x].Position, vertices[face.Triangles.first.z].Position) > factor ||
-            glm::distance(vertices[face.Triangles.first.y].Position, vertices[face.Triangles.first.z].Position) > factor
-            )
+        for (j = 0; j < events[i].reflectedIndices.size(); ++j)
         {
-            vertices[face.Triangles.first.x].Position = glm::vec3(INT_MAX);
-            vertices[face.Triangles.first.y].Position = glm::vec3(INT_MAX);
-            vertices[face.Triangles.first.z].Position = glm::vec3(INT_MAX);
+            states[events[i].reflectedIndices[j]] = reflected.size();
+            reflected.push_back(events[i].reflectedVertices[j]);
         }
+
+        recentKills.insert(recentKills.end(), events[i].kills.begin(), events[i].kills.end());
+        deadCount += events[i].kills.size();
+
+        if (events[i].dirtyBegin < events[i].dirtyEnd)
+        {
+            markDirty(events[i].dirtyBegin);
+            markDirty(events[i].dirtyEnd - 1);
+        }
+    }
+
+    travel += glTime;
+
+    float factor = MAX_EDGE;
+
+    ProfileScope scope(Profiler::FACE_PASS);
+    TRACE_SCOPE("face pass");
+    unsigned long long trianglesKilled = 0;
+
+    for (const auto& triangle : shape->triangles)
         if (
-            glm::distance(vertices[face.Triangles.second.x].Position, vertices[face.Triangles.second.y].Position) > factor ||
-            glm::distance(vertices[face.Triangles.second.x].Position, vertices[face.Triangles.second.z].Position) > factor ||
-            glm::distance(vertices[face.Triangles.second.y].Position, vertices[face.Triangles.second.z].Position) > factor
+            glm::distance(positions[triangle.x], positions[triangle.y]) > factor ||
+            glm::distance(positions[triangle.x], positions[triangle.z]) > factor ||
+            glm::distance(positions[triangle.y], positions[triangle.z]) > factor
             )
         {
-            vertices[face.Triangles.second.x].Position = glm::vec3(INT_MAX);
-            vertices[face.Triangles.second.y].Position = glm::vec3(INT_MAX);
-            vertices[face.Triangles.second.z].Position = glm::vec3(INT_MAX);
+            killVertex(triangle.x);
+            killVertex(triangle.y);
+            killVertex(triangle.z);
+            ++trianglesKilled;
         }
-    }
+
+    Metrics::get().localSlot().counters.trianglesKilled += trianglesKilled;
 
     modelSettings.color.w /= pow(1.01, modelSettings.speed / 1000);
+}
+
+unsigned int Sphere::getVertexCount()
+{
+    return states.size();
+}
+
+unsigned int Sphere::getTriangleCount()
+{
+    return shape->triangles.size();
+}
+
+unsigned int Sphere::getLiveVertexCount()
+{
+    return states.size() - deadCount;
+}
+
+unsigned int Sphere::getDeadVertexCount()
+{
+    return deadCount;
+}
+
+size_t Sphere::getMemoryUsage()
+{
+    return sizeof(Sphere) +
+        states.capacity() * sizeof(unsigned int) +
+        reflected.capacity() * sizeof(WaveVertex) +
+        (positions[0].capacity() + positions[1].capacity()) * sizeof(glm::vec3) +
+        recentKills.capacity() * sizeof(unsigned int);
+}
+
+unsigned long long Sphere::getStateHash(unsigned long long seed)
+{
+    // Hashes what a tick produced, independent of the order reflected slots were assigned in
+    unsigned long long hash = seed;
+    const std::vector<glm::vec3>& positions = this->positions[1 - front];
+    unsigned int i;
+
+    auto mix = [&hash](const void* data, size_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t k = 0; k < size; ++k)
+            hash = (hash ^ bytes[k]) * 1099511628211ULL;
+    };
+
+    mix(&travel, sizeof(travel));
+    mix(&modelSettings.color.w, sizeof(modelSettings.color.w));
+
+    for (i = 0; i < states.size(); ++i)
+    {
+        unsigned char kind = states[i] == DEAD ? 0 : states[i] == DIRECT ? 1 : 2;
 
-    Vertex* pData = (Vertex*)glMapBuffer(GL_ARRAY_BUFFER, GL_READ_WRITE);
+        mix(&kind, sizeof(kind));
+        mix(&positions[i], sizeof(glm::vec3));
+        if (kind == 2)
+            mix(&reflected[states[i]].Velocity, sizeof(glm::vec3));
+    }
 
-    memcpy(pData, &vertices[0], vertices.size() * sizeof(Vertex));
+    return hash;
+}
 
-    glUnmapBuffer(GL_ARRAY_BUFFER);
+unsigned int Sphere::getWaveId()
+{
+    return waveId;
+}
+
+const std::vector<glm::vec3>& Sphere::getPositions()
+{
+    return positions[front];
+}
+
+const glm::vec4& Sphere::getDrawColor()
+{
+    return drawColor;
+}
+
+void Sphere::saveState(WaveCheckpoint& checkpoint)
+{
+    unsigned int i;
+
+    checkpoint.travel = travel;
+    checkpoint.color = modelSettings.color;
+    checkpoint.deadBits.assign((states.size() + 31) / 32, 0);
+    checkpoint.reflectedIndices.clear();
+    checkpoint.reflectedVertices.clear();
+
+    for (i = 0; i < states.size(); ++i)
+        if (states[i] == DEAD)
+            checkpoint.deadBits[i / 32] |= 1u << (i % 32);
+        else if (states[i] != DIRECT)
+        {
+            checkpoint.reflectedIndices.push_back(i);
+            checkpoint.reflectedVertices.push_back(reflected[states[i]]);
+        }
+}
+
+/**
+ * \brief Returns the wave to a saved state, both position buffers are rebuilt
+ */
+void Sphere::restoreState(const WaveCheckpoint& checkpoint)
+{
+    unsigned int i;
+
+    travel = checkpoint.travel;
+    modelSettings.color = checkpoint.color;
+
+    states.assign(shape->size(), (unsigned int)DIRECT);
+    deadCount = 0;
+    for (i = 0; i < states.size(); ++i)
+        if (checkpoint.deadBits[i / 32] & (1u << (i % 32)))
+        {
+            states[i] = DEAD;
+            ++deadCount;
+        }
+
+    reflected.clear();
+    if (reflected.capacity() == 0)
+        takeRecycledTable(reflected, states.size());
+    reflected.reserve(checkpoint.reflectedIndices.size());
+    for (i = 0; i < checkpoint.reflectedIndices.size(); ++i)
+    {
+        states[checkpoint.reflectedIndices[i]] = reflected.size();
+        reflected.push_back(checkpoint.reflectedVertices[i]);
+    }
+
+    recentKills.clear();
+    writePositions(travel, 0.0f);
+    drawColor = modelSettings.color;
+}
+
+/**
+ * \brief Frees the vertex state of a wave that left the scene, restoreState() brings it back
+ */
+void Sphere::releaseState()
+{
+    std::vector<unsigned int>().swap(states);
+    recycleTable(reflected);
+    std::vector<glm::vec3>().swap(positions[0]);
+    std::vector<glm::vec3>().swap(positions[1]);
+    std::vector<unsigned int>().swap(recentKills);
+    deadCount = 0;
+}
+
+/**
+ * \brief Travel, in the units of the summed tick times, the wave covers before
+ * a vertex can leave the room, enter an obstacle or stretch a face past MAX_EDGE.
+ * Every live vertex moves on a straight line until then. The line buffers are
+ * the caller's scratch, they only grow
+ */
+float Sphere::getEventFreeTravel(Scene& scene, std::vector<glm::vec3>& linePositions, std::vector<glm::vec3>& lineVelocities)
+{
+    TRACE_SCOPE("Sphere::getEventFreeTravel");
+
+    const std::vector<Model*>& sceneObjects = scene.getObjects();
+    float limit = FLT_MAX;
+    unsigned int i, j, k, axis;
+
+    if (linePositions.size() < states.size())
+    {
+        linePositions.resize(states.size());
+        lineVelocities.resize(states.size());
+    }
+
+    for (i = 0; i < states.size(); ++i)
+    {
+        unsigned int state = states[i];
+        if (state == DEAD)
+            continue;
+
+        glm::vec3 position, velocity;
+        if (state == DIRECT)
+        {
+            glm::vec3 offset = shape->getOffset(i);
+            velocity = offset * speedFactor;
+            position = origin + offset + velocity * travel;
+        }
+        else
+        {
+            velocity = reflected[state].Velocity;
+            position = reflected[state].Position;
+        }
+        linePositions[i] = position;
+        lineVelocities[i] = velocity;
+
+        for (axis = 0; axis < 3; ++axis)
+            if (velocity[axis] > 0.0f)
+                limit = std::min(limit, (maxRoomVert[axis] - position[axis]) / velocity[axis]);
+            else if (velocity[axis] < 0.0f)
+                limit = std::min(limit, (minRoomVert[axis] - position[axis]) / velocity[axis]);
+
+        // Obstacles are convex, the line is inside between the last plane it enters and the first it leaves
+        for (j = 0; j < sceneObjects.size(); ++j)
+        {
+            std::vector<Vertex>& objVertices = sceneObjects[j]->getVertices();
+            std::vector<Face>& objFaces = sceneObjects[j]->getFaces();
+            float enter = -FLT_MAX, leave = FLT_MAX;
+            bool outside = false;
+
+            for (k = 0; k < 6 && !outside; ++k)
+            {
+                float distance = glm::dot(position - objVertices[objFaces[k].Triangles.first.z].Position, objFaces[k].Normal);
+                float rate = glm::dot(velocity, objFaces[k].Normal);
+
+                if (rate < 0.0f)
+                    enter = std::max(enter, -distance / rate);
+                else if (rate > 0.0f)
+                    leave = std::min(leave, -distance / rate);
+                else if (distance >= 0.0f)
+                    outside = true;
+            }
+
+            if (!outside && enter < leave && leave > 0.0f)
+                limit = std::min(limit, std::max(enter, 0.0f));
+        }
+    }
+
+    // Edges grow or shrink linearly, a face touching a dead vertex is killed by the next face pass
+    for (const auto& triangle : shape->triangles)
+    {
+        unsigned int corners[3] = { triangle.x, triangle.y, triangle.z };
+        unsigned int dead = 0;
+
+        for (k = 0; k < 3; ++k)
+            if (states[corners[k]] == DEAD)
+                ++dead;
+
+        if (dead == 3)
+            continue;
+        if (dead > 0)
+            return 0.0f;
+
+        for (k = 0; k < 3; ++k)
+        {
+            glm::vec3 distance = linePositions[corners[k]] - linePositions[corners[(k + 1) % 3]];
+            glm::vec3 rate = lineVelocities[corners[k]] - lineVelocities[corners[(k + 1) % 3]];
+            float a = glm::dot(rate, rate), b = glm::dot(distance, rate);
+            float c = glm::dot(distance, distance) - MAX_EDGE * MAX_EDGE;
+
+            if (c >= 0.0f)
+                return 0.0f;
+            if (a > 0.0f)
+                limit = std::min(limit, (-b + std::sqrt(b * b - a * c)) / a);
+        }
+    }
+
+    return limit;
+}
+
+/**
+ * \brief Ticks the wave advances before its alpha drops below threshold, at most count
+ */
+unsigned int Sphere::getFadeTicks(float threshold, unsigned int count)
+{
+    float alpha = modelSettings.color.w;
+    unsigned int ticks;
+
+    for (ticks = 0; ticks < count; ++ticks)
+    {
+        alpha /= pow(1.01, modelSettings.speed / 1000);
+        if (alpha < threshold)
+            break;
+    }
+
+    return ticks;
+}
+
+/**
+ * \brief Runs count ticks in one step, valid while their summed times stay
+ * below getEventFreeTravel(). Unreflected vertices end where the ticks would
+ * put them, reflected ones up to float rounding
+ */
+void Sphere::advance(const float* steps, unsigned int count)
+{
+    float previousTravel = travel, total = 0.0f;
+    unsigned int i;
+
+    for (i = 0; i < count; ++i)
+    {
+        previousTravel = travel;
+        travel += steps[i];
+        total += steps[i];
+        modelSettings.color.w /= pow(1.01, modelSettings.speed / 1000);
+    }
+
+    for (auto& vertex : reflected)
+        vertex.Position += vertex.Velocity * total;
+
+    recentKills.clear();
+    writePositions(previousTravel, count ? steps[count - 1] : 0.0f);
+}
+
+void Sphere::swapBuffers()
+{
+    front = 1 - front;
+    drawColor = modelSettings.color;
+}
+
+void Sphere::initWave(Model& sphere)
+{
+    std::vector<Vertex>& sourceVertices = sphere.getVertices();
+    unsigned int i;
+
+    waveId = ++launchedWaves;
+
+    // Waves are only ever placed by translation
+    origin = glm::vec3(modelSettings.modelMatrix[3]);
+    speedFactor = modelSettings.speed / 2000;
+    travel = 0.0f;
+
+    shape = WaveShape::acquire(sourceVertices, sphere.getFaces(), origin);
+
+    states.assign(sourceVertices.size(), (unsigned int)DIRECT);
+    deadCount = 0;
+
+    recycleTable(reflected);
+
+    positions[0].resize(sourceVertices.size());
+    for (i = 0; i < sourceVertices.size(); ++i)
+        positions[0][i] = sourceVertices[i].Position;
+    positions[1] = positions[0];
+
+    front = 0;
+    dirtyBegin[0] = dirtyEnd[0] = dirtyBegin[1] = dirtyEnd[1] = 0;
+    recentKills.clear();
+    drawColor = modelSettings.color;
+}
+
+void Sphere::killVertex(unsigned int index)
+{
+    if (states[index] == DEAD)
+        return;
+
+    states[index] = DEAD;
+    ++deadCount;
+    positions[1 - front][index] = DEAD_POSITION;
+    recentKills.push_back(index);
+    markDirty(index);
+}
+
+/**
+ * \brief Fills both position buffers from the vertex state, an unreflected
+ * vertex is placed the way the last tick of step after previousTravel does
+ */
+void Sphere::writePositions(float previousTravel, float step)
+{
+    unsigned int i, buffer;
+
+    positions[0].resize(states.size());
+    positions[1].resize(states.size());
+
+    for (i = 0; i < states.size(); ++i)
+    {
+        glm::vec3 position;
+
+        if (states[i] == DEAD)
+            position = DEAD_POSITION;
+        else if (states[i] == DIRECT)
+        {
+            glm::vec3 offset = shape->getOffset(i);
+            glm::vec3 velocity = offset * speedFactor;
+            position = origin + offset + velocity * previousTravel + velocity * step;
+        }
+        else
+            position = reflected[states[i]].Position;
+
+        positions[0][i] = positions[1][i] = position;
+    }
+
+    for (buffer = 0; buffer < 2; ++buffer)
+    {
+        dirtyBegin[buffer] = 0;
+        dirtyEnd[buffer] = states.size();
+    }
+}
+
+void Sphere::markDirty(unsigned int index)
+{
+    unsigned int back = 1 - front;
+
+    if (dirtyBegin[back] == dirtyEnd[back])
+    {
+        dirtyBegin[back] = index;
+        dirtyEnd[back] = index + 1;
+    }
+    else if (index < dirtyBegin[back])
+        dirtyBegin[back] = index;
+    else if (index >= dirtyEnd[back])
+        dirtyEnd[back] = index + 1;
 }
\ No newline at end of file
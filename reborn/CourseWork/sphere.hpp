@@ -4,6 +4,7 @@
 #include "model.hpp"
 #include "shader.hpp"
 #include "mesh.hpp"
+#include "wavefront.hpp"
 
 
 class Sphere : public Model
@@ -24,6 +25,10 @@ public:
         modelSettings.lightingEnable = lightingEnable;
         modelSettings.speed = speed;
     };
+    /**
+     * \brief Launch a wave from a loaded source sphere.
+     * The wave keeps only its compact state, the source keeps the geometry.
+     */
     Sphere(Model& sphere)
     {
         this->modelSettings.modelMatrix = sphere.getModelMatrix();
@@ -31,24 +36,20 @@ public:
         this->modelSettings.lightingEnable = false;
         this->modelSettings.speed = sphere.getSpeed();
 
-        for (auto& index : sphere.getIndices())
-            this->indices.push_back(index);
-
-        for (auto& vertex : sphere.getVertices())
-            this->vertices.push_back(vertex);
-
-        for (auto& face : sphere.getFaces())
-            this->faces.push_back(face);
-
+        // The source keeps its own GL objects, every wave gets new ones
+        this->meshes.reserve(sphere.getMeshes().size());
         for (auto& mesh : sphere.getMeshes())
         {
-            mesh.setupMesh(*this);
             this->meshes.push_back(mesh);
+            this->meshes.back().setupMesh(sphere, StreamBuffer::SEGMENTS);
         }
+
+        initWave(sphere);
     }
-    ~Sphere() = default;
+    ~Sphere();
 
     void Draw(Shader& shader, float& glTime, Scene& scene);
+    void upload();
 
     void setColor(glm::vec4& newColor);
     void setModelMatrix(glm::mat4& modelMatrix);
@@ -71,4 +72,69 @@ public:
 
     bool isInsideRoom(glm::vec3& point);
     void updateVelocity(Scene& scene, float& glTime);
+    void swapBuffers();
+
+    // Chunked update: begin, any number of vertex chunks in parallel, finish with their events in order
+    void beginUpdate();
+    void updateVertices(Scene& scene, float glTime, unsigned int begin, unsigned int end, WaveEvents& events);
+    void finishUpdate(float glTime, const WaveEvents* events, unsigned int count);
+
+    unsigned int getVertexCount();
+    unsigned int getTriangleCount();
+    unsigned int getLiveVertexCount();
+    unsigned int getDeadVertexCount();
+    // Host memory of the wave's own state, the shared shape and the GL buffers are not counted
+    size_t getMemoryUsage();
+    unsigned long long getStateHash(unsigned long long seed);
+
+    // Drawn state, read by the render thread between swaps
+    unsigned int getWaveId();
+    const std::vector<glm::vec3>& getPositions();
+    const glm::vec4& getDrawColor();
+
+    // Checkpoints and analytic steps, only while the simulation is idle
+    void saveState(WaveCheckpoint& checkpoint);
+    void restoreState(const WaveCheckpoint& checkpoint);
+    void releaseState();
+    float getEventFreeTravel(Scene& scene, std::vector<glm::vec3>& linePositions, std::vector<glm::vec3>& lineVelocities);
+    unsigned int getFadeTicks(float threshold, unsigned int count);
+    void advance(const float* steps, unsigned int count);
+
+private:
+    /**
+     * \brief Vertex state: moving straight from the source, dead, or an index into reflected
+     */
+    static const unsigned int DIRECT = 0xFFFFFFFF;
+    static const unsigned int DEAD = 0xFFFFFFFE;
+
+    // Wave state, the id is unique over every launched wave
+    unsigned int waveId = 0;
+    std::shared_ptr<const WaveShape> shape;
+    glm::vec3 origin;
+    float speedFactor = 0.0f;
+    float travel = 0.0f;
+
+    std::vector<unsigned int> states;
+    unsigned int deadCount = 0;
+    // Grows with the reflections, starts from the table of a deleted wave when one is recycled
+    std::vector<WaveVertex> reflected;
+
+    // Decoded world positions, the simulation writes the back buffer while the front one is drawn
+    std::vector<glm::vec3> positions[2];
+    unsigned int front = 0;
+
+    // Vertex range of each buffer changed by its last update
+    unsigned int dirtyBegin[2] = { 0, 0 };
+    unsigned int dirtyEnd[2] = { 0, 0 };
+
+    // Vertices killed by the last update, still alive in the other buffer
+    std::vector<unsigned int> recentKills;
+
+    // Color of the front buffer
+    glm::vec4 drawColor;
+
+    void initWave(Model& sphere);
+    void killVertex(unsigned int index);
+    void markDirty(unsigned int index);
+    void writePositions(float previousTravel, float step);
 };
\ No newline at end of file
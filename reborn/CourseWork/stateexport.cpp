@@ -0,0 +1,156 @@
+#include "stateexport.hpp"
+#include "sphere.hpp"
+#include "trace.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+
+static const unsigned int EXPORT_MAGIC = 0x54535743;   // "CWST"
+static const unsigned int EXPORT_VERSION = 1;
+
+// The documented offsets are part of the format
+static_assert(offsetof(StateExportHeader, sequence) == 64, "state export header layout");
+static_assert(offsetof(StateExportHeader, tickCounters) == 112, "state export header layout");
+static_assert(sizeof(StateExportHeader) == 176, "state export header layout");
+static_assert(sizeof(StateExportWave) == 32, "state export wave layout");
+static_assert(sizeof(glm::vec3) == 12, "state export position layout");
+
+static unsigned long long alignSection(unsigned long long offset)
+{
+    return (offset + 63) & ~63ull;
+}
+
+/**
+ * \brief Creates the segment, a stale one of the same name is replaced
+ */
+bool StateExporter::open(const std::string& name, unsigned int vertexCapacity,
+    unsigned int waveCapacity, unsigned int objectCapacity)
+{
+    close();
+
+    unsigned long long wavesOffset = alignSection(sizeof(StateExportHeader));
+    unsigned long long positionsOffset = alignSection(wavesOffset + (unsigned long long)waveCapacity * sizeof(StateExportWave));
+    unsigned long long aliveOffset = alignSection(positionsOffset + (unsigned long long)vertexCapacity * sizeof(glm::vec3));
+    unsigned long long hitsOffset = alignSection(aliveOffset + vertexCapacity);
+    unsigned long long segmentSize = alignSection(hitsOffset + (unsigned long long)objectCapacity * sizeof(unsigned long long));
+
+    SharedMemory::remove(name);
+    if (!memory.create(name, segmentSize))
+        return false;
+
+    unsigned char* data = memory.getData();
+    memset(data, 0, sizeof(StateExportHeader));
+
+    header = new (data) StateExportHeader();
+    header->magic = EXPORT_MAGIC;
+    header->version = EXPORT_VERSION;
+    header->headerSize = sizeof(StateExportHeader);
+    header->waveCapacity = waveCapacity;
+    header->vertexCapacity = vertexCapacity;
+    header->objectCapacity = objectCapacity;
+    header->segmentSize = segmentSize;
+    header->wavesOffset = wavesOffset;
+    header->positionsOffset = positionsOffset;
+    header->aliveOffset = aliveOffset;
+    header->hitsOffset = hitsOffset;
+    header->sequence.store(0, std::memory_order_release);
+
+    waves = (StateExportWave*)(data + wavesOffset);
+    positions = (glm::vec3*)(data + positionsOffset);
+    alive = data + aliveOffset;
+    hits = (unsigned long long*)(data + hitsOffset);
+
+    std::cout << "Exporting simulation state to shared memory " << name << ", " << (segmentSize >> 20) << " MiB" << std::endl;
+
+    return true;
+}
+
+bool StateExporter::isOpen()
+{
+    return header != nullptr;
+}
+
+/**
+ * \brief Writes a published snapshot under the seqlock, the positions are the drawn front buffers
+ */
+void StateExporter::publish(const SceneSnapshot& snapshot)
+{
+    TRACE_SCOPE("StateExporter::publish");
+
+    if (!header)
+        return;
+
+    unsigned int waveCount = 0;
+    unsigned int vertexCount = 0;
+    unsigned int droppedWaves = 0;
+    unsigned long long liveVertices = 0;
+    unsigned int i, j;
+
+    unsigned long long sequence = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (i = 0; i < snapshot.spheres.size(); ++i)
+    {
+        Sphere* sphere = static_cast<Sphere*>(snapshot.spheres[i]);
+        const std::vector<glm::vec3>& spherePositions = sphere->getPositions();
+        unsigned int count = spherePositions.size();
+
+        if (waveCount == header->waveCapacity || count > header->vertexCapacity - vertexCount)
+        {
+            ++droppedWaves;
+            continue;
+        }
+
+        StateExportWave& wave = waves[waveCount++];
+        wave.id = sphere->getWaveId();
+        wave.first = vertexCount;
+        wave.vertexCount = count;
+        wave.liveVertices = snapshot.sphereLive[i];
+        wave.color = sphere->getDrawColor();
+
+        if (count > 0)
+            memcpy(&positions[vertexCount], &spherePositions[0], count * sizeof(glm::vec3));
+
+        // Dead vertices sit at INT_MAX
+        for (j = 0; j < count; ++j)
+            alive[vertexCount + j] = spherePositions[j].x < 1e9f;
+
+        vertexCount += count;
+        liveVertices += wave.liveVertices;
+    }
+
+    unsigned int objectCount = snapshot.objectHits.size() < header->objectCapacity ?
+        (unsigned int)snapshot.objectHits.size() : header->objectCapacity;
+    if (objectCount > 0)
+        memcpy(hits, &snapshot.objectHits[0], objectCount * sizeof(unsigned long long));
+
+    header->tick = snapshot.tick;
+    header->stateHash = snapshot.stateHash;
+    header->liveVertices = liveVertices;
+    header->waveCount = waveCount;
+    header->vertexCount = vertexCount;
+    header->objectCount = objectCount;
+    header->droppedWaves = droppedWaves;
+    header->tickCounters = snapshot.tickCounters;
+    header->totalCounters = snapshot.totalCounters;
+
+    header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+/**
+ * \brief Removes the segment, readers keep their mapping until they unmap it
+ */
+void StateExporter::close()
+{
+    memory.close();
+
+    header = nullptr;
+    waves = nullptr;
+    positions = nullptr;
+    alive = nullptr;
+    hits = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "scene.hpp"
+#include "metrics.hpp"
+#include "sharedmemory.hpp"
+
+#include <atomic>
+#include <string>
+
+
+/**
+ * \brief Layout of the exported simulation state, native byte order.
+ *
+ * On Linux the segment is /dev/shm/<name>, a reader maps it read-only and
+ * views the arrays in place, e.g. numpy.memmap with mode 'r'. The header
+ * below comes first with the byte offsets given in the comments, then at
+ * 64 byte aligned offsets taken from the header:
+ *   waves      StateExportWave[waveCapacity], 32 bytes each
+ *   positions  float32[vertexCapacity][3], world space
+ *   alive      uint8[vertexCapacity], 0 for a dead vertex
+ *   hits       uint64[objectCapacity], vertices absorbed by every obstacle
+ * The vertices of wave i are positions[first, first + vertexCount), only
+ * the first waveCount waves, vertexCount vertices and objectCount obstacles
+ * are valid. A dead vertex keeps a meaningless position.
+ *
+ * Everything from the tick on is written under a seqlock: the sequence is
+ * odd while a tick is written and grows by two with every tick. A reader
+ * reads the sequence, retries while it is odd, copies what it needs and
+ * keeps the copy only if the sequence did not change meanwhile. Fields up
+ * to the sequence never change, a reader checks magic and version first.
+ */
+struct StateExportHeader
+{
+    unsigned int magic;                     // 0
+    unsigned int version;                   // 4
+    unsigned int headerSize;                // 8
+    unsigned int waveCapacity;              // 12
+    unsigned int vertexCapacity;            // 16
+    unsigned int objectCapacity;            // 20
+    unsigned long long segmentSize;         // 24
+    unsigned long long wavesOffset;         // 32
+    unsigned long long positionsOffset;     // 40
+    unsigned long long aliveOffset;         // 48
+    unsigned long long hitsOffset;          // 56
+
+    std::atomic<unsigned long long> sequence;   // 64
+
+    unsigned long long tick;                // 72
+    unsigned long long stateHash;           // 80
+    unsigned long long liveVertices;        // 88
+    unsigned int waveCount;                 // 96
+    unsigned int vertexCount;               // 100
+    unsigned int objectCount;               // 104
+    // Waves of the tick left out because a capacity was reached
+    unsigned int droppedWaves;              // 108
+
+    // vertexObstacleTests, roomReflections, trianglesKilled, spheresRetired
+    SimulationCounters tickCounters;        // 112
+    SimulationCounters totalCounters;       // 144
+};
+
+struct StateExportWave
+{
+    unsigned int id;
+    unsigned int first;
+    unsigned int vertexCount;
+    unsigned int liveVertices;
+    glm::vec4 color;
+};
+
+/**
+ * \brief Publishes every tick's snapshot into a named shared memory segment.
+ * Capacities are fixed at open(), the segment never moves under a reader.
+ * Runs while the simulation is idle and allocates nothing per tick
+ */
+class StateExporter
+{
+public:
+    bool open(const std::string& name, unsigned int vertexCapacity,
+        unsigned int waveCapacity = 1024, unsigned int objectCapacity = 256);
+    bool isOpen();
+    void publish(const SceneSnapshot& snapshot);
+    void close();
+
+private:
+    SharedMemory memory;
+    StateExportHeader* header = nullptr;
+    StateExportWave* waves = nullptr;
+    glm::vec3* positions = nullptr;
+    unsigned char* alive = nullptr;
+    unsigned long long* hits = nullptr;
+};
\ No newline at end of file
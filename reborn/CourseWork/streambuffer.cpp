@@ -0,0 +1,140 @@
+#include "streambuffer.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+
+#include <cstring>
+
+
+const GLuint64 FENCE_TIMEOUT = 1000000; // 1 ms
+
+void StreamBuffer::create(const void* data, unsigned int stride, unsigned int elementSize, unsigned int elementCount, unsigned int segments)
+{
+    this->elementSize = elementSize;
+    this->elementCount = elementCount;
+    this->current = 0;
+    this->segments.assign(segments, Segment{ 0, 0, 0 });
+
+    GLsizeiptr segmentSize = (GLsizeiptr)elementSize * elementCount;
+
+    glGenBuffers(1, &bufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, bufferID);
+    glBufferData(GL_ARRAY_BUFFER, segmentSize * segments, NULL, segments > 1 ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+
+    unsigned int i;
+
+    for (i = 0; i < segments; ++i)
+        writeElements(i, data, stride, 0, elementCount);
+}
+
+void StreamBuffer::upload(const void* data, unsigned int stride, unsigned int first, unsigned int count)
+{
+    unsigned int i;
+
+    // Every segment has to catch up with this change before it is drawn again
+    if (count > 0)
+        for (i = 0; i < segments.size(); ++i)
+        {
+            Segment& segment = segments[i];
+
+            if (segment.dirtyBegin == segment.dirtyEnd)
+            {
+                segment.dirtyBegin = first;
+                segment.dirtyEnd = first + count;
+            }
+            else
+            {
+                segment.dirtyBegin = first < segment.dirtyBegin ? first : segment.dirtyBegin;
+                segment.dirtyEnd = first + count > segment.dirtyEnd ? first + count : segment.dirtyEnd;
+            }
+        }
+
+    current = (current + 1) % segments.size();
+
+    Segment& segment = segments[current];
+    if (segment.dirtyBegin == segment.dirtyEnd)
+        return;
+
+    waitFence(segment);
+    writeElements(current, data, stride, segment.dirtyBegin, segment.dirtyEnd - segment.dirtyBegin);
+
+    segment.dirtyBegin = segment.dirtyEnd = 0;
+}
+
+void StreamBuffer::fence()
+{
+    if (segments.size() < 2)
+        return;
+
+    Segment& segment = segments[current];
+
+    if (segment.fence)
+        glDeleteSync(segment.fence);
+    segment.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamBuffer::release()
+{
+    for (auto& segment : segments)
+        if (segment.fence)
+        {
+            glDeleteSync(segment.fence);
+            segment.fence = 0;
+        }
+
+    glDeleteBuffers(1, &bufferID);
+    bufferID = 0;
+}
+
+unsigned int StreamBuffer::getID()
+{
+    return bufferID;
+}
+
+GLintptr StreamBuffer::getOffset()
+{
+    return (GLintptr)current * elementCount * elementSize;
+}
+
+void StreamBuffer::writeElements(unsigned int segment, const void* data, unsigned int stride, unsigned int first, unsigned int count)
+{
+    TRACE_SCOPE("StreamBuffer::writeElements");
+
+    GLintptr offset = ((GLintptr)segment * elementCount + first) * elementSize;
+    GLsizeiptr length = (GLsizeiptr)count * elementSize;
+
+    glBindBuffer(GL_ARRAY_BUFFER, bufferID);
+    char* pData = (char*)glMapBufferRange(GL_ARRAY_BUFFER, offset, length,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+
+    if (!pData)
+        return;
+
+    const char* pSource = (const char*)data + (size_t)first * stride;
+    unsigned int i;
+
+    if (stride == elementSize)
+        memcpy(pData, pSource, length);
+    else
+        for (i = 0; i < count; ++i)
+            memcpy(pData + (size_t)i * elementSize, pSource + (size_t)i * stride, elementSize);
+
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    Metrics::get().addUploadBytes(length);
+}
+
+void StreamBuffer::waitFence(Segment& segment)
+{
+    if (!segment.fence)
+        return;
+
+    TRACE_SCOPE("StreamBuffer::waitFence");
+
+    GLenum result = glClientWaitSync(segment.fence, 0, 0);
+
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(segment.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+
+    glDeleteSync(segment.fence);
+    segment.fence = 0;
+}
\ No newline at end of file
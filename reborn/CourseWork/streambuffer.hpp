@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+
+/**
+ * \brief Ring of vertex buffer segments for per-frame uploads.
+ *
+ * Every upload writes the next segment through an unsynchronized,
+ * write-only mapping of only the changed range, so the CPU never waits
+ * on a segment the GPU is still reading. Segments are guarded by fences
+ * placed after the draw that reads them. Source elements may be strided,
+ * so a single attribute can be streamed out of an interleaved array.
+ */
+class StreamBuffer
+{
+public:
+    static const unsigned int SEGMENTS = 3;
+
+    void create(const void* data, unsigned int stride, unsigned int elementSize, unsigned int elementCount, unsigned int segments);
+
+    void upload(const void* data, unsigned int stride, unsigned int first, unsigned int count);
+    void fence();
+    void release();
+
+    unsigned int getID();
+    GLintptr getOffset();
+
+private:
+    struct Segment
+    {
+        GLsync fence;
+        unsigned int dirtyBegin;
+        unsigned int dirtyEnd;
+    };
+
+    unsigned int bufferID = 0;
+    unsigned int elementSize = 0;
+    unsigned int elementCount = 0;
+    unsigned int current = 0;
+
+    std::vector<Segment> segments;
+
+    void waitFence(Segment& segment);
+    void writeElements(unsigned int segment, const void* data, unsigned int stride, unsigned int first, unsigned int count);
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "batch.hpp"
+#include "loader.hpp"
+#include "meshcache.hpp"
+#include "resultcache.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+int main(int argc, char* argv[])
+{
+    SweepSpec spec;
+    std::string outputPath = "sweep.csv";
+    unsigned int threads = 0;
+    std::string cachePath = "results.cache";
+    unsigned long long cacheBudget = 256;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--spec") == 0 && hasValue)
+        {
+            if (!SweepSpec::load(argv[++i], spec))
+                return EXIT_FAILURE;
+        }
+        else if (strcmp(argv[i], "--out") == 0 && hasValue)
+            outputPath = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cache") == 0 && hasValue)
+            cachePath = argv[++i];
+        else if (strcmp(argv[i], "--cache-size") == 0 && hasValue)
+            cacheBudget = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--no-cache") == 0)
+            cachePath.clear();
+        else
+        {
+            std::cout << "Usage: Sweep [--spec <sweep file>] [--out <csv file>] [--threads <count>]" << std::endl;
+            std::cout << "             [--cache <directory>] [--cache-size <MiB>] [--no-cache]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Nothing is drawn, models are loaded without GL objects and no context is created
+    Loader loader;
+    loader.setVerbose(false);
+    loader.setCreateMeshes(false);
+    MeshCache meshCache(loader);
+
+    // Runs simulated before are read from the cache directory, the least recently used go past the budget
+    ResultCache* resultCache = cachePath.empty() ? nullptr : new ResultCache(cachePath, cacheBudget << 20);
+
+    BatchRunner runner(meshCache, spec, threads, resultCache);
+    bool succeeded = runner.run(outputPath);
+
+    delete resultCache;
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
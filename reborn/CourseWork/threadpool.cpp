@@ -0,0 +1,94 @@
+#include "threadpool.hpp"
+#include "trace.hpp"
+
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+{
+    unsigned int i;
+
+    for (i = 0; i < workerCount; ++i)
+        workers.push_back(std::thread(&ThreadPool::run, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    startCondition.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(unsigned int count, bool staticSchedule, const std::function<void(unsigned int)>& job)
+{
+    if (count == 0)
+        return;
+
+    if (workers.empty() || count == 1)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+            job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->job = &job;
+        jobCount = count;
+        jobStatic = staticSchedule;
+        nextIndex.store(0);
+        active = workers.size();
+        ++generation;
+    }
+    startCondition.notify_all();
+
+    // The caller is the last worker
+    work(workers.size());
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return active == 0; });
+    this->job = nullptr;
+}
+
+unsigned int ThreadPool::getThreadCount()
+{
+    return workers.size() + 1;
+}
+
+void ThreadPool::run(unsigned int worker)
+{
+    TRACE_THREAD("worker " + std::to_string(worker));
+
+    unsigned long long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        startCondition.wait(lock, [this, seen] { return generation != seen || !running; });
+        if (!running)
+            return;
+        seen = generation;
+
+        lock.unlock();
+        work(worker);
+        lock.lock();
+
+        if (--active == 0)
+            doneCondition.notify_all();
+    }
+}
+
+void ThreadPool::work(unsigned int worker)
+{
+    unsigned int i, threads = getThreadCount();
+
+    if (jobStatic)
+        for (i = worker; i < jobCount; i += threads)
+            (*job)(i);
+    else
+        while ((i = nextIndex.fetch_add(1)) < jobCount)
+            (*job)(i);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * \brief Fixed set of worker threads running index-parallel jobs.
+ *
+ * The calling thread takes part in every job. With a static schedule
+ * index i always runs on worker i % getThreadCount(), otherwise workers
+ * pull indices from a shared counter.
+ */
+class ThreadPool
+{
+public:
+    ThreadPool(unsigned int workerCount);
+    ~ThreadPool();
+
+    void parallelFor(unsigned int count, bool staticSchedule, const std::function<void(unsigned int)>& job);
+
+    unsigned int getThreadCount();
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+
+    const std::function<void(unsigned int)>* job = nullptr;
+    unsigned int jobCount = 0;
+    bool jobStatic = false;
+    unsigned long long generation = 0;
+    unsigned int active = 0;
+    bool running = true;
+
+    std::atomic<unsigned int> nextIndex{ 0 };
+
+    void run(unsigned int worker);
+    void work(unsigned int worker);
+};
\ No newline at end of file
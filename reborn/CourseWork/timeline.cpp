@@ -0,0 +1,377 @@
+#include "timeline.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+
+/**
+ * \brief Ticks averaged for the rate at which ticks past the history are run
+ */
+static const unsigned int RATE_TICKS = 60;
+static const float DEFAULT_TICK_INTERVAL = 1.0f / 60.0f;
+
+Timeline::Timeline(Scene& scene, unsigned int interval, size_t budget) :
+    scene(scene),
+    interval(interval ? interval : 1),
+    budget(budget)
+{
+    scene.setKeepRemovedSpheres(true);
+}
+
+Timeline::~Timeline()
+{
+    collectRemoved();
+    scene.setKeepRemovedSpheres(false);
+
+    for (Model* wave : dormant)
+    {
+        wave->releaseMeshes();
+        delete wave;
+    }
+}
+
+/**
+ * \brief Logs the published tick, called after every swap with the tick time it ran with.
+ * Waves launched at this tick in a history that was rewound are launched again
+ */
+void Timeline::record(float tickTime)
+{
+    TRACE_SCOPE("Timeline::record");
+
+    unsigned long long tick = scene.getSnapshot().tick;
+
+    collectRemoved();
+
+    if (times.empty() || tick != getLastTick() + 1 || scene.getObjectsVersion() != objectsVersion)
+        reset(tick);
+    times.push_back(tickTime);
+
+    logLaunches(tick);
+    relaunch(tick);
+
+    if (checkpoints.empty() || tick - checkpoints.back().tick >= interval)
+        saveCheckpoint();
+}
+
+/**
+ * \brief Moves the published state to the target tick, only while the simulation is idle.
+ * Ticks past the history run at the recent tick rate and become its new end,
+ * the history after an earlier target is dropped
+ */
+bool Timeline::seek(unsigned long long target)
+{
+    TRACE_SCOPE("Timeline::seek");
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned long long current = scene.getSnapshot().tick, tick;
+    unsigned int i;
+
+    // Edits queued this frame go in first, an obstacle edit ends the history
+    scene.flush();
+    if (times.empty() || target < firstTick || scene.getObjectsVersion() != objectsVersion)
+        return false;
+
+    if (target < current)
+    {
+        i = checkpoints.size();
+        while (i > 0 && checkpoints[i - 1].tick > target)
+            --i;
+        if (i == 0)
+            return false;
+
+        const SceneCheckpoint& checkpoint = checkpoints[i - 1];
+
+        for (Model* wave : checkpoint.spheres)
+            wake(wave);
+
+        dropped.clear();
+        scene.restoreCheckpoint(checkpoint, dropped);
+        scene.swap();
+
+        for (Model* wave : dropped)
+            makeDormant(wave);
+
+        current = checkpoint.tick;
+    }
+
+    // Logged tick times, continued at the recent rate past the last logged tick
+    unsigned long long lastTick = getLastTick();
+    float lastTime = times.back(), tickInterval = getTickInterval();
+
+    steps.clear();
+    for (tick = current + 1; tick <= target; ++tick)
+        steps.push_back(tick <= lastTick ? getTime(tick) : lastTime + (tick - lastTick) * tickInterval);
+
+    truncate(current);
+
+    unsigned long long first = current + 1;
+    leaptTicks = simulatedTicks = 0;
+
+    while (current < target)
+    {
+        // A leap stops at the next launch, the wave joins from there
+        unsigned long long count = target - current;
+        for (const Launch& launch : launches)
+            if (launch.tick > current && launch.tick - current < count)
+                count = launch.tick - current;
+
+        unsigned int done = scene.fastForward(&steps[current + 1 - first], static_cast<unsigned int>(count));
+        scene.swap();
+
+        if (done > 1)
+            leaptTicks += done;
+        else
+            ++simulatedTicks;
+
+        for (tick = current + 1; tick <= current + done; ++tick)
+            times.push_back(steps[tick - first]);
+        current += done;
+
+        collectRemoved();
+        relaunch(current);
+
+        if (current - checkpoints.back().tick >= interval)
+            saveCheckpoint();
+    }
+
+    seekTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return true;
+}
+
+unsigned long long Timeline::getFirstTick()
+{
+    return firstTick;
+}
+
+unsigned long long Timeline::getLastTick()
+{
+    return times.empty() ? 0 : firstTick + times.size() - 1;
+}
+
+/**
+ * \brief Tick time of a tick, ticks past the history are continued at the recent rate
+ */
+float Timeline::getTime(unsigned long long tick)
+{
+    if (times.empty())
+        return 0.0f;
+    if (tick < firstTick)
+        return times.front();
+    if (tick > getLastTick())
+        return times.back() + (tick - getLastTick()) * getTickInterval();
+
+    return times[tick - firstTick];
+}
+
+/**
+ * \brief First tick with a tick time of at least time
+ */
+unsigned long long Timeline::getTick(float time)
+{
+    if (times.empty())
+        return 0;
+
+    if (time > times.back())
+        return getLastTick() + static_cast<unsigned long long>(std::ceil((time - times.back()) / getTickInterval()));
+
+    return firstTick + (std::lower_bound(times.begin(), times.end(), time) - times.begin());
+}
+
+float Timeline::getTickInterval()
+{
+    unsigned int count = times.size() > RATE_TICKS ? RATE_TICKS : times.size() - 1;
+
+    if (times.empty() || count == 0 || times.back() <= times[times.size() - 1 - count])
+        return DEFAULT_TICK_INTERVAL;
+
+    return (times.back() - times[times.size() - 1 - count]) / count;
+}
+
+unsigned int Timeline::getCheckpointCount()
+{
+    return checkpoints.size();
+}
+
+size_t Timeline::getSize()
+{
+    size_t total = size + times.size() * sizeof(float);
+
+    for (const Launch& launch : launches)
+        total += sizeof(Launch) + launch.state.getSize();
+
+    return total;
+}
+
+float Timeline::getSeekTime()
+{
+    return seekTime;
+}
+
+unsigned long long Timeline::getLeaptTicks()
+{
+    return leaptTicks;
+}
+
+unsigned long long Timeline::getSimulatedTicks()
+{
+    return simulatedTicks;
+}
+
+void Timeline::reset(unsigned long long tick)
+{
+    checkpoints.clear();
+    size = 0;
+
+    times.clear();
+    firstTick = tick;
+    objectsVersion = scene.getObjectsVersion();
+
+    // Launches still ahead are kept, a rewound history launches them again
+    launches.erase(std::remove_if(launches.begin(), launches.end(),
+        [tick](const Launch& launch) { return launch.tick < tick; }), launches.end());
+
+    releaseDormant();
+}
+
+void Timeline::saveCheckpoint()
+{
+    checkpoints.emplace_back();
+    scene.saveCheckpoint(checkpoints.back());
+    size += checkpoints.back().getSize();
+
+    evict();
+}
+
+/**
+ * \brief Drops the oldest checkpoints over the budget, the newest one always stays
+ */
+void Timeline::evict()
+{
+    while (size > budget && checkpoints.size() > 1)
+    {
+        size -= checkpoints.front().getSize();
+        checkpoints.pop_front();
+    }
+
+    unsigned long long first = checkpoints.front().tick;
+    if (first == firstTick)
+        return;
+
+    times.erase(times.begin(), times.begin() + (first - firstTick));
+    firstTick = first;
+
+    // Waves launched up to the first checkpoint are part of it
+    launches.erase(std::remove_if(launches.begin(), launches.end(),
+        [first](const Launch& launch) { return launch.tick <= first; }), launches.end());
+
+    releaseDormant();
+}
+
+/**
+ * \brief Drops the checkpoints and tick times after tick
+ */
+void Timeline::truncate(unsigned long long tick)
+{
+    while (!checkpoints.empty() && checkpoints.back().tick > tick)
+    {
+        size -= checkpoints.back().getSize();
+        checkpoints.pop_back();
+    }
+
+    if (tick < getLastTick())
+        times.resize(tick - firstTick + 1);
+}
+
+/**
+ * \brief Logs the state of waves published for the first time, after their first tick
+ */
+void Timeline::logLaunches(unsigned long long tick)
+{
+    unsigned int newest = lastWaveId;
+
+    for (Model* model : scene.getSnapshot().spheres)
+    {
+        Sphere* wave = static_cast<Sphere*>(model);
+        if (wave->getWaveId() <= lastWaveId)
+            continue;
+
+        launches.emplace_back();
+        launches.back().tick = tick;
+        launches.back().wave = model;
+        wave->saveState(launches.back().state);
+
+        newest = std::max(newest, wave->getWaveId());
+    }
+
+    lastWaveId = newest;
+}
+
+/**
+ * \brief Brings back the waves launched at tick that a rewind took out of the scene
+ */
+void Timeline::relaunch(unsigned long long tick)
+{
+    for (const Launch& launch : launches)
+        if (launch.tick == tick && std::find(dormant.begin(), dormant.end(), launch.wave) != dormant.end())
+        {
+            wake(launch.wave);
+            static_cast<Sphere*>(launch.wave)->restoreState(launch.state);
+
+            scene.addSphere(launch.wave);
+            scene.flush();
+        }
+}
+
+void Timeline::collectRemoved()
+{
+    dropped.clear();
+    scene.takeRemovedSpheres(dropped);
+
+    for (Model* wave : dropped)
+        makeDormant(wave);
+}
+
+void Timeline::makeDormant(Model* wave)
+{
+    static_cast<Sphere*>(wave)->releaseState();
+    dormant.push_back(wave);
+}
+
+void Timeline::wake(Model* wave)
+{
+    dormant.erase(std::remove(dormant.begin(), dormant.end(), wave), dormant.end());
+}
+
+/**
+ * \brief Deletes the dormant waves no checkpoint or launch refers to any more
+ */
+void Timeline::releaseDormant()
+{
+    unsigned int i;
+
+    for (i = 0; i < dormant.size(); ++i)
+    {
+        bool referenced = false;
+
+        for (const SceneCheckpoint& checkpoint : checkpoints)
+            if (std::find(checkpoint.spheres.begin(), checkpoint.spheres.end(), dormant[i]) != checkpoint.spheres.end())
+            {
+                referenced = true;
+                break;
+            }
+
+        for (const Launch& launch : launches)
+            if (launch.wave == dormant[i])
+                referenced = true;
+
+        if (!referenced)
+        {
+            dormant[i]->releaseMeshes();
+            delete dormant[i];
+            dormant.erase(dormant.begin() + i--);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "scene.hpp"
+#include "sphere.hpp"
+
+#include <deque>
+#include <vector>
+
+
+/**
+ * \brief History of the simulation for seeking in time.
+ *
+ * Every interval ticks the scene is saved to a checkpoint, the oldest
+ * checkpoints are dropped while their total size is over the budget. The
+ * tick time of every tick and the state of every wave after its first tick
+ * are logged beside them. A seek restores the last checkpoint before the
+ * target and runs forward, leaping over the ticks in which no vertex meets
+ * an event. Waves that left the scene are kept while a checkpoint or a
+ * launch may bring them back.
+ *
+ * Obstacles are not saved, adding or removing one starts a new history.
+ */
+class Timeline
+{
+public:
+    Timeline(Scene& scene, unsigned int interval = 30, size_t budget = 64 << 20);
+    ~Timeline();
+
+    void record(float tickTime);
+    bool seek(unsigned long long target);
+
+    unsigned long long getFirstTick();
+    unsigned long long getLastTick();
+    float getTime(unsigned long long tick);
+    unsigned long long getTick(float time);
+    float getTickInterval();
+
+    unsigned int getCheckpointCount();
+    size_t getSize();
+
+    // Last seek: duration in ms, ticks leapt over and ticks simulated
+    float getSeekTime();
+    unsigned long long getLeaptTicks();
+    unsigned long long getSimulatedTicks();
+
+private:
+    struct Launch
+    {
+        unsigned long long tick;
+        Model* wave;
+        WaveCheckpoint state;
+    };
+
+    Scene& scene;
+    unsigned int interval;
+    size_t budget;
+
+    std::deque<SceneCheckpoint> checkpoints;
+    size_t size = 0;
+
+    // Tick times from firstTick on
+    unsigned long long firstTick = 0;
+    std::deque<float> times;
+
+    std::vector<Launch> launches;
+    unsigned int lastWaveId = 0;
+    unsigned int objectsVersion = 0;
+
+    // Waves out of the scene, with their vertex state released
+    std::vector<Model*> dormant;
+    std::vector<Model*> dropped;
+
+    std::vector<float> steps;
+    float seekTime = 0.0f;
+    unsigned long long leaptTicks = 0;
+    unsigned long long simulatedTicks = 0;
+
+    void reset(unsigned long long tick);
+    void saveCheckpoint();
+    void evict();
+    void truncate(unsigned long long tick);
+
+    void logLaunches(unsigned long long tick);
+    void relaunch(unsigned long long tick);
+
+    void collectRemoved();
+    void makeDormant(Model* wave);
+    void wake(Model* wave);
+    void releaseDormant();
+};
\ No newline at end of file
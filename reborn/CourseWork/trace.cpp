@@ -0,0 +1,184 @@
+#include "trace.hpp"
+#include "allocation.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+
+TraceBuffer::TraceBuffer(unsigned int threadId) : threadId(threadId), events(CAPACITY)
+{
+    threadName = "thread " + std::to_string(threadId);
+}
+
+void TraceBuffer::push(const char* name, long long begin, long long duration)
+{
+    unsigned long long index = count.load(std::memory_order_relaxed);
+    TraceEvent& event = events[index % CAPACITY];
+
+    event.name = name;
+    event.begin = begin;
+    event.duration = duration;
+
+    count.store(index + 1, std::memory_order_release);
+}
+
+void TraceBuffer::copyEvents(long long since, std::vector<TraceEvent>& out)
+{
+    unsigned long long i, end = count.load(std::memory_order_acquire);
+    unsigned long long first = end > CAPACITY ? end - CAPACITY : 0;
+    std::vector<TraceEvent> copied(events.begin(), events.end());
+
+    // Slots the owner wrote again while they were copied are stale
+    unsigned long long written = count.load(std::memory_order_acquire);
+    if (written > CAPACITY && written - CAPACITY > first)
+        first = written - CAPACITY;
+
+    for (i = first; i < end; ++i)
+    {
+        const TraceEvent& event = copied[i % CAPACITY];
+        if (event.begin >= since)
+            out.push_back(event);
+    }
+}
+
+void TraceBuffer::clear()
+{
+    threadName = "thread " + std::to_string(threadId);
+    count.store(0, std::memory_order_release);
+}
+
+Tracer& Tracer::get()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer() : epoch(std::chrono::steady_clock::now())
+{
+    unsigned int i;
+
+    for (i = 0; i < FRAME_HISTORY; ++i)
+        frameStarts[i] = 0;
+}
+
+long long Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::record(const char* name, long long begin, long long end)
+{
+    localBuffer().push(name, begin, end - begin);
+}
+
+void Tracer::setThreadName(const std::string& name)
+{
+    TraceBuffer& buffer = localBuffer();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer.threadName = name;
+}
+
+void Tracer::markFrame()
+{
+    unsigned long long frame = frames.load(std::memory_order_relaxed);
+
+    frameStarts[frame % FRAME_HISTORY] = now();
+    frames.store(frame + 1, std::memory_order_release);
+}
+
+bool Tracer::dump(const std::string& path, unsigned int frameCount)
+{
+    AllocationTracker::Pause pause;
+    unsigned long long recorded = frames.load(std::memory_order_acquire);
+    long long since = 0;
+    size_t i, eventCount = 0;
+
+    if (frameCount > FRAME_HISTORY)
+        frameCount = FRAME_HISTORY;
+    if (recorded > frameCount)
+        since = frameStarts[(recorded - frameCount) % FRAME_HISTORY];
+
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open trace file: " << path << std::endl;
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<TraceEvent> events;
+    bool first = true;
+
+    for (auto& buffer : buffers)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+            << ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+        first = false;
+
+        events.clear();
+        buffer->copyEvents(since, events);
+
+        for (i = 0; i < events.size(); ++i)
+            file << ",\n{\"name\":\"" << events[i].name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << events[i].begin / 1000.0 << ",\"dur\":" << events[i].duration / 1000.0 << "}";
+
+        eventCount += events.size();
+    }
+
+    file << "\n]}\n";
+
+    std::cout << "Trace of " << (recorded < frameCount ? recorded : frameCount) << " frames (" << eventCount
+        << " events) written to " << path << std::endl;
+
+    return true;
+}
+
+void Tracer::releaseBuffer(TraceBuffer& buffer)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    freeBuffers.push_back(&buffer);
+}
+
+/**
+ * \brief Holds the buffer of a thread and gives it back when the thread exits
+ */
+struct TraceBufferLease
+{
+    TraceBuffer* buffer = nullptr;
+
+    ~TraceBufferLease()
+    {
+        if (buffer)
+            Tracer::get().releaseBuffer(*buffer);
+    }
+};
+
+TraceBuffer& Tracer::localBuffer()
+{
+    thread_local TraceBufferLease lease;
+
+    if (!lease.buffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // dump() holds the lock too, it never reads a buffer while it is cleared
+        if (!freeBuffers.empty())
+        {
+            lease.buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+            lease.buffer->clear();
+        }
+        else
+        {
+            buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer(buffers.size() + 1)));
+            lease.buffer = buffers.back().get();
+        }
+    }
+
+    return *lease.buffer;
+}
\ No newline at end of file
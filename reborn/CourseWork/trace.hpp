@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/**
+ * \brief Set to 0 to compile every TRACE_* macro out
+ */
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+/**
+ * \brief Completed span of one thread
+ */
+struct TraceEvent
+{
+    const char* name;
+    long long begin;
+    long long duration;
+};
+
+/**
+ * \brief Event ring written only by its own thread.
+ *
+ * The writer publishes an event by advancing count, a reader copies the
+ * last CAPACITY events and drops the ones overwritten while it copied.
+ */
+class TraceBuffer
+{
+public:
+    static const unsigned int CAPACITY = 1 << 16;
+
+    TraceBuffer(unsigned int threadId);
+
+    void push(const char* name, long long begin, long long duration);
+    void copyEvents(long long since, std::vector<TraceEvent>& out);
+    void clear();
+
+    unsigned int threadId;
+    std::string threadName;
+
+private:
+    std::vector<TraceEvent> events;
+    std::atomic<unsigned long long> count{ 0 };
+};
+
+/**
+ * \brief Collects spans of every thread and writes them as Chrome trace events.
+ *
+ * Each thread records into its own TraceBuffer, the only lock is taken
+ * when a thread records for the first time. A thread gives its buffer back
+ * when it exits and the next new thread starts over in it, so pools
+ * created run after run keep the buffer count at the most threads alive
+ * at once. dump() writes the spans of the last frames marked with
+ * markFrame(), the file opens in chrome://tracing or ui.perfetto.dev.
+ */
+class Tracer
+{
+public:
+    /**
+     * \brief Frame starts kept, the longest window dump() can write
+     */
+    static const unsigned int FRAME_HISTORY = 1024;
+
+    static Tracer& get();
+
+    long long now();
+
+    void record(const char* name, long long begin, long long end);
+    void setThreadName(const std::string& name);
+    void markFrame();
+
+    bool dump(const std::string& path, unsigned int frames);
+
+    void releaseBuffer(TraceBuffer& buffer);
+
+private:
+    Tracer();
+
+    std::chrono::steady_clock::time_point epoch;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer*> freeBuffers;
+
+    long long frameStarts[FRAME_HISTORY];
+    std::atomic<unsigned long long> frames{ 0 };
+
+    TraceBuffer& localBuffer();
+};
+
+/**
+ * \brief Records the lifetime of the scope as a span
+ */
+class TraceScope
+{
+public:
+    TraceScope(const char* name) : name(name), begin(Tracer::get().now())
+    {
+    }
+
+    ~TraceScope()
+    {
+        Tracer::get().record(name, begin, Tracer::get().now());
+    }
+
+private:
+    const char* name;
+    long long begin;
+};
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD(name) Tracer::get().setThreadName(name)
+#define TRACE_FRAME() Tracer::get().markFrame()
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#define TRACE_FRAME() ((void)0)
+#endif
\ No newline at end of file
@@ -0,0 +1,689 @@
+#include "trajectory.hpp"
+#include "trace.hpp"
+
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+
+static const unsigned int TRAJECTORY_MAGIC = 0x52545743;   // "CWTR"
+static const unsigned int FRAME_MAGIC = 0x4D524643;        // "CFRM"
+static const unsigned int INDEX_MAGIC = 0x49545743;        // "CWTI"
+static const unsigned int TRAJECTORY_VERSION = 1;
+
+// magic, tick, wave count, keyframe flag, byte size
+static const unsigned int FRAME_HEADER_SIZE = 4 + 8 + 4 + 1 + 4;
+// id, vertex count, color, model matrix, coding, payload size
+static const unsigned int WAVE_HEADER_SIZE = 4 + 4 + sizeof(glm::vec4) + sizeof(glm::mat4) + 1 + 4;
+
+static const short DEAD_VALUE = SHRT_MIN;
+static const unsigned char CODING_ABSOLUTE = 0;
+static const unsigned char CODING_DELTA = 1;
+
+template <typename T>
+static void putValue(std::vector<unsigned char>& data, const T& value)
+{
+    const unsigned char* bytes = (const unsigned char*)&value;
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static T getValue(const unsigned char* data)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+static void putVarint(std::vector<unsigned char>& data, unsigned int value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<unsigned char>(value));
+}
+
+/**
+ * \brief Reads a varint, returns false if it runs past end
+ */
+static bool getVarint(const unsigned char*& data, const unsigned char* end, unsigned int& value)
+{
+    unsigned int shift = 0;
+
+    value = 0;
+    while (data < end && shift < 32)
+    {
+        unsigned char byte = *data++;
+
+        value |= static_cast<unsigned int>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+        shift += 7;
+    }
+
+    return false;
+}
+
+static short quantize(float value, float inverseStep)
+{
+    float scaled = std::floor(value * inverseStep + 0.5f);
+
+    if (scaled > SHRT_MAX)
+        return SHRT_MAX;
+    if (scaled < -SHRT_MAX)
+        return -SHRT_MAX;
+    return static_cast<short>(scaled);
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    close();
+}
+
+bool TrajectoryRecorder::open(const std::string& path, const std::string& waveMesh, float step, unsigned int keyframeInterval)
+{
+    unsigned int i;
+
+    close();
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cout << "Failed to open trajectory file: " << path << std::endl;
+        return false;
+    }
+
+    this->step = step;
+    this->keyframeInterval = keyframeInterval ? keyframeInterval : 1;
+
+    std::vector<unsigned char> header;
+    putValue(header, TRAJECTORY_MAGIC);
+    putValue(header, TRAJECTORY_VERSION);
+    putValue(header, this->step);
+    putValue(header, this->keyframeInterval);
+    putValue(header, static_cast<unsigned int>(waveMesh.size()));
+    header.insert(header.end(), waveMesh.begin(), waveMesh.end());
+
+    file.write((const char*)&header[0], header.size());
+
+    offset = header.size();
+    frameCount = 0;
+    previous.clear();
+    index.clear();
+
+    jobs.assign(JOBS, Job());
+    freeJobs.clear();
+    queuedJobs.clear();
+    for (i = 0; i < JOBS; ++i)
+        freeJobs.push_back(&jobs[i]);
+
+    running = true;
+    writer = std::thread(&TrajectoryRecorder::run, this);
+
+    return true;
+}
+
+bool TrajectoryRecorder::isOpen()
+{
+    return file.is_open();
+}
+
+/**
+ * \brief Copies the drawn positions of the published waves, waits only if
+ * every pooled job is still queued
+ */
+void TrajectoryRecorder::record(const SceneSnapshot& snapshot)
+{
+    TRACE_SCOPE("TrajectoryRecorder::record");
+
+    if (!file.is_open())
+        return;
+
+    Job* job;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return !freeJobs.empty(); });
+
+        job = freeJobs.back();
+        freeJobs.pop_back();
+    }
+
+    job->tick = snapshot.tick;
+    job->waves.clear();
+    job->positions.clear();
+
+    for (Model* model : snapshot.spheres)
+    {
+        Sphere* sphere = static_cast<Sphere*>(model);
+        const std::vector<glm::vec3>& positions = sphere->getPositions();
+        WaveState wave;
+
+        wave.id = sphere->getWaveId();
+        wave.vertexCount = positions.size();
+        wave.color = sphere->getDrawColor();
+        wave.modelMatrix = sphere->getModelMatrix();
+        wave.first = job->positions.size();
+
+        job->waves.push_back(wave);
+        job->positions.insert(job->positions.end(), positions.begin(), positions.end());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queuedJobs.push_back(job);
+    }
+    condition.notify_all();
+}
+
+/**
+ * \brief Writes the queued frames and the index, a closed recorder can be opened again
+ */
+void TrajectoryRecorder::close()
+{
+    if (!file.is_open())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    condition.notify_all();
+    writer.join();
+
+    std::vector<unsigned char> footer;
+    for (const TrajectoryIndexEntry& entry : index)
+        putValue(footer, entry);
+    putValue(footer, static_cast<unsigned long long>(index.size()));
+    putValue(footer, INDEX_MAGIC);
+
+    file.write((const char*)&footer[0], footer.size());
+    file.close();
+
+    std::cout << "Trajectory: " << frameCount << " frames, " << (offset >> 10) << " KiB" << std::endl;
+
+    jobs.clear();
+    freeJobs.clear();
+    queuedJobs.clear();
+    previous.clear();
+    index.clear();
+}
+
+void TrajectoryRecorder::run()
+{
+    TRACE_THREAD("trajectory writer");
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        condition.wait(lock, [this] { return !queuedJobs.empty() || !running; });
+        if (queuedJobs.empty())
+            return;
+
+        Job* job = queuedJobs.front();
+        queuedJobs.pop_front();
+
+        lock.unlock();
+        writeFrame(*job);
+        lock.lock();
+
+        freeJobs.push_back(job);
+        condition.notify_all();
+    }
+}
+
+void TrajectoryRecorder::writeFrame(const Job& job)
+{
+    TRACE_SCOPE("TrajectoryRecorder::writeFrame");
+
+    bool keyframe = frameCount % keyframeInterval == 0;
+    float inverseStep = 1.0f / step;
+    unsigned int i, k;
+
+    frame.clear();
+
+    for (const WaveState& wave : job.waves)
+    {
+        const glm::vec3* positions = job.positions.empty() ? nullptr : &job.positions[wave.first];
+
+        quantized.resize(wave.vertexCount * 3);
+        for (i = 0; i < wave.vertexCount; ++i)
+        {
+            // Dead vertices sit at INT_MAX, far outside any quantized range
+            if (positions[i].x > 1e9f)
+            {
+                quantized[i * 3] = quantized[i * 3 + 1] = quantized[i * 3 + 2] = DEAD_VALUE;
+                continue;
+            }
+
+            quantized[i * 3] = quantize(positions[i].x, inverseStep);
+            quantized[i * 3 + 1] = quantize(positions[i].y, inverseStep);
+            quantized[i * 3 + 2] = quantize(positions[i].z, inverseStep);
+        }
+
+        auto found = previous.find(wave.id);
+        bool delta = !keyframe && found != previous.end() && found->second.size() == quantized.size();
+        unsigned int zeroRun = 0;
+
+        payload.clear();
+        for (k = 0; k < quantized.size(); ++k)
+        {
+            int difference = quantized[k] - (delta ? found->second[k] : 0);
+
+            if (difference == 0)
+            {
+                ++zeroRun;
+                continue;
+            }
+
+            if (zeroRun)
+            {
+                putVarint(payload, (zeroRun << 1) | 1);
+                zeroRun = 0;
+            }
+
+            unsigned int zigzag = (static_cast<unsigned int>(difference) << 1) ^ static_cast<unsigned int>(difference >> 31);
+            putVarint(payload, zigzag << 1);
+        }
+        if (zeroRun)
+            putVarint(payload, (zeroRun << 1) | 1);
+
+        putValue(frame, wave.id);
+        putValue(frame, wave.vertexCount);
+        putValue(frame, wave.color);
+        putValue(frame, wave.modelMatrix);
+        putValue(frame, delta ? CODING_DELTA : CODING_ABSOLUTE);
+        putValue(frame, static_cast<unsigned int>(payload.size()));
+        frame.insert(frame.end(), payload.begin(), payload.end());
+
+        previous[wave.id].assign(quantized.begin(), quantized.end());
+    }
+
+    // Waves that died are coded from zero if the id ever shows up again
+    for (auto it = previous.begin(); it != previous.end();)
+    {
+        bool live = false;
+
+        for (const WaveState& wave : job.waves)
+            if (wave.id == it->first)
+            {
+                live = true;
+                break;
+            }
+
+        it = live ? std::next(it) : previous.erase(it);
+    }
+
+    std::vector<unsigned char> header;
+    putValue(header, FRAME_MAGIC);
+    putValue(header, job.tick);
+    putValue(header, static_cast<unsigned int>(job.waves.size()));
+    putValue(header, static_cast<unsigned char>(keyframe ? 1 : 0));
+    putValue(header, static_cast<unsigned int>(frame.size()));
+
+    file.write((const char*)&header[0], header.size());
+    if (!frame.empty())
+        file.write((const char*)&frame[0], frame.size());
+
+    index.push_back({ job.tick, offset, keyframe ? 1u : 0u, 0u });
+    offset += header.size() + frame.size();
+    ++frameCount;
+}
+
+TrajectoryPlayer::~TrajectoryPlayer()
+{
+    close();
+}
+
+bool TrajectoryPlayer::open(const std::string& path, MeshCache& meshCache)
+{
+    close();
+
+    if (!file.open(path))
+        return false;
+
+    const unsigned char* data = file.getData();
+    unsigned long long size = file.getSize();
+
+    if (size < 20 || getValue<unsigned int>(data) != TRAJECTORY_MAGIC || getValue<unsigned int>(data + 4) != TRAJECTORY_VERSION)
+    {
+        std::cout << "Not a trajectory file: " << path << std::endl;
+        file.close();
+        return false;
+    }
+
+    step = getValue<float>(data + 8);
+    unsigned int meshLength = getValue<unsigned int>(data + 16);
+    if (20 + static_cast<unsigned long long>(meshLength) > size)
+    {
+        std::cout << "Trajectory header is truncated: " << path << std::endl;
+        file.close();
+        return false;
+    }
+
+    std::string waveMesh((const char*)data + 20, meshLength);
+    dataOffset = 20 + meshLength;
+
+    if (!readIndex())
+    {
+        std::cout << "Trajectory index is corrupt: " << path << std::endl;
+        file.close();
+        index.clear();
+        return false;
+    }
+
+    glm::mat4 identity = glm::mat4(1.0f);
+    glm::vec4 color = glm::vec4(1.0f);
+    float speed = 0.0f;
+
+    source = new Sphere(identity, color, speed);
+    meshCache.loadModel(waveMesh, *source);
+    if (source->getVertices().empty())
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void TrajectoryPlayer::close()
+{
+    for (PlaybackWave* wave : waves)
+    {
+        for (auto& mesh : wave->meshes)
+            mesh.release();
+        delete wave;
+    }
+    waves.clear();
+
+    if (source)
+    {
+        source->releaseMeshes();
+        delete source;
+        source = nullptr;
+    }
+
+    file.close();
+    index.clear();
+    current = 0;
+    decoded = false;
+    decodedBytes = 0;
+}
+
+/**
+ * \brief Shows the given frame, decoding from the last keyframe up to it
+ * unless it follows the current one
+ */
+bool TrajectoryPlayer::seek(unsigned int frame)
+{
+    TRACE_SCOPE("TrajectoryPlayer::seek");
+
+    if (frame >= index.size())
+        return false;
+    if (decoded && frame == current)
+        return true;
+
+    unsigned int first = frame;
+
+    if (!decoded || frame != current + 1)
+        while (first > 0 && !index[first].keyframe)
+            --first;
+
+    for (; first <= frame; ++first)
+        if (!decodeFrame(first))
+        {
+            decoded = false;
+            return false;
+        }
+
+    current = frame;
+    decoded = true;
+
+    return true;
+}
+
+bool TrajectoryPlayer::next()
+{
+    return seek(decoded ? current + 1 : 0);
+}
+
+void TrajectoryPlayer::render(Shader& shader)
+{
+    TRACE_SCOPE("TrajectoryPlayer::render");
+
+    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+    for (PlaybackWave* wave : waves)
+    {
+        shader.setVec4("modelColor", wave->color);
+        shader.setMat4("model", wave->modelMatrix);
+
+        for (auto& mesh : wave->meshes)
+        {
+            if (wave->dirty)
+                mesh.upload(wave->positions, 0, wave->positions.size());
+
+            mesh.Bind();
+            mesh.Draw(shader);
+            mesh.Unbind();
+        }
+        wave->dirty = false;
+    }
+
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+}
+
+unsigned int TrajectoryPlayer::getFrame()
+{
+    return current;
+}
+
+unsigned int TrajectoryPlayer::getFrameCount()
+{
+    return index.size();
+}
+
+unsigned long long TrajectoryPlayer::getTick()
+{
+    return decoded ? index[current].tick : 0;
+}
+
+unsigned int TrajectoryPlayer::getWaveCount()
+{
+    return waves.size();
+}
+
+unsigned long long TrajectoryPlayer::getDecodedBytes()
+{
+    return decodedBytes;
+}
+
+/**
+ * \brief Reads the index footer, or rebuilds the index from the frame headers
+ * if it is missing. Returns false if a footer entry points outside the frames
+ */
+bool TrajectoryPlayer::readIndex()
+{
+    const unsigned char* data = file.getData();
+    unsigned long long size = file.getSize();
+    unsigned int i;
+
+    index.clear();
+
+    if (size >= dataOffset + 12 && getValue<unsigned int>(data + size - 4) == INDEX_MAGIC)
+    {
+        unsigned long long count = getValue<unsigned long long>(data + size - 12);
+        unsigned long long entries = count * sizeof(TrajectoryIndexEntry);
+
+        if (count <= size / sizeof(TrajectoryIndexEntry) && dataOffset + entries <= size - 12)
+        {
+            unsigned long long framesEnd = size - 12 - entries;
+
+            index.resize(static_cast<size_t>(count));
+            if (count)
+                memcpy(&index[0], data + framesEnd, static_cast<size_t>(entries));
+
+            // Every frame, header and waves, has to lie between the file header and the index
+            for (i = 0; i < index.size(); ++i)
+            {
+                unsigned long long offset = index[i].offset;
+
+                if (offset < dataOffset || offset > framesEnd || framesEnd - offset < FRAME_HEADER_SIZE ||
+                    getValue<unsigned int>(data + offset) != FRAME_MAGIC ||
+                    framesEnd - offset - FRAME_HEADER_SIZE < getValue<unsigned int>(data + offset + 17))
+                    return false;
+            }
+
+            return true;
+        }
+    }
+
+    // Walk the frames up to the first one that was not completely written
+    unsigned long long offset = dataOffset;
+
+    while (offset + FRAME_HEADER_SIZE <= size && getValue<unsigned int>(data + offset) == FRAME_MAGIC)
+    {
+        unsigned long long frameSize = FRAME_HEADER_SIZE + getValue<unsigned int>(data + offset + 17);
+        if (offset + frameSize > size)
+            break;
+
+        index.push_back({ getValue<unsigned long long>(data + offset + 4), offset, data[offset + 16], 0u });
+        offset += frameSize;
+    }
+
+    std::cout << "Trajectory has no index, rebuilt it from " << index.size() << " frames" << std::endl;
+
+    return true;
+}
+
+bool TrajectoryPlayer::decodeFrame(unsigned int frame)
+{
+    // The index only holds frames that fit in the file
+    const unsigned char* data = file.getData() + index[frame].offset;
+    const unsigned char* end = data + FRAME_HEADER_SIZE + getValue<unsigned int>(data + 17);
+    unsigned int waveCount = getValue<unsigned int>(data + 12);
+    unsigned int i, k;
+
+    data += FRAME_HEADER_SIZE;
+
+    for (PlaybackWave* wave : waves)
+        wave->seen = false;
+
+    for (i = 0; i < waveCount; ++i)
+    {
+        if (static_cast<unsigned long long>(end - data) < WAVE_HEADER_SIZE)
+        {
+            std::cout << "Trajectory frame " << frame << " is truncated" << std::endl;
+            return false;
+        }
+
+        unsigned int id = getValue<unsigned int>(data);
+        unsigned int vertexCount = getValue<unsigned int>(data + 4);
+        const unsigned char* fields = data + 8;
+        glm::vec4 color = getValue<glm::vec4>(fields);
+        glm::mat4 modelMatrix = getValue<glm::mat4>(fields + sizeof(glm::vec4));
+        unsigned char coding = fields[sizeof(glm::vec4) + sizeof(glm::mat4)];
+        unsigned int payloadSize = getValue<unsigned int>(fields + sizeof(glm::vec4) + sizeof(glm::mat4) + 1);
+
+        data += WAVE_HEADER_SIZE;
+        if (static_cast<unsigned long long>(end - data) < payloadSize)
+        {
+            std::cout << "Trajectory frame " << frame << " is truncated" << std::endl;
+            return false;
+        }
+
+        const unsigned char* payload = data;
+        const unsigned char* payloadEnd = data + payloadSize;
+        data = payloadEnd;
+
+        // Waves recorded from another mesh cannot be drawn with the source meshes
+        if (vertexCount != source->getVertices().size())
+            continue;
+
+        PlaybackWave* wave = getWave(id);
+
+        if (coding == CODING_ABSOLUTE || wave->quantized.size() != vertexCount * 3)
+            wave->quantized.assign(vertexCount * 3, 0);
+
+        for (k = 0; k < wave->quantized.size();)
+        {
+            unsigned int token;
+            if (!getVarint(payload, payloadEnd, token))
+                break;
+
+            if (token & 1)
+            {
+                k += token >> 1;
+                continue;
+            }
+
+            unsigned int zigzag = token >> 1;
+            int difference = static_cast<int>(zigzag >> 1) ^ -static_cast<int>(zigzag & 1);
+            wave->quantized[k] = static_cast<short>(wave->quantized[k] + difference);
+            ++k;
+        }
+
+        wave->positions.resize(vertexCount);
+        for (k = 0; k < vertexCount; ++k)
+        {
+            const short* value = &wave->quantized[k * 3];
+
+            if (value[0] == DEAD_VALUE)
+                wave->positions[k] = glm::vec3(INT_MAX);
+            else
+                wave->positions[k] = glm::vec3(value[0], value[1], value[2]) * step;
+        }
+
+        wave->color = color;
+        wave->modelMatrix = modelMatrix;
+        wave->seen = true;
+        wave->dirty = true;
+    }
+
+    // Waves missing from the frame died before it
+    for (auto it = waves.begin(); it != waves.end();)
+    {
+        if ((*it)->seen)
+        {
+            ++it;
+            continue;
+        }
+
+        for (auto& mesh : (*it)->meshes)
+            mesh.release();
+        delete *it;
+        it = waves.erase(it);
+    }
+
+    decodedBytes += data - (file.getData() + index[frame].offset);
+
+    return true;
+}
+
+TrajectoryPlayer::PlaybackWave* TrajectoryPlayer::getWave(unsigned int id)
+{
+    for (PlaybackWave* wave : waves)
+        if (wave->id == id)
+            return wave;
+
+    PlaybackWave* wave = new PlaybackWave();
+    wave->id = id;
+    wave->seen = false;
+    wave->dirty = true;
+
+    // Same as launching a wave, the copies get their own streamed buffers
+    wave->meshes.reserve(source->getMeshes().size());
+    for (auto& mesh : source->getMeshes())
+    {
+        wave->meshes.push_back(mesh);
+        wave->meshes.back().setupMesh(*source, StreamBuffer::SEGMENTS);
+    }
+
+    waves.push_back(wave);
+
+    return wave;
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "scene.hpp"
+#include "sphere.hpp"
+#include "meshcache.hpp"
+#include "mappedfile.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * \brief Trajectory file layout, native byte order.
+ *
+ * Header: magic, version, quantization step, keyframe interval, wave mesh
+ * path. Then one frame per tick: frame magic, tick, wave count, keyframe
+ * flag, byte size of the waves, and per live wave its id, vertex count,
+ * draw color, model matrix, coding and the byte size of its positions.
+ *
+ * Positions are quantized to int16 multiples of the step, a dead vertex
+ * is -32768. A wave is coded as the differences to its quantized positions
+ * of the previous frame (or to zero in a keyframe and when it first
+ * appears), written as varints: a zigzag value shifted left by one, or a
+ * run of zero differences shifted left by one with the low bit set.
+ * Closing the file appends the frame index (tick, offset and keyframe flag
+ * of every frame), its count and the index magic. A file without it, cut
+ * short by a crash, is indexed by walking the frame headers.
+ */
+struct TrajectoryIndexEntry
+{
+    unsigned long long tick;
+    unsigned long long offset;
+    unsigned int keyframe;
+    unsigned int reserved;
+};
+
+/**
+ * \brief Writes the live wavefronts of every published tick to a trajectory file.
+ * The render thread only copies positions into a pooled job, quantizing,
+ * coding and writing run on a background thread
+ */
+class TrajectoryRecorder
+{
+public:
+    static const unsigned int JOBS = 4;
+
+    ~TrajectoryRecorder();
+
+    bool open(const std::string& path, const std::string& waveMesh, float step = 1.0f / 512.0f, unsigned int keyframeInterval = 60);
+    bool isOpen();
+    void record(const SceneSnapshot& snapshot);
+    void close();
+
+private:
+    struct WaveState
+    {
+        unsigned int id;
+        unsigned int vertexCount;
+        glm::vec4 color;
+        glm::mat4 modelMatrix;
+        unsigned int first;
+    };
+
+    struct Job
+    {
+        unsigned long long tick;
+        std::vector<WaveState> waves;
+        std::vector<glm::vec3> positions;
+    };
+
+    std::ofstream file;
+    float step = 1.0f / 512.0f;
+    unsigned int keyframeInterval = 60;
+
+    std::vector<Job> jobs;
+    std::vector<Job*> freeJobs;
+    std::deque<Job*> queuedJobs;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool running = false;
+
+    // Writer thread state
+    unsigned long long offset = 0;
+    unsigned int frameCount = 0;
+    std::map<unsigned int, std::vector<short>> previous;
+    std::vector<short> quantized;
+    std::vector<unsigned char> payload;
+    std::vector<unsigned char> frame;
+    std::vector<TrajectoryIndexEntry> index;
+
+    void run();
+    void writeFrame(const Job& job);
+};
+
+/**
+ * \brief Plays a trajectory file back from a memory mapping.
+ *
+ * Frames are decoded straight from the mapped pages and uploaded to the
+ * waves' own meshes, nothing is simulated. seek() starts decoding at the
+ * last keyframe before the requested frame, the next frame is decoded
+ * from the current one.
+ */
+class TrajectoryPlayer
+{
+public:
+    ~TrajectoryPlayer();
+
+    bool open(const std::string& path, MeshCache& meshCache);
+    void close();
+
+    bool seek(unsigned int frame);
+    bool next();
+    void render(Shader& shader);
+
+    unsigned int getFrame();
+    unsigned int getFrameCount();
+    unsigned long long getTick();
+    unsigned int getWaveCount();
+    // Bytes decoded for the frames shown so far
+    unsigned long long getDecodedBytes();
+
+private:
+    struct PlaybackWave
+    {
+        unsigned int id;
+        glm::vec4 color;
+        glm::mat4 modelMatrix;
+        std::vector<short> quantized;
+        std::vector<glm::vec3> positions;
+        std::vector<Mesh> meshes;
+        bool seen;
+        bool dirty;
+    };
+
+    MappedFile file;
+    float step = 0.0f;
+    unsigned long long dataOffset = 0;
+
+    std::vector<TrajectoryIndexEntry> index;
+    unsigned int current = 0;
+    bool decoded = false;
+    unsigned long long decodedBytes = 0;
+
+    // Source of the wave meshes, the recorded positions replace its vertices
+    Sphere* source = nullptr;
+    std::vector<PlaybackWave*> waves;
+
+    bool readIndex();
+    bool decodeFrame(unsigned int frame);
+    PlaybackWave* getWave(unsigned int id);
+};
\ No newline at end of file
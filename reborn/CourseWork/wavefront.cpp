@@ -0,0 +1,160 @@
+#include "wavefront.hpp"
+
+#include <cmath>
+#include <map>
+#include <mutex>
+
+
+const float RADIUS_TOLERANCE = 1e-4f;
+
+/**
+ * \brief Offset error, relative to the offset, within which a wave reuses a shape.
+ * Above the error of the encoded directions
+ */
+const float SHAPE_TOLERANCE = 1e-3f;
+
+size_t WaveCheckpoint::getSize() const
+{
+    return sizeof(WaveCheckpoint) +
+        deadBits.size() * sizeof(unsigned int) +
+        reflectedIndices.size() * sizeof(unsigned int) +
+        reflectedVertices.size() * sizeof(WaveVertex);
+}
+
+std::shared_ptr<const WaveShape> WaveShape::acquire(const std::vector<Vertex>& vertices,
+    const std::vector<Face>& faces, const glm::vec3& origin)
+{
+    static std::mutex registryMutex;
+    static std::map<unsigned long long, std::vector<std::weak_ptr<const WaveShape>>> registry;
+
+    std::vector<glm::vec3> offsets(vertices.size());
+    unsigned long long key = 14695981039346656037ULL;
+    unsigned int i, j;
+
+    for (i = 0; i < vertices.size(); ++i)
+        offsets[i] = vertices[i].Position - origin;
+
+    // Models of the same topology land on one key, their offsets tell them apart
+    key = (key ^ vertices.size()) * 1099511628211ULL;
+    for (i = 0; i < faces.size(); ++i)
+        for (j = 0; j < 3; ++j)
+        {
+            key = (key ^ faces[i].Triangles.first[j]) * 1099511628211ULL;
+            key = (key ^ faces[i].Triangles.second[j]) * 1099511628211ULL;
+        }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<std::weak_ptr<const WaveShape>>& candidates = registry[key];
+
+    for (i = 0; i < candidates.size(); )
+    {
+        std::shared_ptr<const WaveShape> cached = candidates[i].lock();
+
+        if (!cached)
+        {
+            candidates.erase(candidates.begin() + i);
+            continue;
+        }
+
+        if (cached->matches(offsets))
+            return cached;
+        ++i;
+    }
+
+    std::shared_ptr<WaveShape> shape = std::make_shared<WaveShape>();
+
+    shape->directions.resize(vertices.size());
+    shape->radii.resize(vertices.size());
+
+    bool uniformRadius = true;
+
+    for (i = 0; i < vertices.size(); ++i)
+    {
+        float length = glm::length(offsets[i]);
+
+        shape->directions[i] = encodeDirection(length > 0.0f ? offsets[i] / length : glm::vec3(0, 0, 1));
+        shape->radii[i] = length;
+
+        if (std::abs(length - shape->radii[0]) > RADIUS_TOLERANCE * shape->radii[0])
+            uniformRadius = false;
+    }
+
+    if (uniformRadius && !vertices.empty())
+    {
+        shape->radius = shape->radii[0];
+        shape->radii.clear();
+    }
+
+    shape->triangles.reserve(faces.size() * 2);
+    for (i = 0; i < faces.size(); ++i)
+    {
+        shape->triangles.push_back(faces[i].Triangles.first);
+        shape->triangles.push_back(faces[i].Triangles.second);
+    }
+
+    candidates.push_back(shape);
+
+    return shape;
+}
+
+/**
+ * \brief Whether the shape reproduces every offset, the same model launched
+ * anywhere matches while another model of the same topology does not
+ */
+bool WaveShape::matches(const std::vector<glm::vec3>& offsets) const
+{
+    unsigned int i;
+
+    if (offsets.size() != directions.size())
+        return false;
+
+    for (i = 0; i < offsets.size(); ++i)
+        if (glm::length(getOffset(i) - offsets[i]) > SHAPE_TOLERANCE * glm::length(offsets[i]))
+            return false;
+
+    return true;
+}
+
+unsigned int WaveShape::size() const
+{
+    return directions.size();
+}
+
+glm::vec3 WaveShape::getOffset(unsigned int index) const
+{
+    return decodeDirection(directions[index]) * (radii.empty() ? radius : radii[index]);
+}
+
+unsigned int WaveShape::encodeDirection(const glm::vec3& direction)
+{
+    glm::vec3 n = direction / (std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z));
+    float x = n.x, y = n.y;
+
+    // Fold the lower hemisphere over the diagonals
+    if (n.z < 0.0f)
+    {
+        x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    short qx = (short)std::round(glm::clamp(x, -1.0f, 1.0f) * 32767.0f);
+    short qy = (short)std::round(glm::clamp(y, -1.0f, 1.0f) * 32767.0f);
+
+    return (unsigned short)qx | ((unsigned int)(unsigned short)qy << 16);
+}
+
+glm::vec3 WaveShape::decodeDirection(unsigned int packed)
+{
+    float x = (short)(packed & 0xFFFF) / 32767.0f;
+    float y = (short)(packed >> 16) / 32767.0f;
+    float z = 1.0f - std::abs(x) - std::abs(y);
+
+    if (z < 0.0f)
+    {
+        float t = -z;
+        x += x >= 0.0f ? -t : t;
+        y += y >= 0.0f ? -t : t;
+    }
+
+    return glm::normalize(glm::vec3(x, y, z));
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <memory>
+#include <vector>
+
+
+/**
+ * \brief Wave vertex that left the shared wavefront after a reflection
+ */
+struct WaveVertex
+{
+    glm::vec3 Position;
+    glm::vec3 Velocity;
+};
+
+/**
+ * \brief Events of one vertex chunk of a wave update.
+ * Chunks run in parallel and are merged in chunk order, so the result
+ * does not depend on thread count or scheduling.
+ */
+struct WaveEvents
+{
+    std::vector<unsigned int> reflectedIndices;
+    std::vector<WaveVertex> reflectedVertices;
+    std::vector<unsigned int> kills;
+
+    // Vertices inside the room waiting for the obstacle pass
+    std::vector<unsigned int> testIndices;
+    std::vector<glm::vec3> testPoints;
+
+    unsigned int dirtyBegin = 0;
+    unsigned int dirtyEnd = 0;
+};
+
+/**
+ * \brief Compact state of a wave: dead vertices as bits, reflected vertices with their index.
+ * Unreflected vertices follow from the travelled distance
+ */
+struct WaveCheckpoint
+{
+    float travel = 0.0f;
+    glm::vec4 color;
+    std::vector<unsigned int> deadBits;
+    std::vector<unsigned int> reflectedIndices;
+    std::vector<WaveVertex> reflectedVertices;
+
+    size_t getSize() const;
+};
+
+/**
+ * \brief Shape shared by every wave launched from one sphere model.
+ *
+ * An unreflected wave vertex moves away from the source along its own
+ * start offset, so the whole wavefront is described by this table plus
+ * the source origin, speed and travelled time. Offsets are stored as
+ * octahedral-encoded directions (two snorm16) and a radius that is
+ * shared unless the model is not a true sphere.
+ */
+class WaveShape
+{
+public:
+    /**
+     * \brief Triangles of the model, in the order of its face pairs
+     */
+    std::vector<glm::uvec3> triangles;
+
+    static std::shared_ptr<const WaveShape> acquire(const std::vector<Vertex>& vertices,
+        const std::vector<Face>& faces, const glm::vec3& origin);
+
+    unsigned int size() const;
+    glm::vec3 getOffset(unsigned int index) const;
+
+private:
+    std::vector<unsigned int> directions;
+    std::vector<float> radii;
+    float radius = 0.0f;
+
+    bool matches(const std::vector<glm::vec3>& offsets) const;
+
+    static unsigned int encodeDirection(const glm::vec3& direction);
+    static glm::vec3 decodeDirection(unsigned int packed);
+};
\ No newline at end of file